@@ -46,6 +46,7 @@ int main() {
 	about(stdout); //prints copyright information to the screen and to file
 	about(fp);
 	
+	//setEvChainMode(EVC_HEAP4); //optional:  event set structure (EVC_LIST, EVC_HEAP4, EVC_PAIRING or EVC_CALENDAR); must be called before simm()
 	simm(1, "tarvos_v0.71");  //update the title of this simulation here
 
 	stream(SEED); //Seeds the random number generator
@@ -92,6 +93,12 @@ int main() {
 	schedulep(BRING_LINK_DOWN, LINK_DOWN, -1, NULL); //schedule link failure event
 	schedulep(BRING_LINK_UP, LINK_UP, -1, NULL); //schedule link re-establishment event
 	//schedulep(RESET, RESET_TIME, -1, NULL); //schedule event to reset statistics
+	//alternative to RESET_TIME:  detect the end of the transient (MSER-5) on node delay and link queue length and schedule RESET then
+	//setNodeDelayBatchMeans(6, bmStream("delay node 6", 10));
+	//setFacQueueBatchMeans(tarvosModel.lnk[1].facility, bmStream("queue lnk01", 10));
+	//bmWarmup(RESET);
+	//delay and jitter quantiles (p50, p90, p99, p99.9, max) of every node in report(), without the per-packet trace files
+	//for (i=1; i<=NODES; i++) setNodeHistograms(i);
 	//----- END OF SCHEDULING AND TIMERS -----
 
 	//pkt=setLSP(1, 6, expRoute1, 1 Mega/8, 10000, 1 Mega/8, 0, 5000, 0, 0, 0);
@@ -305,7 +312,7 @@ int main() {
 			//*aux=*pkt;
 			if (nodeReceivePacket(pkt)==0)
 				schedulep(LINK_TRANSMIT_REQUEST, 0, currentPacket, pkt);
-			//jitterDelayTrace(aux->currentNode, simtime(), tarvosModel.node[aux->currentNode].jitter, tarvosModel.node[aux->currentNode].delay);
+			//jitterDelayTrace(aux->currentNode, aux->id, simtime(), tarvosModel.node[aux->currentNode].jitter, tarvosModel.node[aux->currentNode].delay);
 			//free(aux);
 			break;
 
@@ -362,26 +369,29 @@ int main() {
 		fprintf(fp,"Maxqueue facility %d: %d\n", i, getFacMaxQueueSize(i));
 	}
 	for (i=1; i<=GENERATORS; i++) {
-		fprintf(fp,"Pacotes que foram gerados fonte %d:  %d\n", i, tarvosModel.src[i].packetsGenerated);
+		fprintf(fp,"Pacotes que foram gerados fonte %d:  %lld\n", i, tarvosModel.src[i].packetsGenerated);
 	}
 	for (i=1; i<=NODES; i++) {
-		fprintf(fp,"Pacotes received no nodo %d:  %d\n", i, tarvosModel.node[i].packetsReceived);
-		fprintf(fp,"..Pacotes forwarded no nodo %d:  %d\n", i, tarvosModel.node[i].packetsForwarded);
-		fprintf(fp,"..Bytes forwarded no nodo %d:  %f\n", i, tarvosModel.node[i].bytesForwarded);
-		fprintf(fp,"..Pacotes perdidos no nodo %d:  %d\n", i, tarvosModel.node[i].packetsDropped);
-		fprintf(fp,"..Bytes recebidos no nodo %d:  %f\n", i, tarvosModel.node[i].bytesReceived);
-		fprintf(fp,"..Throughput no nodo %d:  %f (bytes/seg)\n", i, tarvosModel.node[i].bytesReceived/simtime());
+		fprintf(fp,"Pacotes received no nodo %d:  %lld\n", i, tarvosModel.node[i].packetsReceived);
+		fprintf(fp,"..Pacotes forwarded no nodo %d:  %lld\n", i, tarvosModel.node[i].packetsForwarded);
+		fprintf(fp,"..Bytes forwarded no nodo %d:  %lld\n", i, tarvosModel.node[i].bytesForwarded);
+		fprintf(fp,"..Pacotes perdidos no nodo %d:  %lld\n", i, tarvosModel.node[i].packetsDropped);
+		fprintf(fp,"..Bytes recebidos no nodo %d:  %lld\n", i, tarvosModel.node[i].bytesReceived);
+		fprintf(fp,"..Throughput no nodo %d:  %f (bytes/seg)\n", i, (double)tarvosModel.node[i].bytesReceived/simtime());
 		fprintf(fp,"..Ultimo delay no nodo %d:  %f (s)\n", i, tarvosModel.node[i].delay);
 		fprintf(fp,"..mean Delay nodo %d:  %f (s)\n", i, tarvosModel.node[i].meanDelay);
+		fprintf(fp,"..desvio padrao Delay nodo %d:  %f (s)\n", i, getNodeDelayStdDev(i));
 		fprintf(fp,"..Ultimo jitter nodo %d:  %f (s)\n", i, tarvosModel.node[i].jitter);
 		fprintf(fp,"..mean Jitter nodo %d:  %f (s)\n", i, tarvosModel.node[i].meanJitter);
+		fprintf(fp,"..desvio padrao Jitter nodo %d:  %f (s)\n", i, getNodeJitterStdDev(i));
 	}
 	for (i=1;i<=LINKS;i++) {
-		fprintf(fp,"Pacotes perdidos na facility %d:  %d\n", i, getFacDropTokenCount(tarvosModel.lnk[i].facility));
+		fprintf(fp,"Pacotes perdidos na facility %d:  %lld\n", i, getFacDropTokenCount(tarvosModel.lnk[i].facility));
 	}
 	for (i=1; i<=LINKS; i++) {
 		fprintf(fp,"Pacotes em Transito link %d: %d\n", i, getPktInTransitQueueSize(i));
 	}
+	fprintf(fp,"Pool de pacotes:  %d em uso, pico %d, %lld reaproveitados\n", getPktPoolLive(), getPktPoolPeak(), getPktPoolRecycled());
 	dumpLIB(tarvosParam.libDump);
 	dumpLSPTable(tarvosParam.lspTableDump);
 	dumpLinks(tarvosParam.linksDump);
@@ -31,19 +31,75 @@
 #include <string.h>
 #include <malloc.h>
 #include <math.h>
+#include <limits.h>
 
 #define MAX_SIMULATIONS 20			/* Aqui e definido o numero maximo de simulacoes permitido para o estudo do modelo */
 
-#ifdef MAIN_MODULE
+/* CONTEXTO DE SIMULAO
+*
+*  Todo o estado do kernel que antes era global (vetor de simulaes, relgio, pools de memria, estado dos geradores
+*  aleatrios) fica num contexto.  As funes do kernel usam sempre o contexto corrente da thread que as chama; assim,
+*  replicaes independentes podem ser executadas em paralelo, em threads de um mesmo processo, cada uma com seu prprio
+*  contexto (ver simmContextCreate e simmSetContext).  Uma thread que no escolhe contexto usa o contexto padro do
+*  processo, o que mantm o comportamento dos programas existentes; duas threads no devem usar o mesmo contexto.
+*  O estado do shell (TARVOS) fica em sc_shell, criado sob demanda pelo prprio shell.
+*/
+#if defined(_MSC_VER)
+#define SIMM_TLS	__declspec(thread)
+#else
+#define SIMM_TLS	__thread
+#endif
 
-struct simul sim[MAX_SIMULATIONS];	/* Poderemos ter varias simulacoes para o mesmo modelo */
+struct simmContext {
+	struct simul sc_sim[MAX_SIMULATIONS];	/* Poderemos ter varias simulacoes para o mesmo modelo */
+	int sc_sn;							/* simulao corrente (ndice de sc_sim) */
+	int sc_event;						/* current simulation event */
+	int sc_token;						/* last token dispatched */
+	int sc_tr;							/* event trace flag */
+	int sc_mr;							/* monitor activation flag */
+	int sc_lft;							/* lines left on current page/screen */
+	int sc_evc_mode;					/* estrutura do conjunto de eventos para as prximas chamadas de simm() */
+	int sc_rns;							/* stream aleatrio da prxima chamada de simm() */
+	double sc_clock;					/* current simulation time */
+	double sc_start;					/* simulation interval start time */
+	FILE *sc_display;					/* screen display file */
+	FILE *sc_opf;						/* current output destination */
+	FILE *sc_fp;						/* arquivo do depurador (funes dbg_) */
+	struct simmPool sc_pools[POOLS];	/* pools de memria do kernel */
+	long sc_In[16];						/* sementes dos streams 1 a 15 (simm_rand) */
+	int sc_strm;						/* stream corrente (simm_rand) */
+	double sc_z2;						/* segundo valor gerado por normal(), usado na chamada seguinte */
+	long sc_jain_x;						/* estado de randJain */
+	int sc_rnd[31];						/* estado do gerador clssico de ranf (RANF_CLASSIC, ver ranfNext em simm_rand.c) */
+	int sc_rnd_f, sc_rnd_r;				/* posies correntes em sc_rnd */
+	struct rngStream *sc_rng;			/* streams do gerador xoshiro256++ j usados (sc_rng[0]  o stream 1) */
+	int sc_rng_n;						/* nmero de streams em sc_rng */
+	int sc_rng_size;					/* nmero de posies alocadas em sc_rng */
+	unsigned long long sc_rng_next[4];	/* estado inicial do prximo stream a criar */
+	unsigned long long sc_rng_seed;		/* semente do contexto (rngSeed) */
+	int sc_rng_rep;						/* replicao (rngReplication):  nmero de long jumps aplicados  semente */
+	int sc_rng_anti;					/* modo antittico (rngAntithetic):  RNG_ANTI_OFF, RNG_ANTI_FIRST ou RNG_ANTI_MIRROR */
+	struct rngNamed *sc_rngn;			/* streams nomeados (sc_rngn[0]  o stream RNG_NAMED + 1) */
+	int sc_rngn_n;						/* nmero de streams em sc_rngn */
+	int sc_rngn_size;					/* nmero de posies alocadas em sc_rngn */
+	void *sc_shell;						/* estado do shell (TARVOS); liberado por simmContextDestroy com sc_shell_free */
+	void (*sc_shell_free)(void *shell);	/* libera sc_shell em simmContextDestroy; NULL usa free() */
+	void (*sc_tkn_free)(TOKEN *tkp);	/* libera as tokens descartadas da fila de uma facility (setFacDown); NULL usa free() */
+	void *sc_stat;						/* estado das mdias de lotes (simm_stat); liberado com free() por simmContextDestroy */
+	void *sc_hist;						/* histogramas (simm_stat); liberados por histContextFree */
+	int sc_rep;							/* replicao executada no contexto por replRun (1, 2, ...); 0 fora de replRun */
+};
 
-#else
+extern SIMM_TLS struct simmContext *simmCtx;	/* contexto corrente da thread; NULL indica o contexto padro */
 
-extern struct simul sim[MAX_SIMULATIONS];
-#endif
+#define SIMM_CTX	(simmCtx != NULL ? simmCtx : simmContextDefault())
 
 /* Funcoes do arquivo simm_kernel */
+struct simmContext *simmContextDefault();
+struct simmContext *simmContextCreate();
+void simmContextDestroy(struct simmContext *ctx);
+void simmSetContext(struct simmContext *ctx);
+struct simmContext *simmGetContext();
 void simm(int m, char *s);
 void reset();
 //static void resetf();
@@ -55,6 +111,7 @@ int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp);
 struct evchain *cancelp_tkn(int tkn);
 void releasep (int f, int tkn);
 void schedulep(int ev, double te, int tkn, TOKEN *tkp);
+EVHANDLE schedulep_h(int ev, double te, int tkn, TOKEN *tkp);
 TOKEN *causep(int *ev, int *tkn);
 int evChainIsEmpty();
 void cause(int *ev, int *tkn);
@@ -63,7 +120,9 @@ int status(int f);
 int inq(int f);
 double U(int f);
 double B(int f);
+double BVar(int f);
 double Lq(int f);
+double LqVar(int f);
 void report();
 void reportf();
 //static struct facilit *rept_page(struct facilit *f);
@@ -75,11 +134,20 @@ void error(int n, char *s);
 char *fname(int f);
 char *mname();
 int getFacMaxQueueSize(int f);
-int getFacDropTokenCount(int f);
+long long getFacDropTokenCount(int f);
+void setFacQueueBatchMeans(int f, int s);
 void setFacUp(int f);
 int setFacDown(int f);
 int getFacUpStatus(int f);
 struct evchain *cancelp_ev(int ev);
+struct evchain *cancelp_handle(EVHANDLE h);
+void setEvChainMode(int mode);
+void reportEvChain();
+void evChainFree(struct evchain *evc);
+int getPoolChunks(int pool);
+int getPoolPeakLive(int pool);
+double getPoolReuseRate(int pool);
+void reportPools();
 //static int purgeFacQueue(int f);
 void dbg_init();
 void dbg_cab();
@@ -93,8 +161,26 @@ void dbg_tp_2();
 void dbg_tp_3();
 
 /* Funcoes do arquivo simm_rand */
+void ranfContextInit(struct simmContext *ctx);
 double ranf();
 int stream (int n);
+void rngSeed(unsigned long long s);
+void rngReplication(int rep);
+int rngNamedStream(char *name);
+void rngAntithetic(int mode);
+double ranf_s(int n);
+double uniform_s(int n, double a, double b);
+int irandom_s(int n, int i, int m);
+double expntl_s(int n, double x);
+double erlang_s(int n, double x, double s);
+double hyperx_s(int n, double x, double s);
+double normal_s(int n, double x, double s);
+double pareto_s(int n, double a, double k);
+void ranf_bulk(int n, double *buf, int count);
+void uniform_bulk(int n, double a, double b, double *buf, int count);
+void expntl_bulk(int n, double x, double *buf, int count);
+void normal_bulk(int n, double x, double s, double *buf, int count);
+void pareto_bulk(int n, double a, double k, double *buf, int count);
 long seed(long Ik, int n);
 double uniform(double a, double b);
 int irandom(int i,int n);
@@ -105,7 +191,79 @@ double normal(double x, double s);
 double pareto(double a, double k);
 double randJain(int seed);
 
+/* Acumuladores (struct simmSum e struct simmMoments, simm_types.h), atualizados a cada evento ou pacote:  soma compensada de
+*  Kahan-Neumaier, cujo erro no cresce com o nmero de parcelas, e mdia e varincia correntes de Welford (com pesos:  West),
+*  sem a subtrao de somas de quadrados.  No compilar com otimizaes que reassociem operaes de ponto flutuante
+*  (/fp:fast, -ffast-math), que eliminam a compensao. */
+static inline void sumAdd(struct simmSum *s, double x)
+{
+	double t = s->ks_sum + x;
+
+	if (fabs(s->ks_sum) >= fabs(x))
+		s->ks_c += (s->ks_sum - t) + x;
+	else
+		s->ks_c += (x - t) + s->ks_sum;
+	s->ks_sum = t;
+}
+
+static inline double sumValue(const struct simmSum *s)
+{
+	return (s->ks_sum + s->ks_c);
+}
+
+/* Acrescenta a observao x com peso w (w = 1 para observaes simples; a durao, para variveis contnuas no tempo) */
+static inline void momAdd(struct simmMoments *m, double x, double w)
+{
+	double d;
+
+	if (w <= 0.0)
+		return;
+	m->w_n++;
+	m->w_wsum += w;
+	d = x - m->w_mean;
+	m->w_mean += d * w / m->w_wsum;
+	m->w_m2 += w * d * (x - m->w_mean);
+}
+
+/* Varincia amostral de observaes com peso 1 */
+static inline double momVar(const struct simmMoments *m)
+{
+	return (m->w_n > 1 ? m->w_m2 / (m->w_n - 1) : 0.0);
+}
+
+/* Varincia de uma varivel contnua no tempo (pesos = duraes) */
+static inline double momTimeVar(const struct simmMoments *m)
+{
+	return (m->w_wsum > 0.0 ? m->w_m2 / m->w_wsum : 0.0);
+}
+
 /* Funcoes do arquivo simm_stat */
 double Z(double p);
 double T(double p, double ndf);
+int replMetric(char *name, double (*fn)(int arg), int arg);
+int replRun(void (*model)(int rep), int threads, int minReps, int maxReps, double alpha, double relPrec);
+void replAntithetic(int on);
+int replCount();
+int replCurrent();
+double replMean(int m);
+double replHalfWidth(int m);
+void replReport();
+int bmStream(char *name, int size);
+void bmObserve(int s, double x);
+void bmObserveWeighted(int s, double x, double w);
+void bmAutoStop(int ev, double alpha, double relPrec);
+double bmMean(int s);
+double bmHalfWidth(int s);
+void bmReport();
+void bmWarmup(int ev);
+double bmWarmupTime(int s);
+void bmReset();
+int histCreate(char *name);
+void histRecord(int h, double x);
+double histQuantile(int h, double q);
+double histMax(int h);
+double histCount(int h);
+void histReset();
+void histReport();
+void histContextFree(struct simmContext *ctx);
 
@@ -60,6 +60,49 @@
 *		  funo cancelp_ev includa, que  basicamente uma cpia da funo cancelp_tkn, mas recebendo como parmetro o nmero do evento.
 *		  10.Nov.2006 Marcos Portnoi
 *
+*		  conjunto de eventos futuros com estrutura selecionvel (funo setEvChainMode):  lista ordenada original,
+*		  heap 4-rio ou pairing heap, todos com a mesma ordem de eventos da lista (inclusive para eventos de mesmo tempo)
+*		  17.Out.2026
+*
+*		  modo EVC_CALENDAR (calendar queue com redimensionamento automtico) para o conjunto de eventos futuros, e funo
+*		  reportEvChain, que apresenta suas estatsticas
+*		  17.Out.2026
+*
+*		  elementos da cadeia de eventos, das filas e dos servidores passam a ser alocados de pools do kernel (poolAlloc);
+*		  cancelp_tkn e cancelp_ev continuam retornando uma cpia alocada com malloc (liberada com free), e o elemento
+*		  original volta ao pool.  Funes evChainFree, getPoolChunks, getPoolPeakLive, getPoolReuseRate e reportPools includas
+*		  17.Out.2026
+*
+*		  facilities localizadas diretamente pelo nmero, atravs do vetor sim[sn].fct_index, em vez de se percorrer a lista
+*		  fct_begin..fct_next em cada chamada; a lista  mantida para os relatrios
+*		  17.Out.2026
+*
+*		  ndice por token dos eventos pendentes (evc_tkn_tab):  cancelp_tkn no percorre mais a cadeia de eventos.  Funes
+*		  schedulep_h e cancelp_handle includas, para cancelamento de um evento especfico mesmo com tokens repetidas
+*		  17.Out.2026
+*
+*		  fila de eventos imediatos (evc_now_begin..evc_now_end):  eventos escalonados com te = 0 no passam pela insero no
+*		  conjunto de eventos; causep os retira antes, na mesma ordem da lista original
+*		  17.Out.2026
+*
+*		  fila das facilities organizada como uma fila FIFO por nvel de prioridade, com mapa de bits dos nveis ocupados
+*		  (funes fqInsert e fqRemoveFirst):  enqueuep, enqueuep_preempt e releasep no percorrem mais a fila
+*		  17.Out.2026
+*
+*		  servidores das facilities indexados (vetor f_srv_vec, heaps de servidores livres e ocupados, tabela token -> servidor):
+*		  requestp, preemptp e releasep no percorrem mais a lista de servidores
+*		  17.Out.2026
+*
+*		  estado global do kernel (sim, sn, clock, pools, gerador de nmeros aleatrios etc.) movido para struct simmContext;
+*		  o contexto corrente  por thread (simmSetContext), o que permite vrias simulaes independentes no mesmo processo
+*		  17.Out.2026
+*
+*		  tamanho da fila das facilities pode alimentar uma srie de mdias de lotes (setFacQueueBatchMeans, simm_stat.c)
+*		  17.Out.2026
+*
+*		  reset() tambm descarta as observaes das sries de mdias de lotes; resetf zera todos os servidores
+*		  17.Out.2026
+*
 *
 *		  alguns nomes de ponteiros alterados de 'prior' para 'previous',
 *		  a fim de no causar confuso com "prioridade".
@@ -149,6 +192,12 @@
 
 #include "simm_globals.h"
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 #define pl 58        /* printer page length   (lines used   */
 #define sl 23        /* screen page length     by 'smpl')   */
 #define FF 12        /* form feed                           */
@@ -159,10 +208,22 @@ static void enqueuep (int f, int tkn, TOKEN *tkp, int pri, double te, int ev);
 static void enqueuep_preempt (int f, int tkn, TOKEN *tkp, int pri, double te, int ev);
 static struct facilit *rept_page(struct facilit *f);
 static int purgeFacQueue(int f);
+static void evcPromote();
+static void evcHeapSchedule(struct evchain *evc);
+static void evcHeapRemove(struct evchain *evc);
+static struct evchain *evcHeapFind(int ev);
+static void evcTknInsert(struct evchain *evc);
+static void evcTknRemove(struct evchain *evc);
+static struct evchain *evcTknFind(int tkn);
+static void evcUnlink(struct evchain *evc);
+static struct evchain *evcTknCancel(int tkn);
+static int evcNowSchedule(struct evchain *evc);
+static void srvHeapPlace(struct facilit *fct, int *heap, int i, int s);
 
 //Variaveis de processamento locais
-
-static int sn = 0;	/* sn -> simulation number
+//Ficam no contexto de simulao corrente da thread (ver struct simmContext em simm_globals.h).  Cada funo do kernel obtm
+//o contexto uma vez (struct simmContext *ctx = SIMM_CTX) e usa ctx->sc_sim, ctx->sc_sn, ctx->sc_clock etc.
+/* sc_sn -> simulation number
 	     Esta variavel  o indexador da estrutura simul que define
 		 a parametrizacao de cada simulacao onde permitira que se
 		 execute mais de uma simulacao por modelo. A ideia e que
@@ -170,26 +231,272 @@ static int sn = 0;	/* sn -> simulation number
 		 seja modificada para gerara resultados diferentes. O
 		 numero de simulacoes e limitado pelo MAX_SIMULATIONS */
 
-static int
-	event,		/* current simulation event (???) possivelmente sem uso */
-    token,		/* last token dispatched */
-    tr,	    	/* event trace flag                    */
-    mr,			/* monitor activation flag             */
-    lft=sl;		/* lines left on current page/screen   */
+#define SP_ALIGNED(t)	((int)((sizeof(t) + sizeof(double) - 1) / sizeof(double) * sizeof(double)))
+
+static struct {					/* nome e tamanho dos ns de cada pool */
+	const char *name;
+	int size;
+} poolInfo[POOLS] = {
+	{"evchain", SP_ALIGNED(struct evchain)},
+	{"fqueue", SP_ALIGNED(struct fqueue)},
+	{"fserv", SP_ALIGNED(struct fserv)}
+};
+
+SIMM_TLS struct simmContext *simmCtx = NULL;	/* contexto corrente da thread */
+
+static struct simmContext simmDefaultCtx;		/* contexto padro do processo */
+#if defined(_WIN32)
+static INIT_ONCE simmDefaultOnce = INIT_ONCE_STATIC_INIT;	/* inicializao nica de simmDefaultCtx, entre threads */
+#else
+static pthread_once_t simmDefaultOnce = PTHREAD_ONCE_INIT;
+#endif
+
+/*-----------------------  CONTEXTO DE SIMULAO  -----------------------
+*
+*  Ver struct simmContext em simm_globals.h.
+*/
+static void simmContextInit(struct simmContext *ctx)
+{
+	int i;
+
+	memset(ctx, 0, sizeof *ctx);
+	ctx->sc_lft = sl;
+	ctx->sc_evc_mode = EVC_LIST;
+	ctx->sc_rns = 1;
+	ctx->sc_display = stdout;
+	ctx->sc_opf = stdout;
+	for (i = 0; i < POOLS; i++)
+	{
+		strcpy(ctx->sc_pools[i].sp_name, poolInfo[i].name);
+		ctx->sc_pools[i].sp_size = poolInfo[i].size;
+	}
+	ranfContextInit(ctx);
+}
+
+/* Inicializa o contexto padro; executada uma nica vez, mesmo que vrias threads o usem pela primeira vez ao mesmo tempo */
+#if defined(_WIN32)
+static BOOL CALLBACK simmDefaultInit(PINIT_ONCE once, PVOID param, PVOID *ctx)
+{
+	simmContextInit(&simmDefaultCtx);
+	return TRUE;
+}
+#else
+static void simmDefaultInit()
+{
+	simmContextInit(&simmDefaultCtx);
+}
+#endif
+
+/* Retorna o contexto padro do processo, inicializando-o na primeira chamada, e o torna o contexto corrente da thread */
+struct simmContext *simmContextDefault()
+{
+#if defined(_WIN32)
+	InitOnceExecuteOnce(&simmDefaultOnce, simmDefaultInit, NULL, NULL);
+#else
+	pthread_once(&simmDefaultOnce, simmDefaultInit);
+#endif
+	simmCtx = &simmDefaultCtx;
+	return (simmCtx);
+}
+
+/* Cria um novo contexto de simulao, sem simulaes, com os mesmos valores iniciais do contexto padro de um processo
+*  novo (em particular, os mesmos streams aleatrios).  O contexto no se torna corrente; ver simmSetContext.
+*/
+struct simmContext *simmContextCreate()
+{
+	struct simmContext *ctx;
+
+	ctx = (simmContext*)malloc(sizeof *ctx);
+	if (ctx == NULL)
+	{
+		printf ("\nError - simmContextCreate - insufficient memory to allocate for simulation context");
+		exit (1);
+	}
+	simmContextInit(ctx);
+	return (ctx);
+}
+
+/* Libera um contexto criado por simmContextCreate, com todas as suas simulaes, facilities e pools.  As tokens (TOKEN)
+*  apontadas pelos eventos ainda pendentes pertencem ao usurio e no so liberadas.  Se ctx for o contexto corrente da
+*  thread, a thread volta para o contexto padro.
+*/
+void simmContextDestroy(struct simmContext *ctx)
+{
+	struct facilit *fct, *fct_next;
+	void *chunk;
+	int i;
+
+	if (ctx == NULL || ctx == &simmDefaultCtx)
+		return;
+	for (i = 0; i < MAX_SIMULATIONS; i++)
+	{
+		for (fct = ctx->sc_sim[i].fct_begin; fct != NULL; fct = fct_next)
+		{
+			fct_next = fct->fct_next;
+			free(fct->f_srv_vec);
+			free(fct->f_idle);
+			free(fct->f_busy);
+			free(fct->f_srv_tab);
+			free(fct);
+		}
+		free(ctx->sc_sim[i].fct_index);
+		free(ctx->sc_sim[i].evc_heap);
+		free(ctx->sc_sim[i].evc_cal.cq_bucket);
+		free(ctx->sc_sim[i].evc_cal.cq_tail);
+		free(ctx->sc_sim[i].evc_tkn_tab);
+	}
+	for (i = 0; i < POOLS; i++)
+		while ((chunk = ctx->sc_pools[i].sp_chunk_list) != NULL)
+		{
+			ctx->sc_pools[i].sp_chunk_list = *(void**)chunk;
+			free(chunk);
+		}
+	free(ctx->sc_rng);
+	free(ctx->sc_rngn);
+	if (ctx->sc_shell_free != NULL)
+		ctx->sc_shell_free(ctx->sc_shell);
+	else
+		free(ctx->sc_shell);
+	free(ctx->sc_stat);
+	histContextFree(ctx);
+	free(ctx);
+	if (simmCtx == ctx)
+		simmCtx = NULL;
+}
+
+/* Torna ctx o contexto corrente da thread que chama; todas as funes do kernel e do shell chamadas por esta thread passam
+*  a us-lo.  ctx = NULL volta ao contexto padro do processo.
+*/
+void simmSetContext(struct simmContext *ctx)
+{
+	simmCtx = ctx;
+}
+
+/* Retorna o contexto corrente da thread que chama */
+struct simmContext *simmGetContext()
+{
+	return (SIMM_CTX);
+}
+
+/*-----------------------  POOLS DE MEMRIA DO KERNEL  -----------------------
+*
+*  Os ns da cadeia de eventos, das filas e dos servidores das facilities so obtidos de pools (ver struct simmPool em
+*  simm_types.h), e no diretamente de malloc/free, pois so alocados e liberados a cada evento.
+*/
+static void *poolAlloc(struct simmPool *sp)
+{
+	void *node;
+	char *chunk;
+
+	sp->sp_allocs++;
+	if (sp->sp_free != NULL)		/* reaproveita um n liberado */
+	{
+		node = sp->sp_free;
+		sp->sp_free = *(void**)node;
+		sp->sp_reuses++;
+	}
+	else
+	{
+		if (sp->sp_next == sp->sp_end)	/* bloco corrente esgotado:  aloca novo bloco */
+		{
+			chunk = (char*)malloc(sizeof(double) + SP_CHUNK * sp->sp_size);	/* o incio do bloco encadeia os blocos do pool */
+			if (chunk == NULL)
+			{
+				printf ("\nError - poolAlloc - insufficient memory to allocate for %s", sp->sp_name);
+				exit (1);
+			}
+			*(void**)chunk = sp->sp_chunk_list;
+			sp->sp_chunk_list = chunk;
+			sp->sp_next = chunk + sizeof(double);
+			sp->sp_end = sp->sp_next + SP_CHUNK * sp->sp_size;
+			sp->sp_chunks++;
+		}
+		node = sp->sp_next;
+		sp->sp_next += sp->sp_size;
+	}
+	if (++sp->sp_live > sp->sp_peak)
+		sp->sp_peak = sp->sp_live;
+	return node;
+}
+
+static void poolFree(struct simmPool *sp, void *node)
+{
+	*(void**)node = sp->sp_free;
+	sp->sp_free = node;
+	sp->sp_live--;
+}
+
+/* FREE EVENT CHAIN ELEMENT
+*
+*  Devolve ao pool do kernel um elemento da cadeia de eventos retirado por cancelp_handle.  Estes elementos no podem ser liberados
+*  com free() (ao contrrio dos retornados por cancelp_tkn e cancelp_ev).
+*/
+void evChainFree(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (evc != NULL)
+		poolFree(&ctx->sc_pools[POOL_EVCHAIN], evc);
+}
+
+/* Copia para uma rea alocada com malloc o elemento evc, j retirado da cadeia de eventos, e devolve o original ao pool do
+*  kernel; mantm o contrato original de cancelp_tkn e cancelp_ev, cujo retorno  liberado com free()
+*/
+static struct evchain *evChainDetach(struct evchain *evc)
+{
+	struct evchain *copy;
+
+	if (evc == NULL)
+		return NULL;
+	copy = (struct evchain*)malloc(sizeof *copy);
+	if (copy == NULL)
+	{
+		printf("\nError - evChainDetach - insufficient memory to allocate for cancelled event");
+		exit(1);
+	}
+	memcpy(copy, evc, sizeof *copy);
+	evChainFree(evc);
+	return copy;
+}
+
+/* Retorna o nmero de blocos alocados pelo pool (POOL_EVCHAIN, POOL_FQUEUE ou POOL_FSERV) */
+int getPoolChunks(int pool)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	return ctx->sc_pools[pool].sp_chunks;
+}
+
+/* Retorna o maior nmero de ns do pool em uso simultaneamente */
+int getPoolPeakLive(int pool)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	return ctx->sc_pools[pool].sp_peak;
+}
+
+/* Retorna a frao das alocaes do pool atendidas por ns reaproveitados */
+double getPoolReuseRate(int pool)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	return (ctx->sc_pools[pool].sp_allocs > 0 ? (double)ctx->sc_pools[pool].sp_reuses / ctx->sc_pools[pool].sp_allocs : 0.0);
+}
 
-static double
-	clock,	    /* current simulation time */
-	start;		/* simulation interval start time */
+/* GENERATE MEMORY POOL REPORT */
+void reportPools()
+{
+	struct simmContext *ctx = SIMM_CTX;
+	int i;
 
-static FILE
-  //these definitions are not compatible with some compilers;
-  //put them inside a function, such as simm()
-  //*display=stdout,	/* screen display file                 */
-  //*opf=stdout;	    /* current output destination          */
-  *display,	/* screen display file                 */
-  *opf;	    /* current output destination          */
+	fprintf(ctx->sc_opf, "\n KERNEL MEMORY POOLS\n");
+	fprintf(ctx->sc_opf, " %-10s %12s %10s %10s %12s %10s\n", "POOL", "NODE SIZE", "CHUNKS", "LIVE", "PEAK LIVE", "REUSE");
+	for (i = 0; i < POOLS; i++)
+		fprintf(ctx->sc_opf, " %-10s %12d %10d %10d %12d %9.2f%%\n", ctx->sc_pools[i].sp_name, ctx->sc_pools[i].sp_size, ctx->sc_pools[i].sp_chunks,
+			ctx->sc_pools[i].sp_live, ctx->sc_pools[i].sp_peak, 100.0 * getPoolReuseRate(i));
+	ctx->sc_lft -= 2 + POOLS;
+}
 
-FILE *fp;	/* fp  para o depurador*/
 
 /*---------------  INITIALIZE SIMULATION SUBSYSTEM  ------------------
 *
@@ -214,20 +521,21 @@ FILE *fp;	/* fp 
 */
 void simm(int m, char *s)
 {
-	static int rns = 1;	/* rns define o numero do stream aleatorio que sera usado.
-						   Como rns e uma variavel tipo static ela so eh inicializada
+	struct simmContext *ctx = SIMM_CTX;
+	int rns = ctx->sc_rns;	/* rns define o numero do stream aleatorio que sera usado.
+						   Como rns fica no contexto, ele so eh inicializado
 						   uma vez, ou seja, se o smpl for chamada de novo, a rotina
 						   que incrementa rns sera ativada e o simulador executara
 						   com uma nova sequencia aleatoria */
 
-	display=stdout;	//screen display file
-	opf=stdout;	    //current output destination
+	ctx->sc_display=stdout;	//screen display file
+	ctx->sc_opf=stdout;	    //current output destination
 	
-	sn = sn + 1;		/* A simulacao comeca com o elemento 1 do vetor de simulaes.  A cada
+	ctx->sc_sn = ctx->sc_sn + 1;		/* A simulacao comeca com o elemento 1 do vetor de simulaes.  A cada
 						   vez que a rotina simm for chamada, o ndice  incrementado
 						   e cria-se uma nova instncia de simulao */
 
-	if ( sn > MAX_SIMULATIONS )
+	if ( ctx->sc_sn > MAX_SIMULATIONS )
 	{
 		printf ("\nError - simm - number of simulations exceeds MAX_SIMULATIONS");
 		exit (1);
@@ -236,18 +544,32 @@ void simm(int m, char *s)
 	/* Inicializando as estruturas de cadeia de eventos e de faciltys e apontando para o primeiro
 	   elemento */
 
-	strcpy(sim[sn].name, s);
-
-	sim[sn].evc_begin = NULL;
-	sim[sn].evc_end = NULL;
-	sim[sn].fct_begin = NULL;
-	sim[sn].fct_number = 0;
-
-	clock=start= 0.0;		/* Tempo de simulacao e intervalo serao iguais s o start nao for
+	strcpy(ctx->sc_sim[ctx->sc_sn].name, s);
+
+	ctx->sc_sim[ctx->sc_sn].evc_begin = NULL;
+	ctx->sc_sim[ctx->sc_sn].evc_end = NULL;
+	ctx->sc_sim[ctx->sc_sn].evc_now_begin = ctx->sc_sim[ctx->sc_sn].evc_now_end = NULL;
+	ctx->sc_sim[ctx->sc_sn].fct_begin = NULL;
+	ctx->sc_sim[ctx->sc_sn].fct_index = NULL;
+	ctx->sc_sim[ctx->sc_sn].fct_index_size = 0;
+	ctx->sc_sim[ctx->sc_sn].fct_number = 0;
+	ctx->sc_sim[ctx->sc_sn].evc_mode = ctx->sc_evc_mode;
+	ctx->sc_sim[ctx->sc_sn].evc_seq = 0;
+	ctx->sc_sim[ctx->sc_sn].evc_heap = NULL;
+	ctx->sc_sim[ctx->sc_sn].evc_heap_n = ctx->sc_sim[ctx->sc_sn].evc_heap_size = 0;
+	ctx->sc_sim[ctx->sc_sn].evc_pheap = NULL;
+	memset(&ctx->sc_sim[ctx->sc_sn].evc_cal, 0, sizeof ctx->sc_sim[ctx->sc_sn].evc_cal);
+	ctx->sc_sim[ctx->sc_sn].evc_cal.cq_width = 1.0;
+	ctx->sc_sim[ctx->sc_sn].evc_tkn_tab = NULL;
+	ctx->sc_sim[ctx->sc_sn].evc_tkn_size = ctx->sc_sim[ctx->sc_sn].evc_count = 0;
+	ctx->sc_sim[ctx->sc_sn].evc_ids = 0;
+
+	ctx->sc_clock=ctx->sc_start= 0.0;		/* Tempo de simulacao e intervalo serao iguais s o start nao for
 												 modificado ao longo da simulacao */
-	event = 0;
+	ctx->sc_event = 0;
 
 	rns = stream(rns); rns = ++rns>15? 1:rns; /* set random no stream */
+	ctx->sc_rns = rns;
 }
 
 /*---------------  INITIALIZE SIMULATION SUBSYSTEM:  TARVOS version  ------------------
@@ -281,8 +603,12 @@ void tarvos(int m, char *s)
 /*-----------------------  RESET MEASUREMENTS  -----------------------*/
 void reset()  					/* limpa os contadores e acumuladores das medicoes */
 {
+    struct simmContext *ctx = SIMM_CTX;
+
     resetf();
-	start = clock;					/* Ao final clock-start apresenta o intervalo em que as medicoes
+	bmReset();						/* descarta as observaes das sries de mdias de lotes (simm_stat) */
+	histReset();					/* e dos histogramas */
+	ctx->sc_start = ctx->sc_clock;					/* Ao final clock-start apresenta o intervalo em que as medicoes
 															 ocorreram */
 
     /* #if MODIFY
@@ -309,31 +635,42 @@ void reset()  					/* limpa os contadores e acumuladores das medicoes */
 *  . Campo f_busy_time, que  o somatrio, para a facility, de todos os busy times dos servidores (fs_busy_time) tambm  zerado.
 *  . Campo f_tkn_dropped tambm  zerado.
 *
+*  17.Out.2026:  o lao dos servidores zerava sempre o primeiro servidor (fct->f_serv) em vez de cada servidor (fct_serv).
+*  O tempo de ocupao dos servidores ocupados e o tamanho de fila passam a ser contados a partir do reset (fs_start e
+*  f_last_ch_time_q), e no desde o incio do servio ou da ltima mudana da fila.
+*
 */
 static void resetf() {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
 	struct fserv *fct_serv;
+	int i;
 
-	fct = sim[sn].fct_begin;
+	fct = ctx->sc_sim[ctx->sc_sn].fct_begin;
 
 	//while (fct->fct_next != NULL) Consertada conforme abaixo, para que a ltima facility seja tambm processada.
 	while (fct != NULL) { //faa enquanto houver facilities na lista
 		fct->f_exit_count_q = 0;
 		fct->f_preempt_count = 0;
-		fct->length_time_prod_sum = 0.;
+		memset(&fct->length_time_prod_sum, 0, sizeof fct->length_time_prod_sum);
+		memset(&fct->f_q_mom, 0, sizeof fct->f_q_mom);
+		memset(&fct->f_s_mom, 0, sizeof fct->f_s_mom);
 		fct->f_release_count = 0; //este campo  um somatrio dos fs_release_count de cada servidor; ento, zerar tambm
-		fct->f_busy_time = 0.; //zerar este acumulador, que  o somatrio de todos os fs_busy_time dos servidores
+		memset(&fct->f_busy_time, 0, sizeof fct->f_busy_time); //zerar este acumulador, que  o somatrio de todos os fs_busy_time dos servidores
 		fct->f_max_queue = fct->f_n_length_q; //iguale o tamanho mximo de fila ao tamanho atual da fila
 		fct->f_tkn_dropped = 0; //zera contador de tokens descartados
+		fct->f_last_ch_time_q = ctx->sc_clock; //o produto tamanho x tempo da fila  acumulado a partir de agora
 
 		fct_serv = fct->f_serv; //coleta apontador para a fila de servidores da facility
 
 		//while (fct_serv->fs_next != NULL) Consertado conforme abaixo, pois se s houver um servidor, este no estava sendo limpo.
 		while (fct_serv != NULL) { //faa enquanto houver servidores na lista da facility
-			fct->f_serv->fs_release_count = 0;
-			fct->f_serv->fs_busy_time = 0.;
+			fct_serv->fs_release_count = 0;
+			memset(&fct_serv->fs_busy_time, 0, sizeof fct_serv->fs_busy_time);
 			fct_serv = fct_serv->fs_next; //coleta o prximo servidor
 		}
+		for (i = 0; i < fct->f_n_busy_heap; i++) //servidores ocupados:  o tempo de ocupao  contado a partir de agora
+			fct->f_srv_vec[fct->f_busy[i]]->fs_start = ctx->sc_clock;
 
 		fct = fct->fct_next; //coleta a prxima facility
 	}
@@ -350,11 +687,12 @@ static void resetf() {
 */
 int facility(char *s, int n)
 {
-	struct facilit *fct, *fct_end;
+	struct simmContext *ctx = SIMM_CTX;
+	struct facilit *fct, **fct_index;
 	struct fserv *srv;
 	struct fserv *srv_previous;
 
-	int i;
+	int i, tab_size;
 
 	if (n < 1)
 	{
@@ -369,10 +707,10 @@ int facility(char *s, int n)
 		exit (1);
 	}
 
-	sim[sn].fct_number = sim[sn].fct_number + 1; //incrementa fct_number para que indique o prximo nmero a criar
+	ctx->sc_sim[ctx->sc_sn].fct_number = ctx->sc_sim[ctx->sc_sn].fct_number + 1; //incrementa fct_number para que indique o prximo nmero a criar
 
 	strcpy(fct->f_name, s);
-	fct->f_number = sim[sn].fct_number;	/* As facilities comeam em 1, 2, 3, ... sim[sn].fct_number contm o ltimo nmero de facility criado */
+	fct->f_number = ctx->sc_sim[ctx->sc_sn].fct_number;	/* As facilities comeam em 1, 2, 3, ... sim[sn].fct_number contm o ltimo nmero de facility criado */
 	fct->f_n_serv = n;
 	fct->f_n_busy_serv = 0;	/* Se n_busy_serv = n, todos os servidores estao ocupados; a token deve ser enfileirada */
 	fct->f_n_length_q = 0;
@@ -380,29 +718,49 @@ int facility(char *s, int n)
 	fct->f_last_ch_time_q = 0.0;
 	fct->f_max_queue = 0;
 	fct->f_preempt_count = 0;
-	fct->length_time_prod_sum = 0.0;
-	fct->f_busy_time = 0.0;
+	memset(&fct->length_time_prod_sum, 0, sizeof fct->length_time_prod_sum);
+	memset(&fct->f_q_mom, 0, sizeof fct->f_q_mom);
+	memset(&fct->f_s_mom, 0, sizeof fct->f_s_mom);
+	memset(&fct->f_busy_time, 0, sizeof fct->f_busy_time);
 	fct->f_release_count = 0;
 	fct->f_serv = NULL; //apontador para a lista de servidores
 	fct->fct_next = NULL; //apontador para a definio do prximo facility
 	fct->f_queue = NULL; //Inicia com NULL; quando as tokens chegarem, serao enfileiradas
+	for (i = 0; i < FQ_LEVELS; i++) //filas por nvel de prioridade vazias
+		fct->f_q_head[i] = fct->f_q_tail[i] = NULL;
+	fct->f_q_bitmap = 0;
 	fct->f_up = 1; //facility est operacional (UP) por default (0 = DOWN, 1 = UP)
 	fct->f_tkn_dropped = 0; //contador de tokens descartadas (tokens so descartadas, por exemplo, quando a facility est down)
+	fct->f_bm = 0; //nenhuma srie de mdias de lotes para o tamanho da fila
+	for (tab_size = 1; tab_size < 2 * n; tab_size *= 2)	//tabela hash token -> servidor:  potncia de 2, pelo menos o dobro de servidores
+		;
+	fct->f_srv_vec = (fserv**)malloc(n * sizeof *fct->f_srv_vec);
+	fct->f_idle = (int*)malloc(n * sizeof *fct->f_idle);
+	fct->f_busy = (int*)malloc(n * sizeof *fct->f_busy);
+	fct->f_srv_tab = (fserv**)malloc(tab_size * sizeof *fct->f_srv_tab);
+	if (fct->f_srv_vec == NULL || fct->f_idle == NULL || fct->f_busy == NULL || fct->f_srv_tab == NULL)
+	{
+		printf ("\nError - facility - insufficient memory to allocate for server indexes");
+		exit (1);
+	}
+	for (i = 0; i < tab_size; i++)
+		fct->f_srv_tab[i] = NULL;
+	fct->f_srv_tab_mask = tab_size - 1;
+	fct->f_n_idle = n;
+	fct->f_n_busy_heap = 0;
 	for (i = 0; i < n; i++)
 	{
-		srv = (fserv*)malloc(sizeof *srv);
-		if (srv == NULL)
-		{
-			printf ("\nError - facility - insufficient memory to allocate for server");
-			exit (1);
-		}
+		srv = (fserv*)poolAlloc(&ctx->sc_pools[POOL_FSERV]);
 		srv->fs_number = i;		// IMPORTANTE - o numero do servidor comeca com zero e nao com 1
 		srv->fs_tkn = 0;
 		srv->fs_p_tkn = 0;
 		srv->fs_release_count = 0;
 		srv->fs_start = 0.0;
-		srv->fs_busy_time = 0.0;
+		memset(&srv->fs_busy_time, 0, sizeof srv->fs_busy_time);
 		srv->fs_next = NULL;
+		srv->fs_tab_next = NULL;
+		fct->f_srv_vec[i] = srv;
+		srvHeapPlace(fct, fct->f_idle, i, i);	//servidores livres em ordem de nmero:  j  um heap
 
 		if (fct->f_serv == NULL) //s entra aqui se for o primeiro servidor criado para a facility
 		{
@@ -416,21 +774,144 @@ int facility(char *s, int n)
 		}
 	}
 
-	if (sim[sn].fct_begin == NULL)	/* S entra aqui se a lista de facilities estiver vazia */
+	if (ctx->sc_sim[ctx->sc_sn].fct_number >= ctx->sc_sim[ctx->sc_sn].fct_index_size) //vetor de facilities cheio; dobre o seu tamanho
+	{
+		ctx->sc_sim[ctx->sc_sn].fct_index_size = ctx->sc_sim[ctx->sc_sn].fct_index_size == 0 ? 64 : 2 * ctx->sc_sim[ctx->sc_sn].fct_index_size;
+		fct_index = (struct facilit**)realloc(ctx->sc_sim[ctx->sc_sn].fct_index, ctx->sc_sim[ctx->sc_sn].fct_index_size * sizeof *fct_index);
+		if (fct_index == NULL)
+		{
+			printf ("\nError - facility - insufficient memory to allocate for facility table");
+			exit (1);
+		}
+		ctx->sc_sim[ctx->sc_sn].fct_index = fct_index;
+		ctx->sc_sim[ctx->sc_sn].fct_index[0] = NULL; //a posio zero no  usada; as facilities comeam em 1
+	}
+	ctx->sc_sim[ctx->sc_sn].fct_index[fct->f_number] = fct; //as funes do kernel localizam a facility diretamente por este vetor
+
+	if (ctx->sc_sim[ctx->sc_sn].fct_begin == NULL)	/* S entra aqui se a lista de facilities estiver vazia */
 	{
-		sim[sn].fct_begin = fct;
+		ctx->sc_sim[ctx->sc_sn].fct_begin = fct;
 	}
 	else
 	{
-		fct_end = sim[sn].fct_begin;
-		while (fct_end->fct_next != NULL) //percorre a lista de facilities em busca da ltima posio; lista de facilities  simplesmente encadeada
-		{
-			fct_end = fct_end->fct_next;
-		}
-		fct_end->fct_next = fct; //adiciona facility recm criada ao final da lista
-		fct->fct_next = NULL; //certifica que este apontador next, no ltimo elemento da fila,  NULL
+		ctx->sc_sim[ctx->sc_sn].fct_index[fct->f_number - 1]->fct_next = fct; //adiciona facility recm criada ao final da lista (a ltima facility  a de nmero anterior)
+	}
+  return(ctx->sc_sim[ctx->sc_sn].fct_number);
+}
+
+
+/*-------------------  NDICES DE SERVIDORES DA FACILITY  -------------------
+*
+*  Alm da lista f_serv, cada facility mantm um vetor de servidores indexado por fs_number (f_srv_vec) e trs ndices
+*  sobre ele, para que requestp, preemptp e releasep no percorram a lista:
+*   - f_idle:  heap (mnimo) dos servidores livres, por fs_number;
+*   - f_busy:  heap (mnimo) dos servidores ocupados, por (fs_p_tkn, fs_number); a raiz  a vtima de preempo;
+*   - f_srv_tab:  tabela hash token -> servidor que a atende.
+*  Os desempates so os mesmos da busca na lista:  o servidor livre escolhido  o de menor nmero, a vtima de preempo 
+*  o de menor nmero entre os de menor prioridade, e releasep libera o servidor de menor nmero que atende a token.
+*/
+static int srvBefore(struct facilit *fct, int *heap, int a, int b)
+{
+	struct fserv *sa = fct->f_srv_vec[a], *sb = fct->f_srv_vec[b];
+
+	if (heap == fct->f_busy && sa->fs_p_tkn != sb->fs_p_tkn)
+		return (sa->fs_p_tkn < sb->fs_p_tkn);
+	return (a < b);
+}
+
+static void srvHeapPlace(struct facilit *fct, int *heap, int i, int s)
+{
+	heap[i] = s;
+	fct->f_srv_vec[s]->fs_heap_pos = i;
+}
+
+static void srvHeapSift(struct facilit *fct, int *heap, int n, int i)
+{
+	int s = heap[i], c;
+
+	while (i > 0 && srvBefore(fct, heap, s, heap[(i - 1) / 2]))	/* sobe */
+	{
+		srvHeapPlace(fct, heap, i, heap[(i - 1) / 2]);
+		i = (i - 1) / 2;
+	}
+	while ((c = 2 * i + 1) < n)	/* desce */
+	{
+		if (c + 1 < n && srvBefore(fct, heap, heap[c + 1], heap[c]))
+			c++;
+		if (!srvBefore(fct, heap, heap[c], s))
+			break;
+		srvHeapPlace(fct, heap, i, heap[c]);
+		i = c;
+	}
+	srvHeapPlace(fct, heap, i, s);
+}
+
+static void srvHeapInsert(struct facilit *fct, int *heap, int *n, struct fserv *srv)
+{
+	heap[*n] = srv->fs_number;
+	(*n)++;
+	srvHeapSift(fct, heap, *n, *n - 1);
+}
+
+static void srvHeapRemove(struct facilit *fct, int *heap, int *n, struct fserv *srv)
+{
+	int i = srv->fs_heap_pos;
+
+	if (i != --*n)
+	{
+		heap[i] = heap[*n];
+		srvHeapSift(fct, heap, *n, i);
 	}
-  return(sim[sn].fct_number);
+}
+
+static unsigned int srvTknHash(struct facilit *fct, int tkn)
+{
+	return ((unsigned int)tkn * 2654435761u) & fct->f_srv_tab_mask;
+}
+
+/* Coloca a token tkn, de prioridade pri, em servio no servidor srv (retirado de f_idle pelo chamador, se for o caso) */
+static void srvStart(struct facilit *fct, struct fserv *srv, int tkn, int pri)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	unsigned int h = srvTknHash(fct, tkn);
+
+	srv->fs_tkn = tkn;
+	srv->fs_p_tkn = pri;
+	srv->fs_start = ctx->sc_clock;
+	srv->fs_tab_next = fct->f_srv_tab[h];
+	fct->f_srv_tab[h] = srv;
+	srvHeapInsert(fct, fct->f_busy, &fct->f_n_busy_heap, srv);
+}
+
+/* Retira a token em servio do servidor srv dos ndices de servidores ocupados */
+static void srvStop(struct facilit *fct, struct fserv *srv)
+{
+	struct fserv **link = &fct->f_srv_tab[srvTknHash(fct, srv->fs_tkn)];
+
+	while (*link != srv)
+		link = &(*link)->fs_tab_next;
+	*link = srv->fs_tab_next;
+	srvHeapRemove(fct, fct->f_busy, &fct->f_n_busy_heap, srv);
+}
+
+/* Retira e retorna o servidor livre de menor nmero (deve haver servidor livre) */
+static struct fserv *srvTakeIdle(struct facilit *fct)
+{
+	struct fserv *srv = fct->f_srv_vec[fct->f_idle[0]];
+
+	srvHeapRemove(fct, fct->f_idle, &fct->f_n_idle, srv);
+	return (srv);
+}
+
+/* Retorna o servidor de menor nmero que atende a token tkn, ou NULL */
+static struct fserv *srvFind(struct facilit *fct, int tkn)
+{
+	struct fserv *srv, *found = NULL;
+
+	for (srv = fct->f_srv_tab[srvTknHash(fct, tkn)]; srv != NULL; srv = srv->fs_tab_next)
+		if (srv->fs_tkn == tkn && (found == NULL || srv->fs_number < found->fs_number))
+			found = srv;
+	return (found);
 }
 
 
@@ -465,6 +946,7 @@ int facility(char *s, int n)
 * (estas ampliaes de estado da facility 10.Jan.2006 Marcos Portnoi)
 */
 int requestp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
+	struct simmContext *ctx = SIMM_CTX;
 	int r;
 	struct facilit *fct;
 	struct fserv *srv;
@@ -475,17 +957,13 @@ int requestp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 		exit (1);
 	}
 
-	if ( f > sim[sn].fct_number)
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - requestp - facility number does not exist");
 		exit (1);
 	}
 
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 
 	//se a facility estiver down, retorne imediatamente com 2
 	//O programa do usurio deve decidir o que fazer com a token (descartar ou no)
@@ -497,14 +975,8 @@ int requestp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 
 	if ( fct->f_n_busy_serv < fct->f_n_serv )	/* Ainda tem servidor livre */
 	{
-			srv = fct->f_serv;
-			while (srv->fs_tkn != 0)
-			{
-				srv=srv->fs_next;
-			}
-			srv->fs_tkn = tkn;
-			srv->fs_p_tkn = pri;
-			srv->fs_start = clock;						/* Comeco de novo servico */
+			srv = srvTakeIdle(fct);						/* servidor livre de menor nmero */
+			srvStart(fct, srv, tkn, pri);				/* Comeco de novo servico */
 			fct->f_n_busy_serv++;
 			r = 0;
 	}
@@ -573,7 +1045,8 @@ int requestp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 * (estas ampliaes de estado da facility 10.Jan.2006 Marcos Portnoi)
 */
 int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
-	int r, tkn_srv, tkn_pri_srv, ev_srv, menor_pri;
+	struct simmContext *ctx = SIMM_CTX;
+	int r, tkn_srv, tkn_pri_srv, ev_srv;
 	struct facilit *fct;
 	struct fserv *srv, *srv_menor_pri;
 	struct evchain *evc_tkn_srv;
@@ -586,17 +1059,13 @@ int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 		exit (1);
 	}
 
-	if ( f > sim[sn].fct_number)
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - preemptp - facility number does not exist");
 		exit (1);
 	}
 
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 
 	//se a facility estiver down, retorne imediatamente com 2
 	//O programa do usurio deve decidir o que fazer com a token (descartar ou no)
@@ -631,14 +1100,8 @@ int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 
 	if ( fct->f_n_busy_serv < fct->f_n_serv )	/* Ainda tem servidor livre */
 	{
-			srv = fct->f_serv;
-			while (srv->fs_tkn != 0)
-			{
-				srv=srv->fs_next;
-			}
-			srv->fs_tkn = tkn;
-			srv->fs_p_tkn = pri;
-			srv->fs_start = clock;				/* Comeco de novo servico */
+			srv = srvTakeIdle(fct);				/* servidor livre de menor nmero */
+			srvStart(fct, srv, tkn, pri);		/* Comeco de novo servico */
 			fct->f_n_busy_serv++;
 			r = 0;
 			return (r);
@@ -648,18 +1111,9 @@ int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 	   verificar os servidores que estao ocupados para verificar prioridade da
 	   token em servico e efetuar os processamentos 2.a ou 2.b */
 
-	srv = fct->f_serv;
-	srv_menor_pri = NULL;
-	menor_pri = pri;
-	while (srv != NULL)
-	{
-		if (menor_pri > srv->fs_p_tkn)
-		{
-			menor_pri = srv->fs_p_tkn;
-			srv_menor_pri = srv;
-		}
-		srv=srv->fs_next;
-	}
+	srv_menor_pri = fct->f_srv_vec[fct->f_busy[0]];	/* raiz do heap de ocupados:  menor prioridade em servio */
+	if (srv_menor_pri->fs_p_tkn >= pri)
+		srv_menor_pri = NULL;
 
 	if (srv_menor_pri == NULL)			/* Processamento 2.a inicio */
 
@@ -689,7 +1143,7 @@ int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 	   deve retornar apos o processamento o apontador para o elemento da cadeia
 	   de eventos que contem as informacoes de processamento da token */
 
-	evc_tkn_srv = cancelp_tkn(srv->fs_tkn);
+	evc_tkn_srv = evcTknCancel(srv->fs_tkn);
 
 	if (evc_tkn_srv == NULL) { //se for NULL, indica que o token no foi encontrado na cadeia de eventos
 		printf("\nError - preemptp - token to be preempted not found in event chain (possible release event)");
@@ -707,7 +1161,7 @@ int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 
 	tkn_srv = evc_tkn_srv->ev_tkn;
 	tkp_srv = evc_tkn_srv->ev_tkn_p;
-	te_srv = (evc_tkn_srv->ev_time - clock);
+	te_srv = (evc_tkn_srv->ev_time - ctx->sc_clock);
 	tkn_pri_srv = srv->fs_p_tkn;
 	ev_srv = evc_tkn_srv->ev_type;
 
@@ -717,6 +1171,7 @@ int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 	enqueuep_preempt(f, tkn_srv, tkp_srv, tkn_pri_srv, te_srv, ev_srv);
 
 	/* atualiza estatisticas do servidor apos saida da tkn que estava em servico */
+	srvStop(fct, srv);
 	srv->fs_tkn = 0;
 	srv->fs_p_tkn = 0;
 	  /* srv->fs_release_count++;nao deve ser contabilizado mais um release pois senao
@@ -739,10 +1194,10 @@ int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 		 And, perhaps, use, for calculating the Mean Busy Period, the # of Serviced Tokens, and not # of Releases.
 		 (01.August.2013 Marcos Portnoi)
 		 */
-	srv->fs_busy_time = srv->fs_busy_time + ( clock - srv->fs_start ); /*Acumula tempo uso serv */
+	sumAdd(&srv->fs_busy_time, ctx->sc_clock - srv->fs_start); /*Acumula tempo uso serv */
 
 	/* atualiza estatisticas da facility apos saida do servico */
-	fct->f_busy_time = fct->f_busy_time + ( clock - srv->fs_start );
+	sumAdd(&fct->f_busy_time, ctx->sc_clock - srv->fs_start);
 	/* fct->f_release_count++; idem srv->fs_release_cont++ */
 	fct->f_n_busy_serv--; //agora h um servidor livre
 	fct->f_preempt_count++; //incrementa contador de preempes, pois aqui efetivamente ocorreu uma
@@ -751,13 +1206,11 @@ int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 	   servico e foi enfileirada na facility, podemos liberar a area de memoria que
 	   o elemento da cadeia estava usando */
 
-	free(evc_tkn_srv);
+	evChainFree(evc_tkn_srv);
 
 	/* coloca a token que chama a preempo em servico */
 
-	srv->fs_tkn = tkn;
-	srv->fs_p_tkn = pri;
-	srv->fs_start = clock;		/* Comeco de novo servico */
+	srvStart(fct, srv, tkn, pri);	/* Comeco de novo servico */
 	fct->f_n_busy_serv++;
 	r = 0;						/* retorna 0 pois a solicitacao de servico foi aceita
 								   para que seja escalonado o termino de servico na
@@ -772,17 +1225,28 @@ int preemptp (int f, int tkn, int pri, int ev, double te, TOKEN *tkp) {
 * o elemento da cadeia que foi retirado.  Recebe como parmetro o nmero do token.
 * Ela s funciona bem se o nmero de token for nico durante toda a simulao; caso
 * contrrio, o primeiro token (com tempo de ocorrncia mais prximo) com aquele nmero
-* ser retirado da cadeia, podendo ser o token desejado, ou no.
+* ser retirado da cadeia, podendo ser o token desejado, ou no.  Para cancelar um evento
+* especfico, use schedulep_h e cancelp_handle.
 *
-* Retorna ponteiro para o elemento da cadeia de eventos que foi cancelado, ou NULL se no
-* encontrado.  A funo que chama deve cuidar de testar para NULL e eliminar o elemento da
-* memria com free, se necessrio.
+* A busca usa o ndice de tokens da cadeia de eventos (evc_tkn_tab), sem percorrer a cadeia.
+*
+* Retorna ponteiro para uma cpia do elemento da cadeia de eventos que foi cancelado, ou NULL
+* se no encontrado.  A funo que chama deve cuidar de testar para NULL e liberar a cpia com
+* free, se necessrio.
 *
 */
 struct evchain *cancelp_tkn(int tkn)
+{
+	return (evChainDetach(evcTknCancel(tkn)));
+}
+
+/* Retira da cadeia de eventos o primeiro evento da token tkn e retorna o prprio elemento (do pool do kernel, devolvido com
+*  evChainFree), ou NULL se no encontrado; usada por cancelp_tkn e preemptp
+*/
+static struct evchain *evcTknCancel(int tkn)
 {
 
-	struct evchain *evc, *evc_tkn_srv;
+	struct evchain *evc_tkn_srv;
 
 	if ( tkn == 0 )
 	{
@@ -790,24 +1254,13 @@ struct evchain *cancelp_tkn(int tkn)
 		exit (1);
 	}
 
-	if ( (sim[sn].evc_begin == NULL) && (sim[sn].evc_end == NULL) )	/* Cadeia de eventos vazia */
+	if ( evChainIsEmpty() )	/* Cadeia de eventos vazia */
 	{
 		printf ("\nError - cancelp_tkn - empty event chain");
 		exit (1);
 	}
 
-	evc = sim[sn].evc_begin;
-	evc_tkn_srv = NULL;
-
-	while (evc != NULL)
-	{
-		if ( evc->ev_tkn == tkn)
-		{
-			evc_tkn_srv = evc;
-			break;
-		}
-		evc = evc->ev_next;
-	}
+	evc_tkn_srv = evcTknFind(tkn);	/* localiza o evento pelo ndice de tokens, sem percorrer a cadeia */
 
 	if ( evc_tkn_srv == NULL )	/* Nao achou tkn em servico na cadeia de eventos */
 	{
@@ -816,43 +1269,8 @@ struct evchain *cancelp_tkn(int tkn)
 		return NULL;
 	}
 
-	/* O elemento eh o primeiro e unico da cadeia de eventos */
-	if ((evc_tkn_srv->ev_previous == NULL) && (evc_tkn_srv->ev_next == NULL))
-	{
-		sim[sn].evc_begin = NULL;
-		sim[sn].evc_end = NULL;
-		return (evc_tkn_srv);
-	}
-
-	/* O elemento eh o primeiro e nao eh o unico da cadeia de eventos */
-	if ((evc_tkn_srv->ev_previous == NULL) && (evc_tkn_srv->ev_next != NULL))
-	{
-		sim[sn].evc_begin = evc_tkn_srv->ev_next;
-		evc_tkn_srv->ev_next->ev_previous = NULL;
-		return (evc_tkn_srv);
-	}
-
-	/* O elemento eh o ultimo da cadeia de eventos */
-	if ((evc_tkn_srv->ev_previous != NULL) && (evc_tkn_srv->ev_next == NULL))
-	{
-		sim[sn].evc_end = evc_tkn_srv->ev_previous;
-		evc_tkn_srv->ev_previous->ev_next = NULL;
-		return (evc_tkn_srv);
-	}
-
-	/* O elemento estah no meio da cadeia de eventos */
-	if ((evc_tkn_srv->ev_previous != NULL) && (evc_tkn_srv->ev_next != NULL))
-	{
-		evc_tkn_srv->ev_previous->ev_next = evc_tkn_srv->ev_next;
-		evc_tkn_srv->ev_next->ev_previous = evc_tkn_srv->ev_previous;
-		return (evc_tkn_srv);
-	}
-
-  /* Se chegar neste ponto siginifica que um erro imprevisto ocorreu e tem que ser analisado
-	   em detalhe */
-	printf ("\nError - cancelp_tkn - element could not be removed");
-	exit (1);
-
+	evcUnlink(evc_tkn_srv);
+	return (evc_tkn_srv);
 }
 
 /*-------CANCEL TOKEN WITH TOKEN POINTER - FC cancelp_ev ---------------------
@@ -862,27 +1280,28 @@ struct evchain *cancelp_tkn(int tkn)
 * A funo retirar a primeira ocorrncia do evento na cadeia, independente do nmero do
 * token envolvido.
 *
-* Retorna ponteiro para o elemento da cadeia de eventos que foi cancelado, ou NULL se no
-* encontrado.  A funo que chama deve cuidar de testar para NULL e eliminar o elemento da
-* memria com free, se necessrio.
+* Retorna ponteiro para uma cpia do elemento da cadeia de eventos que foi cancelado, ou NULL
+* se no encontrado.  A funo que chama deve cuidar de testar para NULL e liberar a cpia com
+* free, se necessrio.
 *
 * Nov2006 Marcos Portnoi.
 */
 struct evchain *cancelp_ev(int ev)
 {
+	struct simmContext *ctx = SIMM_CTX;
 
 	struct evchain *evc, *evc_elem;
 
-	if ( (sim[sn].evc_begin == NULL) && (sim[sn].evc_end == NULL) )	/* Cadeia de eventos vazia */
+	if ( evChainIsEmpty() )	/* Cadeia de eventos vazia */
 	{
 		printf ("\nError - cancelp_ev - empty event chain");
 		exit (1);
 	}
 
-	evc = sim[sn].evc_begin;
+	evc = ctx->sc_sim[ctx->sc_sn].evc_now_begin;	//eventos imediatos primeiro
 	evc_elem = NULL;
 
-	while (evc != NULL) //percorre a cadeia de eventos em busca da primeira ocorrncia de ev
+	while (evc != NULL) //percorre a fila de imediatos em busca da primeira ocorrncia de ev
 	{
 		if ( evc->ev_type == ev)
 		{
@@ -892,77 +1311,153 @@ struct evchain *cancelp_ev(int ev)
 		evc = evc->ev_next;
 	}
 
-	if ( evc_elem == NULL )	/* Nao achou elemento na cadeia com evento especificado */
-	{
-		return NULL;
-	}
+	if ( evc_elem == NULL )
+		evc = ctx->sc_sim[ctx->sc_sn].evc_begin;
 
-	/* O elemento eh o primeiro e unico da cadeia de eventos */
-	if ((evc_elem->ev_previous == NULL) && (evc_elem->ev_next == NULL))
+	while (evc != NULL && evc_elem == NULL) //percorre a cadeia de eventos em busca da primeira ocorrncia de ev
 	{
-		sim[sn].evc_begin = NULL;
-		sim[sn].evc_end = NULL;
-		return (evc_elem);
+		if ( evc->ev_type == ev)
+		{
+			evc_elem = evc;
+			break;
+		}
+		evc = evc->ev_next;
 	}
 
-	/* O elemento eh o primeiro e nao eh o unico da cadeia de eventos */
-	if ((evc_elem->ev_previous == NULL) && (evc_elem->ev_next != NULL))
-	{
-		sim[sn].evc_begin = evc_elem->ev_next;
-		evc_elem->ev_next->ev_previous = NULL;
-		return (evc_elem);
-	}
+	if ( evc_elem == NULL && ctx->sc_sim[ctx->sc_sn].evc_mode != EVC_LIST )	/* modos heap:  procura tambm fora do grupo de cabea */
+		evc_elem = evcHeapFind(ev);
 
-	/* O elemento eh o ultimo da cadeia de eventos */
-	if ((evc_elem->ev_previous != NULL) && (evc_elem->ev_next == NULL))
+	if ( evc_elem == NULL )	/* Nao achou elemento na cadeia com evento especificado */
 	{
-		sim[sn].evc_end = evc_elem->ev_previous;
-		evc_elem->ev_previous->ev_next = NULL;
-		return (evc_elem);
+		return NULL;
 	}
 
-	/* O elemento estah no meio da cadeia de eventos */
-	if ((evc_elem->ev_previous != NULL) && (evc_elem->ev_next != NULL))
-	{
-		evc_elem->ev_previous->ev_next = evc_elem->ev_next;
-		evc_elem->ev_next->ev_previous = evc_elem->ev_previous;
-		return (evc_elem);
-	}
+	evcUnlink(evc_elem);
+	return (evChainDetach(evc_elem));
+}
 
-  /* Se chegar neste ponto siginifica que um erro imprevisto ocorreu e tem que ser analisado
-	   em detalhe */
-	printf ("\nError - cancelp_ev - element could not be removed");
-	exit (1);
+/*-------------------  FILA DA FACILITY POR NVEL DE PRIORIDADE  -------------------
+*
+*  A fila de cada facility  mantida como uma fila FIFO por nvel de prioridade (f_q_head/f_q_tail, nveis 0 a FQ_LEVELS-1),
+*  mais um mapa de bits (f_q_bitmap) dos nveis no vazios; enfileirar, desenfileirar e reenfileirar uma token retirada
+*  por preempo so O(1).  Tokens com prioridade fora desta faixa vo para a lista f_queue, ordenada por prioridade como
+*  antes.  A ordem de atendimento  a mesma da fila nica original:  maior prioridade primeiro e, dentro da mesma
+*  prioridade, FIFO (enqueuep) ou  frente das demais (enqueuep_preempt).
+*/
 
+/* Retorna o maior nvel com bit ligado no mapa (no vazio) */
+static int fqTopLevel(unsigned long long bitmap)
+{
+#if defined(__GNUC__)
+	return (63 - __builtin_clzll(bitmap));
+#else
+	int p = 0;
+
+	if (bitmap >> 32) { bitmap >>= 32; p += 32; }
+	if (bitmap >> 16) { bitmap >>= 16; p += 16; }
+	if (bitmap >> 8) { bitmap >>= 8; p += 8; }
+	if (bitmap >> 4) { bitmap >>= 4; p += 4; }
+	if (bitmap >> 2) { bitmap >>= 2; p += 2; }
+	if (bitmap >> 1) p += 1;
+	return (p);
+#endif
 }
 
-/*-------ENQUEUE TOKEN PREEMPTED WITH TOKEN POINTER - FC enqueuep_preempt ---------------------*/
-/* Esta funo efetua a insero do elemento na fila priorizando a token em relacao s
-   demais e em relacao a tokens que tenham a mesma prioridade; ela ser servida antes das
-   demais com prioridade menor.
-   A prioridade segue a ordem nmerica:  quanto maior o nmero, maior a prioridade.
-   Assim, uma token com prioridade 5 dever ser desenfileirada antes de tokens com
-   prioridade menor ou igual a 5.
- */
-
-static void enqueuep_preempt (int f, int tkn, TOKEN *tkp, int pri, double te, int ev)
+/* Insere que na fila da facility:  aps as tokens de mesma prioridade (front = 0) ou antes delas (front = 1) */
+static void fqInsert(struct facilit *fct, struct fqueue *que, int front)
 {
-	struct facilit *fct;
-	struct fqueue *que, *que_actual, *que_previous;
+	struct fqueue **link;
+	int p = que->fq_pri;
 
-	if (tkn == 0)
+	if (p >= 0 && p < FQ_LEVELS)
 	{
-		printf ("\nError - enqueue_preempt - token = 0 ");
-		exit (1);
-	}
+		if (fct->f_q_head[p] == NULL)
+		{
+			que->fq_next = NULL;
+			fct->f_q_head[p] = fct->f_q_tail[p] = que;
+			fct->f_q_bitmap |= 1ULL << p;
+		}
+		else if (front)
+		{
+			que->fq_next = fct->f_q_head[p];
+			fct->f_q_head[p] = que;
+		}
+		else
+		{
+			que->fq_next = NULL;
+			fct->f_q_tail[p]->fq_next = que;
+			fct->f_q_tail[p] = que;
+		}
+		return;
+	}
+	/* prioridade fora da faixa:  busca na lista ordenada */
+	link = &fct->f_queue;
+	while (*link != NULL && ((*link)->fq_pri > p || ((*link)->fq_pri == p && !front)))
+		link = &(*link)->fq_next;
+	que->fq_next = *link;
+	*link = que;
+}
+
+/* Acumula as estatsticas da fila (produto tamanho x tempo, momentos no tempo, mdias de lotes) do intervalo desde a ltima mudana
+*  da fila; chamada imediatamente antes de cada mudana de f_n_length_q, que deve ser seguida da atualizao de f_last_ch_time_q */
+static void fqAccumulate(struct facilit *fct)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	double dt = ctx->sc_clock - fct->f_last_ch_time_q;
+
+	sumAdd(&fct->length_time_prod_sum, fct->f_n_length_q * dt);
+	momAdd(&fct->f_q_mom, fct->f_n_length_q, dt);
+	if (fct->f_bm != 0)
+		bmObserveWeighted(fct->f_bm, fct->f_n_length_q, dt);
+}
+
+/* Retira e retorna a prxima token a ser atendida na fila da facility (a fila no pode estar vazia) */
+static struct fqueue *fqRemoveFirst(struct facilit *fct)
+{
+	struct fqueue *que;
+	int p;
 
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
+	if (fct->f_queue != NULL && (fct->f_queue->fq_pri >= FQ_LEVELS || fct->f_q_bitmap == 0))
+	{
+		que = fct->f_queue;
+		fct->f_queue = que->fq_next;
+		return (que);
+	}
+	p = fqTopLevel(fct->f_q_bitmap);
+	que = fct->f_q_head[p];
+	fct->f_q_head[p] = que->fq_next;
+	if (fct->f_q_head[p] == NULL)
 	{
-		fct=fct->fct_next;
+		fct->f_q_tail[p] = NULL;
+		fct->f_q_bitmap &= ~(1ULL << p);
 	}
+	return (que);
+}
+
+/*-------ENQUEUE TOKEN PREEMPTED WITH TOKEN POINTER - FC enqueuep_preempt ---------------------*/
+/* Esta funo efetua a insero do elemento na fila priorizando a token em relacao s
+   demais e em relacao a tokens que tenham a mesma prioridade; ela ser servida antes das
+   demais com prioridade menor.
+   A prioridade segue a ordem nmerica:  quanto maior o nmero, maior a prioridade.
+   Assim, uma token com prioridade 5 dever ser desenfileirada antes de tokens com
+   prioridade menor ou igual a 5.
+ */
 
-	fct->length_time_prod_sum += fct->f_n_length_q * (clock - fct->f_last_ch_time_q);
+static void enqueuep_preempt (int f, int tkn, TOKEN *tkp, int pri, double te, int ev)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct facilit *fct;
+	struct fqueue *que;
+
+	if (tkn == 0)
+	{
+		printf ("\nError - enqueue_preempt - token = 0 ");
+		exit (1);
+	}
+
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
+
+	fqAccumulate(fct);
 	fct->f_n_length_q++;
 
 	/* O caso de uma token que foi retirada de servio por uma token que chama a preempo
@@ -975,14 +1470,9 @@ static void enqueuep_preempt (int f, int tkn, TOKEN *tkp, int pri, double te, in
 		fct->f_max_queue = fct->f_n_length_q;
 	}
 
-	fct->f_last_ch_time_q = clock;
+	fct->f_last_ch_time_q = ctx->sc_clock;
 
-	que = (fqueue*)malloc(sizeof *que);
-	if (que == NULL)
-	{
-		printf ("\nError - enqueue - insufficient memory to allocate for facility queue");
-		exit (1);
-	}
+	que = (fqueue*)poolAlloc(&ctx->sc_pools[POOL_FQUEUE]);
 
 	que->fq_ev	= ev;
 	que->fq_tkn = tkn;
@@ -1000,57 +1490,7 @@ static void enqueuep_preempt (int f, int tkn, TOKEN *tkp, int pri, double te, in
 	//enqueuep_preempt:  insere na fila por ordem de prioridade, e antes dos tokens com mesma prioridade
 	//H alguma situao onde a prioridade deve ser desconsiderada para enfileirar? (Marcos Portnoi em 21-Dez-2005)
 
-	if (fct->f_queue == NULL) //fila da facility est vazia; o token enfileirado ser o primeiro, retorne da funo imediatamente
-	{
-		fct->f_queue = que; /* Campo f_queue da facility aponta para a queue */
-		return;
-	}
-
-	//h fila na facility; vejamos em que posio deveremos inserir o novo token
-	que_actual = fct->f_queue;
-	que_previous = NULL;
-
-	while (que_actual != NULL) /*faz uma busca na fila existente por prioridade:  ao achar uma token com prioridade maior ou igual  da
-							   da token a enfileirar, pra a busca; a token dever ser inserida antes de que_actual.*/
-	{
-		if (( pri > que_actual->fq_pri) || (pri == que_actual->fq_pri)) break;
-		que_previous = que_actual;
-		que_actual = que_actual->fq_next;
-	}
-
-	/* Situacoes possveis:
-	 . Estar no inicio da fila
-	 . Estar no meio da fila
-	 . Estar no fim da fila */
-
-	/* Estando no inicio da fila */
-
-	if (que_previous == NULL)
-	{
-		fct->f_queue = que;
-		que->fq_next = que_actual;
-		return;
-	}
-
-	/* Estando no fim da fila */
-
-	if (que_actual == NULL)
-	{
-		que_previous->fq_next = que;
-		return;
-	}
-
-	/* Estando no meio da fila */
-
-	if ( (que_actual != NULL) && (que_previous != NULL) )
-	{
-		que_previous->fq_next = que;
-		que->fq_next = que_actual;
-		return;
-	}
-
-	printf ("\nError - enqueuep_preempt - element could not be inserted into facility queue");
-	exit (1);
+	fqInsert(fct, que, 1);	//incio da fila do nvel de prioridade da token
 }
 
 /*-------ENQUEUE TOKEN WITH TOKEN POINTER - FC enqueuep---------------------*/
@@ -1068,8 +1508,9 @@ static void enqueuep_preempt (int f, int tkn, TOKEN *tkp, int pri, double te, in
 
 static void enqueuep (int f, int tkn, TOKEN *tkp, int pri, double te, int ev)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
-	struct fqueue *que, *que_aux, *que_aux_next;
+	struct fqueue *que;
 
 	if ( tkn == 0 )
 	{
@@ -1077,13 +1518,9 @@ static void enqueuep (int f, int tkn, TOKEN *tkp, int pri, double te, int ev)
 		exit (1);
 	}
 
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 
-	fct->length_time_prod_sum += fct->f_n_length_q * (clock - fct->f_last_ch_time_q);
+	fqAccumulate(fct);
 	fct->f_n_length_q++;
 
 	if (fct->f_n_length_q > fct->f_max_queue)	/* Atualiza tamanho maximo da fila*/
@@ -1091,14 +1528,9 @@ static void enqueuep (int f, int tkn, TOKEN *tkp, int pri, double te, int ev)
 		fct->f_max_queue = fct->f_n_length_q;
 	}
 
-	fct->f_last_ch_time_q = clock;
+	fct->f_last_ch_time_q = ctx->sc_clock;
 
-	que = (fqueue*)malloc(sizeof *que);
-	if (que == NULL)
-	{
-		printf ("\nError - enqueue - insufficient memory to allocate for facility queue");
-		exit (1);
-	}
+	que = (fqueue*)poolAlloc(&ctx->sc_pools[POOL_FQUEUE]);
 
 	que->fq_ev	= ev;
 	que->fq_tkn = tkn;
@@ -1115,34 +1547,7 @@ static void enqueuep (int f, int tkn, TOKEN *tkp, int pri, double te, int ev)
 	
 	//H alguma situao onde a prioridade deve ser desconsiderada no enfileiramento?
 
-	if (fct->f_queue == NULL) //No h nenhuma fila ainda; ento crie a fila com o novo token e saia.
-	{
-		fct->f_queue = que;						// Campo f_queue da facility aponta para a queue
-	}
-	else
-	{
-		//Aqui, que_aux indicar o elemento imediatamente anterior ao ponto de insero, e que_aux_next, o elemento logo aps (ou NULL)
-		que_aux = fct->f_queue;
-		que_aux_next = que_aux->fq_next;
-		while (que_aux_next != NULL)
-		{
-			if (que_aux_next->fq_pri >= que->fq_pri) {
-				que_aux=que_aux_next;
-				que_aux_next=que_aux_next->fq_next;
-			}
-			else break;
-		}
-		//O ponteiro que_aux indica a posio imediatamente anterior aonde deve ser inserido o novo token na fila,
-		//exceto se houver apenas 1 elemento na fila.  Neste caso, o teste seguinte resolver se o novo elemento deve
-		//ser inserido antes ou depois de que_aux.
-		if (que_aux->fq_pri < que->fq_pri) { //Se o teste for positivo, certamente que_aux  o nico elemento na fila
-			que->fq_next=que_aux;
-			fct->f_queue=que; //j que que_aux era o nico elemento na fila, atualize o ponteiro para o primeiro elemento (que, inserido antes de que_aux)
-		} else { //teste negativo; insira ento DEPOIS de que_aux (aqui  irrelevante a fila s ter um elemento ou no)
-			que->fq_next = que_aux->fq_next;
-			que_aux->fq_next=que;
-		}
-	}
+	fqInsert(fct, que, 0);	//final da fila do nvel de prioridade da token
 	return;
 }
 
@@ -1150,10 +1555,10 @@ static void enqueuep (int f, int tkn, TOKEN *tkp, int pri, double te, int ev)
 /*-------RELEASE FACILITY  WITH TOKEN POINTER - FC releasep ----------------*/
 void releasep (int f, int tkn)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
 	struct fserv *srv;
 	struct fqueue *que;
-	int tkn_not_serv;
 
 	if ( tkn == 0 )
 	{
@@ -1161,58 +1566,44 @@ void releasep (int f, int tkn)
 		exit (1);
 	}
 
-	if ( f > sim[sn].fct_number)
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - releasep - facility number does not exist");
 		exit (1);
 	}
 
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
-
-	srv = fct->f_serv;
-	tkn_not_serv = 1;
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 
-	while (srv != NULL)
-	{
-		if (srv->fs_tkn == tkn)
-		{
-			tkn_not_serv = 0;
-			break;
-		}
-		srv = srv->fs_next;
-	}
+	srv = srvFind(fct, tkn);	/* servidor que atende a token, pela tabela token -> servidor */
 
-	if (tkn_not_serv)
+	if (srv == NULL)
 	{
 		printf ("\nError - releasep - token to be released not in service in this server");
 		exit (1);
 	}
 
 	/* Atualiza estatisticas do servidor */
+	srvStop(fct, srv);
 	srv->fs_tkn = 0;
 	srv->fs_p_tkn = 0;
 	srv->fs_release_count++;
-	srv->fs_busy_time = srv->fs_busy_time + ( clock - srv->fs_start ); /*Acumula tempo uso serv */
+	sumAdd(&srv->fs_busy_time, ctx->sc_clock - srv->fs_start); /*Acumula tempo uso serv */
 
 	/* Atualiza estatisticas da facility */
-	fct->f_busy_time = fct->f_busy_time + ( clock - srv->fs_start );
+	sumAdd(&fct->f_busy_time, ctx->sc_clock - srv->fs_start);
+	momAdd(&fct->f_s_mom, ctx->sc_clock - srv->fs_start, 1.0);
 	fct->f_release_count++;
 	fct->f_n_busy_serv--;
 
 	if ( fct->f_n_length_q > 0 )
 	{
     /* queue not empty:  dequeue request & update queue measures */
-		que = fct->f_queue;
+		que = fqRemoveFirst(fct);
 
-		fct->f_queue = que->fq_next;
-		fct->length_time_prod_sum += fct->f_n_length_q * (clock - fct->f_last_ch_time_q);
+		fqAccumulate(fct);
 		fct->f_n_length_q--;
 		fct->f_exit_count_q++;
-		fct->f_last_ch_time_q = clock;
+		fct->f_last_ch_time_q = ctx->sc_clock;
 
 		/* Seria bom uma modificao aqui?   conveniente que a token em fila seja colocada no incio da cadeia de eventos, e
 		*  no imediatamente escalonada para servio.  Assim, permite-se que a rotina de tratamento de eventos trate as tokens
@@ -1237,9 +1628,7 @@ void releasep (int f, int tkn)
 		   e eh escalonado o tempo de termino de servico desta token */
 
 		// Atualiza servidor que pega a token que estava na fila
-		srv->fs_tkn = que->fq_tkn;
-		srv->fs_p_tkn = que->fq_pri;
-		srv->fs_start = clock;
+		srvStart(fct, srv, que->fq_tkn, que->fq_pri);
 
 		/* Atualiza a facility associada ao servidor */
 		fct->f_n_busy_serv++;
@@ -1247,8 +1636,806 @@ void releasep (int f, int tkn)
 
 		schedulep(que->fq_ev, que->fq_time, que->fq_tkn, que->fq_tkp); /* Escalona termino do servico */
 
-		free(que);
+		poolFree(&ctx->sc_pools[POOL_FQUEUE], que);
+	}
+	else
+	{
+		srvHeapInsert(fct, fct->f_idle, &fct->f_n_idle, srv);	/* servidor volta para os livres */
+	}
+}
+
+/*-------------------  CONJUNTO DE EVENTOS FUTUROS (MODOS HEAP)  -------------------
+*
+*  Nos modos EVC_HEAP4 e EVC_PAIRING, a cadeia evc_begin..evc_end contm somente o grupo de cabea, isto , todos os
+*  eventos pendentes com o menor tempo de ocorrncia, na mesma ordem em que a lista original os teria.  Os demais eventos
+*  ficam num heap, ordenados por (ev_time, ev_seq).  Como a lista original s altera a ordem FIFO de eventos de mesmo
+*  tempo no grupo de cabea (um evento com tempo igual ao do primeiro elemento  inserido logo aps este), o conjunto
+*  produz exatamente a mesma seqncia de eventos que a lista, em qualquer modo.
+*  Quando um evento com tempo menor que o do grupo de cabea  escalonado, o grupo inteiro volta para o heap com novos
+*  nmeros de seqncia, preservando sua ordem; quando o grupo esvazia, o prximo grupo  retirado do heap.
+*/
+
+/* Retorna 1 se o evento a deve ocorrer antes do evento b */
+static int evcBefore(struct evchain *a, struct evchain *b)
+{
+	if (a->ev_time != b->ev_time)
+		return (a->ev_time < b->ev_time);
+	return (a->ev_seq < b->ev_seq);
+}
+
+/* HEAP 4-RIO:  filhos do elemento i esto nas posies 4i+1 a 4i+4 */
+static void heap4Place(int i, struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	ctx->sc_sim[ctx->sc_sn].evc_heap[i] = evc;
+	evc->ev_pos = i;
+}
+
+static void heap4SiftUp(int i)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct evchain *evc = ctx->sc_sim[ctx->sc_sn].evc_heap[i];
+	int parent;
+
+	while (i > 0)
+	{
+		parent = (i - 1) / 4;
+		if (!evcBefore(evc, ctx->sc_sim[ctx->sc_sn].evc_heap[parent]))
+			break;
+		heap4Place(i, ctx->sc_sim[ctx->sc_sn].evc_heap[parent]);
+		i = parent;
+	}
+	heap4Place(i, evc);
+}
+
+static void heap4SiftDown(int i)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct evchain *evc = ctx->sc_sim[ctx->sc_sn].evc_heap[i];
+	int child, c, last, best;
+
+	while (1)
+	{
+		child = 4*i + 1;
+		if (child >= ctx->sc_sim[ctx->sc_sn].evc_heap_n)
+			break;
+		last = child + 4 < ctx->sc_sim[ctx->sc_sn].evc_heap_n ? child + 4 : ctx->sc_sim[ctx->sc_sn].evc_heap_n;
+		best = child;
+		for (c = child + 1; c < last; c++)
+			if (evcBefore(ctx->sc_sim[ctx->sc_sn].evc_heap[c], ctx->sc_sim[ctx->sc_sn].evc_heap[best]))
+				best = c;
+		if (!evcBefore(ctx->sc_sim[ctx->sc_sn].evc_heap[best], evc))
+			break;
+		heap4Place(i, ctx->sc_sim[ctx->sc_sn].evc_heap[best]);
+		i = best;
+	}
+	heap4Place(i, evc);
+}
+
+static void heap4Insert(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct evchain **aux;
+
+	if (ctx->sc_sim[ctx->sc_sn].evc_heap_n == ctx->sc_sim[ctx->sc_sn].evc_heap_size)
+	{
+		ctx->sc_sim[ctx->sc_sn].evc_heap_size = ctx->sc_sim[ctx->sc_sn].evc_heap_size == 0 ? 1024 : 2 * ctx->sc_sim[ctx->sc_sn].evc_heap_size;
+		aux = (struct evchain**)realloc(ctx->sc_sim[ctx->sc_sn].evc_heap, ctx->sc_sim[ctx->sc_sn].evc_heap_size * sizeof *aux);
+		if (aux == NULL)
+		{
+			printf ("\nError - heap4Insert - insufficient memory to allocate for event heap");
+			exit (1);
+		}
+		ctx->sc_sim[ctx->sc_sn].evc_heap = aux;
+	}
+	heap4Place(ctx->sc_sim[ctx->sc_sn].evc_heap_n, evc);
+	ctx->sc_sim[ctx->sc_sn].evc_heap_n++;
+	heap4SiftUp(evc->ev_pos);
+}
+
+static void heap4Remove(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	int i = evc->ev_pos;
+
+	ctx->sc_sim[ctx->sc_sn].evc_heap_n--;
+	if (i == ctx->sc_sim[ctx->sc_sn].evc_heap_n)
+		return;
+	heap4Place(i, ctx->sc_sim[ctx->sc_sn].evc_heap[ctx->sc_sim[ctx->sc_sn].evc_heap_n]);	/* o ltimo elemento ocupa a posio liberada */
+	if (i > 0 && evcBefore(ctx->sc_sim[ctx->sc_sn].evc_heap[i], ctx->sc_sim[ctx->sc_sn].evc_heap[(i - 1) / 4]))
+		heap4SiftUp(i);
+	else
+		heap4SiftDown(i);
+}
+
+/* PAIRING HEAP:  ev_child aponta o primeiro filho; ev_next aponta o prximo irmo; ev_previous aponta o irmo anterior
+*  ou, para o primeiro filho, o pai */
+static struct evchain *pheapMeld(struct evchain *a, struct evchain *b)
+{
+	struct evchain *aux;
+
+	if (a == NULL) return b;
+	if (b == NULL) return a;
+	if (evcBefore(b, a))
+	{
+		aux = a; a = b; b = aux;
+	}
+	b->ev_next = a->ev_child;
+	if (a->ev_child != NULL)
+		a->ev_child->ev_previous = b;
+	b->ev_previous = a;
+	a->ev_child = b;
+	return a;
+}
+
+/* Junta a lista de irmos iniciada em first em um nico heap (mtodo de duas passadas) */
+static struct evchain *pheapMergePairs(struct evchain *first)
+{
+	struct evchain *a, *b, *next, *pairs = NULL, *root = NULL;
+
+	while (first != NULL)	/* 1a passada:  junta os irmos dois a dois, da esquerda para a direita */
+	{
+		a = first;
+		b = a->ev_next;
+		next = b == NULL ? NULL : b->ev_next;
+		a->ev_next = a->ev_previous = NULL;
+		if (b != NULL)
+		{
+			b->ev_next = b->ev_previous = NULL;
+			a = pheapMeld(a, b);
+		}
+		a->ev_next = pairs;		/* empilha o resultado; o topo ser o par mais  direita */
+		pairs = a;
+		first = next;
+	}
+	while (pairs != NULL)	/* 2a passada:  junta os pares da direita para a esquerda */
+	{
+		next = pairs->ev_next;
+		pairs->ev_next = NULL;
+		root = pheapMeld(root, pairs);
+		pairs = next;
+	}
+	return root;
+}
+
+static void pheapRemove(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct evchain *sub;
+
+	if (evc != ctx->sc_sim[ctx->sc_sn].evc_pheap)	/* desliga a subrvore de evc de seu pai ou irmo anterior */
+	{
+		if (evc->ev_previous->ev_child == evc)
+			evc->ev_previous->ev_child = evc->ev_next;
+		else
+			evc->ev_previous->ev_next = evc->ev_next;
+		if (evc->ev_next != NULL)
+			evc->ev_next->ev_previous = evc->ev_previous;
+		evc->ev_next = evc->ev_previous = NULL;
+	}
+	sub = pheapMergePairs(evc->ev_child);
+	evc->ev_child = NULL;
+	if (evc == ctx->sc_sim[ctx->sc_sn].evc_pheap)
+		ctx->sc_sim[ctx->sc_sn].evc_pheap = sub;
+	else
+		ctx->sc_sim[ctx->sc_sn].evc_pheap = pheapMeld(ctx->sc_sim[ctx->sc_sn].evc_pheap, sub);
+}
+
+/* CALENDAR QUEUE:  ver struct calqueue em simm_types.h */
+#define CQ_COST_LIMIT	4		/* custo mdio por operao (buckets ou elementos percorridos) acima do qual a largura  ajustada */
+#define CQ_MIN_WIDTH	1e-9	/* largura mnima dos buckets */
+#define CQ_MAX_WIDTH	1e9		/* largura mxima dos buckets */
+#define CQ_MAX_VB		((long long)1 << 62)	/* maior bucket virtual; tempos alm dele ficam todos neste bucket virtual */
+#define CQ_SHRINK		4		/* o nmero de buckets cai  metade com menos de 1 evento por CQ_SHRINK buckets (e dobra com mais de 2 eventos
+								   por bucket); a distncia entre os dois limites evita redimensionar a cada oscilao do nmero de eventos */
+#define CQ_MAX_WIN_MULT	64		/* limite para o crescimento da janela de avaliao (em mltiplos do nmero de buckets) */
+
+static long long calqVb(struct calqueue *cq, double t)
+{
+	double vb = t / cq->cq_width;
+
+	return (vb < (double)CQ_MAX_VB ? (long long)vb : CQ_MAX_VB);	/* a converso de um valor fora da faixa de long long  indefinida */
+}
+
+/* Insere evc no bucket correspondente, em ordem de (ev_time, ev_seq), procurando a partir do final do bucket (como na
+*  lista original, pois evc tem a maior seqncia); retorna o nmero de elementos percorridos */
+static int calqPlace(struct calqueue *cq, struct evchain *evc)
+{
+	long long vb = calqVb(cq, evc->ev_time);
+	struct evchain *aux, *next = NULL;
+	int walk = 0;
+
+	evc->ev_pos = (int)(vb % cq->cq_nb);
+	aux = cq->cq_tail[evc->ev_pos];
+	while (aux != NULL && evcBefore(evc, aux))
+	{
+		next = aux;
+		aux = aux->ev_previous;
+		walk++;
+	}
+	evc->ev_previous = aux;
+	evc->ev_next = next;
+	if (aux != NULL)
+		aux->ev_next = evc;
+	else
+		cq->cq_bucket[evc->ev_pos] = evc;
+	if (next != NULL)
+		next->ev_previous = evc;
+	else
+		cq->cq_tail[evc->ev_pos] = evc;
+	if (vb < cq->cq_vb)
+		cq->cq_vb = vb;
+	return walk;
+}
+
+/* Largura dos buckets:  trs vezes a mdia dos intervalos observados, descartados os maiores que duas vezes a mdia (Brown).
+*  A largura corrente  mantida se a nova estiver a menos de um fator 2 dela (os redimensionamentos s mudam o nmero de buckets),
+*  ou se a nova no for um valor finito entre CQ_MIN_WIDTH e CQ_MAX_WIDTH (por exemplo, intervalos todos nulos). */
+static double calqNewWidth(struct calqueue *cq)
+{
+	int i, n, k;
+	double sum, mean;
+
+	n = cq->cq_ngaps < CQ_GAPS ? cq->cq_ngaps : CQ_GAPS;
+	if (n == 0)
+		return cq->cq_width;
+	for (sum = 0.0, i = 0; i < n; i++)
+		sum += cq->cq_gap[i];
+	mean = sum / n;
+	for (sum = 0.0, k = 0, i = 0; i < n; i++)
+		if (cq->cq_gap[i] <= 2.0 * mean)
+		{
+			sum += cq->cq_gap[i];
+			k++;
+		}
+	if (k > 0)
+		mean = sum / k;
+	mean *= 3.0;
+	if (!(mean >= CQ_MIN_WIDTH && mean <= CQ_MAX_WIDTH))	/* tambm rejeita NaN */
+		return cq->cq_width;
+	if (mean > 0.5 * cq->cq_width && mean < 2.0 * cq->cq_width)
+		return cq->cq_width;
+	return mean;
+}
+
+/* Redistribui os eventos em nb buckets de largura width */
+static void calqResize(struct calqueue *cq, int nb, double width)
+{
+	struct evchain **old = cq->cq_bucket, *evc, *next;
+	int i, oldnb = cq->cq_nb;
+
+	cq->cq_bucket = (struct evchain**)malloc(nb * sizeof *cq->cq_bucket);
+	free(cq->cq_tail);
+	cq->cq_tail = (struct evchain**)malloc(nb * sizeof *cq->cq_tail);
+	if (cq->cq_bucket == NULL || cq->cq_tail == NULL)
+	{
+		printf ("\nError - calqResize - insufficient memory to allocate for calendar queue");
+		exit (1);
+	}
+	for (i = 0; i < nb; i++)
+		cq->cq_bucket[i] = cq->cq_tail[i] = NULL;
+	if (!(width >= CQ_MIN_WIDTH))	/* limita o nmero do bucket virtual (tempo/largura); tambm rejeita NaN */
+		width = CQ_MIN_WIDTH;
+	else if (width > CQ_MAX_WIDTH)
+		width = CQ_MAX_WIDTH;
+	if (nb != oldnb)
+		cq->cq_resizes++;
+	else
+		cq->cq_recalibrations++;
+	cq->cq_nb = nb;
+	cq->cq_width = width;
+	cq->cq_vb = LLONG_MAX;
+	for (i = 0; i < oldnb; i++)
+		for (evc = old[i]; evc != NULL; evc = next)
+		{
+			next = evc->ev_next;
+			calqPlace(cq, evc);
+		}
+	free(old);
+	if (cq->cq_n == 0)
+		cq->cq_vb = 0;
+	cq->cq_win_ops = 0;
+	cq->cq_win_scan = cq->cq_win_walk = 0;
+}
+
+/* Contabiliza o custo de uma operao (scan:  buckets percorridos para achar o menor evento; walk:  elementos percorridos numa
+*  insero).  Ao fim de cada janela de operaes, se o custo mdio foi alto, a largura  dobrada (muitos buckets vazios
+*  percorridos) ou reduzida  metade (buckets com muitos elementos).  Se o ajuste inverte o anterior, a distribuio dos
+*  tempos no favorece nenhuma das larguras, e a janela  dobrada para no se redistribuir os eventos a todo momento;
+*  cada janela sem ajuste a reduz  metade. */
+static void calqCost(struct calqueue *cq, int scan, int walk)
+{
+	int dir;
+
+	cq->cq_win_ops++;
+	cq->cq_win_scan += scan;
+	cq->cq_win_walk += walk;
+	if (cq->cq_win_ops >= cq->cq_nb * cq->cq_win_mult)
+	{
+		if (cq->cq_win_scan + cq->cq_win_walk > (long long)CQ_COST_LIMIT * cq->cq_win_ops && cq->cq_n > 1)
+		{
+			dir = cq->cq_win_scan > cq->cq_win_walk ? 1 : -1;
+			if (dir == -cq->cq_last_dir && cq->cq_win_mult < CQ_MAX_WIN_MULT)
+				cq->cq_win_mult *= 2;
+			cq->cq_last_dir = dir;
+			calqResize(cq, cq->cq_nb, dir > 0 ? 2.0 * cq->cq_width : 0.5 * cq->cq_width);
+		}
+		else if (cq->cq_win_mult > 1)	/* janela sem ajuste:  a janela volta a diminuir gradualmente */
+			cq->cq_win_mult /= 2;
+		cq->cq_win_ops = 0;
+		cq->cq_win_scan = cq->cq_win_walk = 0;
+	}
+}
+
+static void calqInsert(struct calqueue *cq, struct evchain *evc)
+{
+	int walk;
+
+	if (cq->cq_bucket == NULL)
+	{
+		cq->cq_nb = 0;	/* fora a alocao inicial dos buckets */
+		cq->cq_win_mult = 1;
+		calqResize(cq, CQ_MIN_BUCKETS, cq->cq_width);
+		cq->cq_resizes = 0;
+	}
+	walk = calqPlace(cq, evc);
+	cq->cq_n++;
+	if (cq->cq_n > cq->cq_peak_n)
+		cq->cq_peak_n = cq->cq_n;
+	if (cq->cq_min != NULL && evcBefore(evc, cq->cq_min))
+		cq->cq_min = evc;
+	cq->cq_inserts++;
+	cq->cq_walk += walk;
+	if (cq->cq_n > 2 * cq->cq_nb)
+		calqResize(cq, 2 * cq->cq_nb, calqNewWidth(cq));
+	else
+		calqCost(cq, 0, walk);
+}
+
+static struct evchain *calqMin(struct calqueue *cq)
+{
+	struct evchain *evc;
+	int i, scans = 0;
+
+	if (cq->cq_n == 0)
+		return NULL;
+	if (cq->cq_min != NULL)
+		return cq->cq_min;
+	for (i = 0; i < cq->cq_nb; i++, cq->cq_vb++, scans++)	/* percorre um ano de buckets a partir do bucket virtual corrente */
+	{
+		evc = cq->cq_bucket[(int)(cq->cq_vb % cq->cq_nb)];
+		if (evc != NULL && calqVb(cq, evc->ev_time) == cq->cq_vb)
+		{
+			cq->cq_min = evc;
+			break;
+		}
+	}
+	if (cq->cq_min == NULL)	/* ano sem eventos:  busca direta entre os primeiros elementos dos buckets */
+	{
+		for (i = 0; i < cq->cq_nb; i++)
+		{
+			evc = cq->cq_bucket[i];
+			if (evc != NULL && (cq->cq_min == NULL || evcBefore(evc, cq->cq_min)))
+				cq->cq_min = evc;
+		}
+		cq->cq_vb = calqVb(cq, cq->cq_min->ev_time);
+		cq->cq_direct++;
+	}
+	if (cq->cq_min->ev_time >= cq->cq_last)	/* guarda o intervalo observado para o clculo da largura */
+	{
+		if (cq->cq_mins > 0)
+		{
+			cq->cq_gap[cq->cq_ngaps % CQ_GAPS] = cq->cq_min->ev_time - cq->cq_last;
+			if (++cq->cq_ngaps == 2 * CQ_GAPS)	/* evita estouro do contador; o vetor j est cheio */
+				cq->cq_ngaps = CQ_GAPS;
+		}
+		cq->cq_last = cq->cq_min->ev_time;
+	}
+	cq->cq_mins++;
+	cq->cq_scans += scans;
+	calqCost(cq, scans, 0);
+	return cq->cq_min;
+}
+
+static void calqRemove(struct calqueue *cq, struct evchain *evc)
+{
+	if (evc->ev_previous != NULL)
+		evc->ev_previous->ev_next = evc->ev_next;
+	else
+		cq->cq_bucket[evc->ev_pos] = evc->ev_next;
+	if (evc->ev_next != NULL)
+		evc->ev_next->ev_previous = evc->ev_previous;
+	else
+		cq->cq_tail[evc->ev_pos] = evc->ev_previous;
+	evc->ev_next = evc->ev_previous = NULL;
+	if (evc == cq->cq_min)
+		cq->cq_min = NULL;
+	cq->cq_n--;
+	if (cq->cq_n < cq->cq_nb / CQ_SHRINK && cq->cq_nb > CQ_MIN_BUCKETS)
+		calqResize(cq, cq->cq_nb / 2, calqNewWidth(cq));
+}
+
+/* Operaes genricas sobre o heap (ou calendar queue) do modo corrente */
+static void evcHeapInsert(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	evc->ev_seq = ctx->sc_sim[ctx->sc_sn].evc_seq++;
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_HEAP4)
+		heap4Insert(evc);
+	else if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_CALENDAR)
+		calqInsert(&ctx->sc_sim[ctx->sc_sn].evc_cal, evc);
+	else
+	{
+		evc->ev_next = evc->ev_previous = evc->ev_child = NULL;
+		ctx->sc_sim[ctx->sc_sn].evc_pheap = pheapMeld(ctx->sc_sim[ctx->sc_sn].evc_pheap, evc);
+	}
+}
+
+static struct evchain *evcHeapMin()
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_HEAP4)
+		return ctx->sc_sim[ctx->sc_sn].evc_heap_n == 0 ? NULL : ctx->sc_sim[ctx->sc_sn].evc_heap[0];
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_CALENDAR)
+		return calqMin(&ctx->sc_sim[ctx->sc_sn].evc_cal);
+	return ctx->sc_sim[ctx->sc_sn].evc_pheap;
+}
+
+static int evcHeapEmpty()
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_HEAP4)
+		return (ctx->sc_sim[ctx->sc_sn].evc_heap_n == 0);
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_CALENDAR)
+		return (ctx->sc_sim[ctx->sc_sn].evc_cal.cq_n == 0);
+	return (ctx->sc_sim[ctx->sc_sn].evc_pheap == NULL);
+}
+
+static void evcHeapRemove(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_HEAP4)
+		heap4Remove(evc);
+	else if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_CALENDAR)
+		calqRemove(&ctx->sc_sim[ctx->sc_sn].evc_cal, evc);
+	else
+		pheapRemove(evc);
+}
+
+/* Procura no heap o evento mais prximo (menor tempo e seqncia) do tipo ev; retorna NULL se no encontrado.  A busca
+*  percorre todo o heap, como a busca na lista. */
+static struct evchain *evcHeapFind(int ev)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct evchain *evc, *found = NULL;
+	int i;
+
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_HEAP4)
+	{
+		for (i = 0; i < ctx->sc_sim[ctx->sc_sn].evc_heap_n; i++)
+		{
+			evc = ctx->sc_sim[ctx->sc_sn].evc_heap[i];
+			if (evc->ev_type == ev && (found == NULL || evcBefore(evc, found)))
+				found = evc;
+		}
+		return found;
+	}
+
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_CALENDAR)
+	{
+		for (i = 0; i < ctx->sc_sim[ctx->sc_sn].evc_cal.cq_nb; i++)
+			for (evc = ctx->sc_sim[ctx->sc_sn].evc_cal.cq_bucket[i]; evc != NULL; evc = evc->ev_next)
+				if (evc->ev_type == ev && (found == NULL || evcBefore(evc, found)))
+					found = evc;
+		return found;
+	}
+
+	evc = ctx->sc_sim[ctx->sc_sn].evc_pheap;	/* percorre a rvore em pr-ordem, sem recurso */
+	while (evc != NULL)
+	{
+		if (evc->ev_type == ev && (found == NULL || evcBefore(evc, found)))
+			found = evc;
+		if (evc->ev_child != NULL)
+			evc = evc->ev_child;
+		else
+		{
+			while (evc != NULL && evc->ev_next == NULL)	/* sobe at um ancestral que tenha prximo irmo */
+			{
+				while (evc->ev_previous != NULL && evc->ev_previous->ev_child != evc)
+					evc = evc->ev_previous;
+				evc = evc->ev_previous;
+			}
+			if (evc != NULL)
+				evc = evc->ev_next;
+		}
+	}
+	return found;
+}
+
+/* Grupo de cabea ficou vazio:  retira do heap todos os eventos com o prximo menor tempo, na ordem de seqncia */
+static void evcPromote()
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct evchain *evc;
+	double t;
+
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_LIST || evcHeapEmpty())
+		return;
+	t = evcHeapMin()->ev_time;
+	while ((evc = evcHeapMin()) != NULL && evc->ev_time == t)
+	{
+		evcHeapRemove(evc);
+		evc->ev_next = NULL;
+		evc->ev_previous = ctx->sc_sim[ctx->sc_sn].evc_end;
+		if (ctx->sc_sim[ctx->sc_sn].evc_end == NULL)
+			ctx->sc_sim[ctx->sc_sn].evc_begin = evc;
+		else
+			ctx->sc_sim[ctx->sc_sn].evc_end->ev_next = evc;
+		ctx->sc_sim[ctx->sc_sn].evc_end = evc;
+	}
+}
+
+/* Insere um evento no conjunto, nos modos heap (chamada por schedulep) */
+static void evcHeapSchedule(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct evchain *head = ctx->sc_sim[ctx->sc_sn].evc_begin, *aux;
+
+	if (head == NULL)	/* conjunto vazio:  evc forma o grupo de cabea */
+	{
+		evc->ev_next = evc->ev_previous = NULL;
+		ctx->sc_sim[ctx->sc_sn].evc_begin = ctx->sc_sim[ctx->sc_sn].evc_end = evc;
+		return;
+	}
+	if (evc->ev_time > head->ev_time)
+	{
+		evcHeapInsert(evc);
+		return;
+	}
+	if (evc->ev_time == head->ev_time)
+	{
+		if (evcHeapEmpty() || ctx->sc_sim[ctx->sc_sn].evc_now_begin != NULL)	/* todos os eventos tm o mesmo tempo, ou evc no tem o tempo do
+															   primeiro da cadeia (fila de imediatos):  a lista acrescentaria ao final do grupo */
+		{
+			evc->ev_next = NULL;
+			evc->ev_previous = ctx->sc_sim[ctx->sc_sn].evc_end;
+			ctx->sc_sim[ctx->sc_sn].evc_end->ev_next = evc;
+			ctx->sc_sim[ctx->sc_sn].evc_end = evc;
+		}
+		else						/* a lista colocaria o evento logo aps o primeiro */
+		{
+			evc->ev_next = head->ev_next;
+			evc->ev_previous = head;
+			if (head->ev_next != NULL)
+				head->ev_next->ev_previous = evc;
+			else
+				ctx->sc_sim[ctx->sc_sn].evc_end = evc;
+			head->ev_next = evc;
+		}
+		return;
+	}
+	/* evc ocorre antes do grupo de cabea:  o grupo volta ao heap, em ordem, e evc passa a ser a cabea */
+	while (head != NULL)
+	{
+		aux = head->ev_next;
+		evcHeapInsert(head);
+		head = aux;
+	}
+	evc->ev_next = evc->ev_previous = NULL;
+	ctx->sc_sim[ctx->sc_sn].evc_begin = ctx->sc_sim[ctx->sc_sn].evc_end = evc;
+}
+
+/*-------------------  FILA DE EVENTOS IMEDIATOS  -------------------
+*
+*  Eventos escalonados para o instante atual (te = 0), quando todos os eventos pendentes so posteriores, ficam numa lista 
+*  parte, sim[sn].evc_now_begin..evc_now_end, que causep esgota antes de consultar o conjunto de eventos.  A insero  O(1)
+*  em qualquer modo e no mexe no conjunto principal (nos modos heap, evita devolver o grupo de cabea ao heap).
+*  As posies so as mesmas da lista original:  o primeiro evento imediato vai para o incio da cadeia e os seguintes logo
+*  aps ele, ou para o final, se no houver outros eventos pendentes.  Enquanto a fila no est vazia, todos os eventos do
+*  conjunto principal tm tempo maior que o dos eventos da fila.
+*/
+static int evcInNow(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	return (ctx->sc_sim[ctx->sc_sn].evc_now_begin != NULL && evc->ev_time == ctx->sc_sim[ctx->sc_sn].evc_now_begin->ev_time);
+}
+
+/* Coloca evc na fila de eventos imediatos, se for o caso; retorna 1 se colocou, 0 se evc deve ir para o conjunto principal */
+static int evcNowSchedule(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct evchain *head = ctx->sc_sim[ctx->sc_sn].evc_now_begin;
+
+	if (head == NULL)
+	{
+		if (evc->ev_time != ctx->sc_clock || ctx->sc_sim[ctx->sc_sn].evc_begin == NULL || ctx->sc_sim[ctx->sc_sn].evc_begin->ev_time <= evc->ev_time)
+			return 0;
+		evc->ev_next = evc->ev_previous = NULL;
+		ctx->sc_sim[ctx->sc_sn].evc_now_begin = ctx->sc_sim[ctx->sc_sn].evc_now_end = evc;
+		return 1;
+	}
+	if (evc->ev_time != head->ev_time)
+		return 0;
+	if (ctx->sc_sim[ctx->sc_sn].evc_begin == NULL)	/* no h outros eventos pendentes:  a lista acrescentaria ao final */
+	{
+		evc->ev_next = NULL;
+		evc->ev_previous = ctx->sc_sim[ctx->sc_sn].evc_now_end;
+		ctx->sc_sim[ctx->sc_sn].evc_now_end->ev_next = evc;
+		ctx->sc_sim[ctx->sc_sn].evc_now_end = evc;
+	}
+	else							/* a lista colocaria o evento logo aps o primeiro */
+	{
+		evc->ev_next = head->ev_next;
+		evc->ev_previous = head;
+		if (head->ev_next != NULL)
+			head->ev_next->ev_previous = evc;
+		else
+			ctx->sc_sim[ctx->sc_sn].evc_now_end = evc;
+		head->ev_next = evc;
+	}
+	return 1;
+}
+
+/*-------------------  NDICE DE EVENTOS POR TOKEN  -------------------
+*
+*  Todos os eventos pendentes, em qualquer modo, esto tambm numa tabela hash indexada pelo nmero da token
+*  (sim[sn].evc_tkn_tab), encadeados por ev_tkn_next/ev_tkn_previous.  cancelp_tkn usa este ndice em vez de percorrer o
+*  conjunto de eventos.  Como uma mesma token pode ter vrios eventos pendentes (por exemplo, tokens de controle com nmero
+*  fixo), cancelp_tkn retira o que viria primeiro na cadeia, como antes.
+*/
+static unsigned int evcTknHash(int tkn)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	return ((unsigned int)tkn * 2654435761u) & (ctx->sc_sim[ctx->sc_sn].evc_tkn_size - 1);	/* hash multiplicativo; o tamanho  potncia de 2 */
+}
+
+static void evcTknLink(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	unsigned int h = evcTknHash(evc->ev_tkn);
+
+	evc->ev_tkn_previous = NULL;
+	evc->ev_tkn_next = ctx->sc_sim[ctx->sc_sn].evc_tkn_tab[h];
+	if (evc->ev_tkn_next != NULL)
+		evc->ev_tkn_next->ev_tkn_previous = evc;
+	ctx->sc_sim[ctx->sc_sn].evc_tkn_tab[h] = evc;
+}
+
+/* Inclui evc no ndice, dobrando a tabela quando o nmero de eventos pendentes passa do dobro do nmero de posies */
+static void evcTknInsert(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct evchain **old = ctx->sc_sim[ctx->sc_sn].evc_tkn_tab, *aux, *next;
+	int i, oldsize = ctx->sc_sim[ctx->sc_sn].evc_tkn_size;
+
+	if (ctx->sc_sim[ctx->sc_sn].evc_count >= 2 * ctx->sc_sim[ctx->sc_sn].evc_tkn_size)
+	{
+		ctx->sc_sim[ctx->sc_sn].evc_tkn_size = oldsize == 0 ? 1024 : 2 * oldsize;
+		ctx->sc_sim[ctx->sc_sn].evc_tkn_tab = (struct evchain**)malloc(ctx->sc_sim[ctx->sc_sn].evc_tkn_size * sizeof *old);
+		if (ctx->sc_sim[ctx->sc_sn].evc_tkn_tab == NULL)
+		{
+			printf ("\nError - evcTknInsert - insufficient memory to allocate for token index");
+			exit (1);
+		}
+		for (i = 0; i < ctx->sc_sim[ctx->sc_sn].evc_tkn_size; i++)
+			ctx->sc_sim[ctx->sc_sn].evc_tkn_tab[i] = NULL;
+		for (i = 0; i < oldsize; i++)
+			for (aux = old[i]; aux != NULL; aux = next)
+			{
+				next = aux->ev_tkn_next;
+				evcTknLink(aux);
+			}
+		free(old);
+	}
+	evcTknLink(evc);
+	ctx->sc_sim[ctx->sc_sn].evc_count++;
+}
+
+static void evcTknRemove(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (evc->ev_tkn_previous != NULL)
+		evc->ev_tkn_previous->ev_tkn_next = evc->ev_tkn_next;
+	else
+		ctx->sc_sim[ctx->sc_sn].evc_tkn_tab[evcTknHash(evc->ev_tkn)] = evc->ev_tkn_next;
+	if (evc->ev_tkn_next != NULL)
+		evc->ev_tkn_next->ev_tkn_previous = evc->ev_tkn_previous;
+	ctx->sc_sim[ctx->sc_sn].evc_count--;
+	evc->ev_id = 0;		/* o evento no est mais pendente; handles para ele deixam de ser vlidos */
+}
+
+/* Retorna 1 se o evento pendente a vem antes do evento pendente b na cadeia de eventos */
+static int evcPrecedes(struct evchain *a, struct evchain *b)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (a->ev_time != b->ev_time)
+		return (a->ev_time < b->ev_time);
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode != EVC_LIST && !evcInNow(a) && a->ev_time != ctx->sc_sim[ctx->sc_sn].evc_begin->ev_time)
+		return (a->ev_seq < b->ev_seq);		/* ambos no heap */
+	while (a != NULL && a->ev_time == b->ev_time)	/* ambos na mesma lista:  b vem depois de a se for encontrado  frente */
+	{
+		if (a == b)
+			return 1;
+		a = a->ev_next;
 	}
+	return 0;
+}
+
+/* Retorna o evento pendente da token tkn que viria primeiro na cadeia, ou NULL */
+static struct evchain *evcTknFind(int tkn)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct evchain *evc, *found = NULL;
+
+	if (ctx->sc_sim[ctx->sc_sn].evc_tkn_size == 0)
+		return NULL;
+	for (evc = ctx->sc_sim[ctx->sc_sn].evc_tkn_tab[evcTknHash(tkn)]; evc != NULL; evc = evc->ev_tkn_next)
+		if (evc->ev_tkn == tkn && (found == NULL || evcPrecedes(evc, found)))
+			found = evc;
+	return found;
+}
+
+/* Retira um evento pendente da fila de imediatos ou do conjunto de eventos (lista ou heap), e do ndice por token */
+static void evcUnlink(struct evchain *evc)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	evcTknRemove(evc);
+	if (evcInNow(evc))
+	{
+		if (evc->ev_previous != NULL)
+			evc->ev_previous->ev_next = evc->ev_next;
+		else
+			ctx->sc_sim[ctx->sc_sn].evc_now_begin = evc->ev_next;
+		if (evc->ev_next != NULL)
+			evc->ev_next->ev_previous = evc->ev_previous;
+		else
+			ctx->sc_sim[ctx->sc_sn].evc_now_end = evc->ev_previous;
+		return;
+	}
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode != EVC_LIST && evc->ev_time != ctx->sc_sim[ctx->sc_sn].evc_begin->ev_time)
+	{
+		evcHeapRemove(evc);
+		return;
+	}
+	if (evc->ev_previous != NULL)
+		evc->ev_previous->ev_next = evc->ev_next;
+	else
+		ctx->sc_sim[ctx->sc_sn].evc_begin = evc->ev_next;
+	if (evc->ev_next != NULL)
+		evc->ev_next->ev_previous = evc->ev_previous;
+	else
+		ctx->sc_sim[ctx->sc_sn].evc_end = evc->ev_previous;
+	if (ctx->sc_sim[ctx->sc_sn].evc_begin == NULL)	/* cadeia ficou vazia:  nos modos heap, traz o prximo grupo de eventos */
+		evcPromote();
+}
+
+/* SELECT EVENT SET STRUCTURE
+*
+*  Define a estrutura usada para o conjunto de eventos futuros das simulaes criadas a partir daqui; deve ser chamada
+*  antes de simm().  mode pode ser EVC_LIST (lista ordenada original, padro), EVC_HEAP4 (heap 4-rio), EVC_PAIRING
+*  (pairing heap) ou EVC_CALENDAR (calendar queue, indicado para populaes muito grandes de eventos pendentes).
+*  Todos os modos produzem a mesma seqncia de eventos.
+*/
+void setEvChainMode(int mode)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (mode != EVC_LIST && mode != EVC_HEAP4 && mode != EVC_PAIRING && mode != EVC_CALENDAR)
+	{
+		printf ("\nError - setEvChainMode - invalid event set mode");
+		exit (1);
+	}
+	ctx->sc_evc_mode = mode;
 }
 
 /*-------SCHEDULE EVENT WITH TOKEN POINTER - FC schedulep ------------------*/
@@ -1264,13 +2451,14 @@ void releasep (int f, int tkn)
 	 apontador. Neste segundo caso a vantagem e rodar scripts smpl antigos sem
 	 problemas */
 /* Basicamente precisam de apenas duas mudancas */
-void schedulep(int ev, double te, int tkn, TOKEN *tkp)
+static struct evchain *evcSchedule(int ev, double te, int tkn, TOKEN *tkp)
 /* void schedule(int ev, double te, int tkn)           MUDANCA 01/02 */
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct evchain *evc, *evc_aux;
 	double st;														/* simulation time tempo de ocorrencia do evento */
 
-	st = clock + te;
+	st = ctx->sc_clock + te;
 
 	if ( tkn == 0 )
 	{
@@ -1284,25 +2472,31 @@ void schedulep(int ev, double te, int tkn, TOKEN *tkp)
 		exit (1);
 	}
 
-	evc = (evchain*)malloc(sizeof *evc);
-	if (evc == NULL)
-	{
-		printf ("\nError - schedulep - insufficient memory to allocate for event");
-		exit (1);
-	}
+	evc = (evchain*)poolAlloc(&ctx->sc_pools[POOL_EVCHAIN]);
 
 	evc->ev_time = st;
 	evc->ev_tkn = tkn;
 	evc->ev_tkn_p = tkp;							/* Insercao desta linha MUDANCA 02/02 */
 	evc->ev_type = ev;
+	evc->ev_id = ++ctx->sc_sim[ctx->sc_sn].evc_ids;					/* identificador nico, usado pelos handles de schedulep_h */
+	evcTknInsert(evc);
+
+	if (evcNowSchedule(evc))		/* evento imediato (te = 0):  fila  parte, O(1) */
+		return (evc);
 
-	if ( (sim[sn].evc_begin == NULL) && (sim[sn].evc_end == NULL) )	/* Cadeia de eventos vazia */
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode != EVC_LIST)	/* modos heap:  ver evcHeapSchedule */
 	{
-		sim[sn].evc_begin = evc;
-		sim[sn].evc_end = evc;
+		evcHeapSchedule(evc);
+		return (evc);
+	}
+
+	if ( (ctx->sc_sim[ctx->sc_sn].evc_begin == NULL) && (ctx->sc_sim[ctx->sc_sn].evc_end == NULL) )	/* Cadeia de eventos vazia */
+	{
+		ctx->sc_sim[ctx->sc_sn].evc_begin = evc;
+		ctx->sc_sim[ctx->sc_sn].evc_end = evc;
 		evc->ev_next = NULL;
 		evc->ev_previous = NULL;
-		return;
+		return (evc);
 	}
 
     /************************************************/
@@ -1310,19 +2504,19 @@ void schedulep(int ev, double te, int tkn, TOKEN *tkp)
 	/************************************************/
 
 
-	evc_aux = sim[sn].evc_end;
+	evc_aux = ctx->sc_sim[ctx->sc_sn].evc_end;
 
 	if (( st > evc_aux->ev_time ) || ( st == evc_aux->ev_time ))	/* Tempo atual maior ou igual */
 	{																															/* do que o ultimo tempo da 	*/
 		evc_aux->ev_next = evc;										/* cadeia acrescenta no final */
 		evc->ev_previous = evc_aux;							    	/* da cadeia automaticamente  */
 		evc->ev_next = NULL;
-		sim[sn].evc_end = evc;
-		return;
+		ctx->sc_sim[ctx->sc_sn].evc_end = evc;
+		return (evc);
 	}
 
 
-	evc_aux = sim[sn].evc_begin;
+	evc_aux = ctx->sc_sim[ctx->sc_sn].evc_begin;
 
 	if ( st < evc_aux->ev_time )					/* Tempo atual menor que o primeiro tempo da cadeia
 													   acrescenta no inicio da cadeia automaticamente */
@@ -1330,18 +2524,19 @@ void schedulep(int ev, double te, int tkn, TOKEN *tkp)
 		evc_aux->ev_previous = evc;
 		evc->ev_previous = NULL;
 		evc->ev_next = evc_aux;
-		sim[sn].evc_begin = evc;
-		return;
+		ctx->sc_sim[ctx->sc_sn].evc_begin = evc;
+		return (evc);
 	}
 
-	if ( st == evc_aux->ev_time )					/* Tempo atual igual ao primeiro tempo da cadeia
-													   como ele foi gerado depois ele ficara logo apos o primeiro */
+	if ( st == evc_aux->ev_time && ctx->sc_sim[ctx->sc_sn].evc_now_begin == NULL )	/* Tempo atual igual ao primeiro tempo da cadeia
+													   como ele foi gerado depois ele ficara logo apos o primeiro
+													   (se houver eventos imediatos, o primeiro da cadeia  um deles) */
 	{
 		evc->ev_next = evc_aux->ev_next;
 		evc->ev_previous = evc_aux;
 		evc_aux->ev_next->ev_previous = evc;
 		evc_aux->ev_next = evc;
-		return;
+		return (evc);
 	}
 
 	/* Tempo atual menor ou igual do que o ultimo  tempo da cadeia procura dentro da lista
@@ -1350,7 +2545,7 @@ void schedulep(int ev, double te, int tkn, TOKEN *tkp)
 	   agiliza a insercao. Pensar em colocar um contador para verificar esta velocidade */
 
 
-	evc_aux = sim[sn].evc_end;
+	evc_aux = ctx->sc_sim[ctx->sc_sn].evc_end;
 
 	while (1)		/* Insere na lista mas nao e o primeiro */
 	{
@@ -1360,7 +2555,7 @@ void schedulep(int ev, double te, int tkn, TOKEN *tkp)
 			evc->ev_previous = evc_aux;
 			evc_aux->ev_next->ev_previous = evc;
 			evc_aux->ev_next = evc;
-			return;
+			return (evc);
 		}
 		evc_aux = evc_aux->ev_previous;
 	}
@@ -1369,17 +2564,59 @@ void schedulep(int ev, double te, int tkn, TOKEN *tkp)
 
 	printf ("\nError - schedulep - could not insert time into event chain");
 	exit (1);
+	return (NULL);
+
+}
+
+void schedulep(int ev, double te, int tkn, TOKEN *tkp)
+{
+	evcSchedule(ev, te, tkn, tkp);
+}
+
+/*---------- SCHEDULE EVENT RETURNING HANDLE ---------------------------
+*
+* Igual a schedulep, mas retorna um handle para o evento escalonado.  O handle permite cancelar exatamente
+* este evento com cancelp_handle, mesmo que a token no seja nica (p.ex., tokens -1 de controle).
+*
+*/
+EVHANDLE schedulep_h(int ev, double te, int tkn, TOKEN *tkp)
+{
+	EVHANDLE h;
+
+	h.eh_evc = evcSchedule(ev, te, tkn, tkp);
+	h.eh_id = h.eh_evc->ev_id;
+	return (h);
+}
+
+/*---------- CANCEL EVENT BY HANDLE ---------------------------
+*
+* Cancela o evento identificado pelo handle retornado por schedulep_h, em tempo constante.  Retorna ponteiro
+* para o elemento retirado da cadeia de eventos, ou NULL se o evento j ocorreu ou j foi cancelado (o handle
+* fica invlido nestes casos).  O elemento deve ser devolvido ao pool do kernel com evChainFree.
+*
+* Como os ns da cadeia de eventos nunca so devolvidos ao sistema (ver poolFree), o handle pode ser testado com
+* segurana mesmo depois de o n ter sido reutilizado:  o identificador ev_id no confere mais.
+*
+*/
+struct evchain *cancelp_handle(EVHANDLE h)
+{
+	if ( h.eh_evc == NULL || h.eh_id == 0 || h.eh_evc->ev_id != h.eh_id )
+		return NULL;
 
+	evcUnlink(h.eh_evc);
+	return (h.eh_evc);
 }
 
+
 /*---------- CAUSE EVENT WITH TOKEN POINTER ---------------------------*/
 /* Foram feitas duas mudancas em relacao ao processamento original       */
 TOKEN *causep(int *ev, int *tkn)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct evchain *evc;
 	TOKEN *tkp;											/* Insercao desta linha MUDANCA 01/03 */
 
-	evc = sim[sn].evc_begin;
+	evc = ctx->sc_sim[ctx->sc_sn].evc_now_begin != NULL ? ctx->sc_sim[ctx->sc_sn].evc_now_begin : ctx->sc_sim[ctx->sc_sn].evc_begin;	//eventos imediatos primeiro
 	//testa se cadeia de eventos est vazia; se estiver, mostra mensagem de erro e sai do programa
 	//isto  necessrio, caso contrrio as instrues subsequentes causaro erro
 	//a cadeia de eventos pode ficar vazia se o trmino da simulao for controlado por tempo,
@@ -1389,29 +2626,17 @@ TOKEN *causep(int *ev, int *tkn)
 		exit(1);
 	}
 
-	*tkn = token = evc->ev_tkn;
-	*ev = event = evc->ev_type;		/* este event servira para o enqueue token colocar o
+	*tkn = ctx->sc_token = evc->ev_tkn;
+	*ev = ctx->sc_event = evc->ev_type;		/* este event servira para o enqueue token colocar o
 									   evento que devera ser processado associado a token
 									   retirada da fila da facility */
-	clock = evc->ev_time;
+	ctx->sc_clock = evc->ev_time;
 	tkp = evc->ev_tkn_p;			/* Insercao desta linha ao inves de return puro MUDANCA 02/03  */
 
 	/* Apos a retirada do evento libera-se a area deste evento */
 
-	sim[sn].evc_begin = evc->ev_next;
-
-	if (evc->ev_next == NULL) //cadeia de eventos ficou vazia; atualizar indicadores para NULL
-	{
-		sim[sn].evc_begin = NULL;
-		sim[sn].evc_end = NULL;
-	}
-	else
-	{
-		evc->ev_next->ev_previous = NULL;  //este  o primeiro elemento da cadeia; o ponteiro previous aponta para NULL, ento.
-	}
-
-
-	free(evc);
+	evcUnlink(evc);	//retira da fila de imediatos ou da cadeia (nos modos heap, traz o prximo grupo se a cadeia esvaziar) e do ndice de tokens
+	poolFree(&ctx->sc_pools[POOL_EVCHAIN], evc);
 
 	/* retorna o apontador da token */
 
@@ -1426,38 +2651,29 @@ TOKEN *causep(int *ev, int *tkn)
 */
 int evChainIsEmpty()
 {
-	return (sim[sn].evc_begin == NULL? 1:0);
+	struct simmContext *ctx = SIMM_CTX;
+
+	return (ctx->sc_sim[ctx->sc_sn].evc_begin == NULL && ctx->sc_sim[ctx->sc_sn].evc_now_begin == NULL? 1:0);
 }
 
 /*----------  CAUSE EVENT  -------------------------------------------*/
 
 void cause(int *ev, int *tkn)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct evchain *evc;
-	evc = sim[sn].evc_begin;
+	evc = ctx->sc_sim[ctx->sc_sn].evc_now_begin != NULL ? ctx->sc_sim[ctx->sc_sn].evc_now_begin : ctx->sc_sim[ctx->sc_sn].evc_begin;
 
-	*tkn = token = evc->ev_tkn;
-	*ev = event = evc->ev_type;			/* este event servira para o enqueue token colocar o
+	*tkn = ctx->sc_token = evc->ev_tkn;
+	*ev = ctx->sc_event = evc->ev_type;			/* este event servira para o enqueue token colocar o
 																	   evento que devera ser processado associado a token
 																		 retirada da fila da facilty */
-	clock = evc->ev_time;
+	ctx->sc_clock = evc->ev_time;
 
 	/* Apos a retirada do evento libera-se a area deste evento */
 
-	sim[sn].evc_begin = evc->ev_next;
-
-	if (evc->ev_next == NULL)
-	{
-		sim[sn].evc_begin = NULL;
-		sim[sn].evc_end = NULL;
-	}
-	else
-	{
-		evc->ev_next->ev_previous = NULL;
-	}
-
-
-	free(evc);
+	evcUnlink(evc);
+	poolFree(&ctx->sc_pools[POOL_EVCHAIN], evc);
 
 	/* retorna o apontador da token */
 
@@ -1467,42 +2683,38 @@ void cause(int *ev, int *tkn)
 /*--------------------------  RETURN TIME  ---------------------------*/
 double simtime()
 {
-    return(clock);
+    struct simmContext *ctx = SIMM_CTX;
+
+    return(ctx->sc_clock);
 }
 
 /*-----------------------  GET FACILITY BUSY STATUS  ----------------------*/
 int status(int f)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
 
-	if ( f > sim[sn].fct_number)
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - status - facility number does not exist");
 		exit (1);
 	}
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 	return(fct->f_n_serv == fct->f_n_busy_serv? 1:0);
 }
 
 /*-----------------------  SET FACILITY STATUS UP ----------------------*/
 void setFacUp(int f)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
 
-	if ( f > sim[sn].fct_number)
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - setFacUp - facility number does not exist");
 		exit (1);
 	}
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 	fct->f_up = 1;
 }
 
@@ -1522,18 +2734,15 @@ void setFacUp(int f)
 */
 int setFacDown(int f)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
 
-	if (f > sim[sn].fct_number)
+	if (f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - setFacDown - facility number does not exist");
 		exit (1);
 	}
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 	fct->f_up = 0;
 	//Now, purge the facility queue; if this is not desired, comment the remaining code
 	return(purgeFacQueue(f));
@@ -1541,18 +2750,15 @@ int setFacDown(int f)
 /*-----------------------  GET FACILITY UP/DOWN STATUS  ----------------------*/
 int getFacUpStatus(int f)
 {
+    struct simmContext *ctx = SIMM_CTX;
     struct facilit *fct;
 
-	if ( f > sim[sn].fct_number)
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - getFacUpStatus - facility number does not exist");
 		exit (1);
 	}
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 	return(fct->f_up);
 }
 
@@ -1573,32 +2779,31 @@ int getFacUpStatus(int f)
 */
 static int purgeFacQueue(int f)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
 	struct fqueue *que;
 	int i=0; //contador para posies da fila descartadas
 	
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-		if (fct == NULL) {
-			printf("\nError - purgeFacQueue - facility number does not exist");
-			exit(1);
-		}
+	if (f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number) {
+		printf("\nError - purgeFacQueue - facility number does not exist");
+		exit(1);
 	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 	while (fct->f_n_length_q > 0)
 	{
     	//fila no est vazia; descarte as tokens em fila, mas atualize as estatsticas
-		que = fct->f_queue;
-		fct->f_queue = que->fq_next;
-		fct->length_time_prod_sum += fct->f_n_length_q * (clock - fct->f_last_ch_time_q);
+		que = fqRemoveFirst(fct);
+		fqAccumulate(fct);
 		fct->f_n_length_q--;
 		//fct->f_exit_count_q++;  //token descartada; ento no seria uma token dequeued; no atualizar esta estatstica (CORRETO?)
-		fct->f_last_ch_time_q = clock;
+		fct->f_last_ch_time_q = ctx->sc_clock;
 		i++; //mais uma posio descartada:  atualize o contador de descartes para esta funo
 		fct->f_tkn_dropped++; //atualize o contador de descartes para toda a facility
-		free(que->fq_tkp); //elimine o token da memria
-		free(que); //descarte a posio da fila
+		if (ctx->sc_tkn_free != NULL && que->fq_tkp != NULL)
+			ctx->sc_tkn_free(que->fq_tkp); //devolva o token a quem o criou (o shell pode manter os tokens num pool; ver sc_tkn_free)
+		else
+			free(que->fq_tkp); //elimine o token da memria
+		poolFree(&ctx->sc_pools[POOL_FQUEUE], que); //descarte a posio da fila
 	}
 	fct->f_queue=NULL; //assegura que fila da facility est agora vazia
 	return i;  //devolve o nmero de posies eliminadas da fila nesta operao
@@ -1607,41 +2812,35 @@ static int purgeFacQueue(int f)
 /*--------------------  GET CURRENT QUEUE LENGTH  --------------------*/
 int inq(int f)
 {
+  struct simmContext *ctx = SIMM_CTX;
   struct facilit *fct;
-	if ( f > sim[sn].fct_number)
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - inq - facility number does not exist");
 		exit (1);
 	}
 
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 	return(fct->f_n_length_q);
 }
 
 /*--------------------  GET FACILITY UTILIZATION  --------------------*/
 double U(int f)
 {
+  struct simmContext *ctx = SIMM_CTX;
   struct facilit *fct;
 	double util = 0.0;
-	double interval = clock - start;
-	if ( f > sim[sn].fct_number)
+	double interval = ctx->sc_clock - ctx->sc_start;
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - U (utilization) - facility number does not exist");
 		exit (1);
 	}
 
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 	if ( interval > 0.0 )
 	{
-		util = fct->f_busy_time / (float) interval;
+		util = sumValue(&fct->f_busy_time) / interval;
 	}
 	return (util);
 }
@@ -1649,67 +2848,138 @@ double U(int f)
 /*----------------------  GET MEAN BUSY PERIOD  ----------------------*/
 double B(int f)
 {
+  struct simmContext *ctx = SIMM_CTX;
   struct facilit *fct;
 	int n = 0;
 	double mbp = 0.0;
-	if ( f > sim[sn].fct_number)
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - B (mean busy period) - facility number does not exist");
 		exit (1);
 	}
 
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 
 	if (fct->f_release_count > 0)
 	{
-		mbp = fct->f_busy_time / (float) fct->f_release_count;
+		mbp = sumValue(&fct->f_busy_time) / (double) fct->f_release_count;
 		return (mbp);
 	}
 	else
 	{
-		return (fct->f_busy_time);
+		return (sumValue(&fct->f_busy_time));
+	}
+}
+
+/*-----------------  GET SERVICE TIME VARIANCE  -----------------*/
+/* Varincia amostral dos tempos de servio terminados por release (Welford); a mdia correspondente  B(f) quando no h preempes */
+double BVar(int f)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
+	{
+		printf ("\nError - BVar (service time variance) - facility number does not exist");
+		exit (1);
 	}
+	return (momVar(&ctx->sc_sim[ctx->sc_sn].fct_index[f]->f_s_mom));
 }
 
 /*--------------------  GET AVERAGE QUEUE LENGTH  --------------------*/
 double Lq(int f)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
-	double interval = clock-start;
+	double interval = ctx->sc_clock-ctx->sc_start;
 
-	if ( f > sim[sn].fct_number)
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
 		printf ("\nError - Lq (average queue length) - facility number does not exist");
 		exit (1);
 	}
 
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
+	return((interval>0.0)? (sumValue(&fct->length_time_prod_sum) / interval):0.0);
+}
+
+/*-----------------  GET QUEUE LENGTH VARIANCE  -----------------*/
+/* Varincia no tempo do tamanho da fila desde o ltimo reset, incluindo o intervalo em curso desde a ltima mudana da fila */
+double LqVar(int f)
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct facilit *fct;
+	struct simmMoments m;
+
+	if ( f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number)
 	{
-		fct=fct->fct_next;
+		printf ("\nError - LqVar (queue length variance) - facility number does not exist");
+		exit (1);
 	}
-	return((interval>0.0)? (fct->length_time_prod_sum / interval):0.0);
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
+	m = fct->f_q_mom;
+	momAdd(&m, fct->f_n_length_q, ctx->sc_clock - fct->f_last_ch_time_q);
+	return (momTimeVar(&m));
 }
 
 /*------------------------  GENERATE REPORT  -------------------------*/
 void report()
 {
+  struct simmContext *ctx = SIMM_CTX;
+
   newpage();
   reportf();
+  if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_CALENDAR)
+    reportEvChain();
+  histReport();
   endpage();
 }
 
+/* GENERATE EVENT SET REPORT
+*
+*  Apresenta as estatsticas do calendar queue (modo EVC_CALENDAR):  redimensionamentos, largura e ocupao dos buckets,
+*  e o custo mdio de localizao do menor evento e de insero.  Buckets percorridos ou busca direta freqentes indicam
+*  buckets estreitos demais; muitos elementos percorridos por insero indicam buckets largos demais.
+*/
+void reportEvChain()
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct calqueue *cq = &ctx->sc_sim[ctx->sc_sn].evc_cal;
+	struct evchain *evc;
+	int i, len, used = 0, maxlen = 0;
+
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode != EVC_CALENDAR)
+	{
+		fprintf(ctx->sc_opf, "\nevent set:  no statistics for this mode\n");
+		return;
+	}
+	for (i = 0; i < cq->cq_nb; i++)
+	{
+		for (len = 0, evc = cq->cq_bucket[i]; evc != NULL; evc = evc->ev_next)
+			len++;
+		if (len > 0)
+			used++;
+		if (len > maxlen)
+			maxlen = len;
+	}
+	fprintf(ctx->sc_opf, "\n EVENT SET (CALENDAR QUEUE)\n");
+	fprintf(ctx->sc_opf, " buckets: %d   width: %g   pending events: %d   peak: %d\n", cq->cq_nb, cq->cq_width, cq->cq_n, cq->cq_peak_n);
+	fprintf(ctx->sc_opf, " resizes: %d   width recalibrations: %d\n", cq->cq_resizes, cq->cq_recalibrations);
+	fprintf(ctx->sc_opf, " occupied buckets: %d (%.1f%%)   mean length of occupied buckets: %.2f   longest bucket: %d\n",
+		used, cq->cq_nb > 0 ? 100.0 * used / cq->cq_nb : 0.0, used > 0 ? (double)cq->cq_n / used : 0.0, maxlen);
+	fprintf(ctx->sc_opf, " buckets scanned per dequeue: %.2f   direct searches: %.0f   elements walked per insert: %.2f\n",
+		cq->cq_mins > 0 ? (double)cq->cq_scans / cq->cq_mins : 0.0, (double)cq->cq_direct,
+		cq->cq_inserts > 0 ? (double)cq->cq_walk / cq->cq_inserts : 0.0);
+	ctx->sc_lft -= 6;
+}
+
 /*--------------------  GENERATE FACILITY REPORT  --------------------*/
 void reportf()
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *f;
-  if (( f=sim[sn].fct_begin ) == NULL)
+  if (( f=ctx->sc_sim[ctx->sc_sn].fct_begin ) == NULL)
 	{
-		fprintf(opf,"\nno facilities defined:  report abandoned\n");
+		fprintf(ctx->sc_opf,"\nno facilities defined:  report abandoned\n");
 	}
 	else
   { /* f = 0 at end of facility chain */
@@ -1724,6 +2994,7 @@ void reportf()
 /*----------------------  GENERATE REPORT PAGE  ----------------------*/
 static struct facilit *rept_page(struct facilit *f)
 {
+	struct simmContext *ctx = SIMM_CTX;
 
 	char fn[19];
   static char *s[7]= {
@@ -1731,13 +3002,13 @@ static struct facilit *rept_page(struct facilit *f)
                       "MEAN BUSY     MEAN QUEUE        OPERATION COUNTS",
                       " FACILITY          UTIL.    ",
                       " PERIOD        LENGTH     RELEASE   PREEMPT   QUEUE" };
-  fprintf(opf,"\n%51s\n\n\n",s[0]);
-  fprintf(opf,"%-s%-54s%-s%11.3f\n",s[1],sim[sn].name,s[2],clock);
-  fprintf(opf,"%68s%11.3f\n\n",s[3],clock-start);
-  fprintf(opf,"%75s\n",s[4]);
-  fprintf(opf,"%s%s\n",s[5],s[6]);
-	lft-=8;
-  while(f && lft--)
+  fprintf(ctx->sc_opf,"\n%51s\n\n\n",s[0]);
+  fprintf(ctx->sc_opf,"%-s%-54s%-s%11.3f\n",s[1],ctx->sc_sim[ctx->sc_sn].name,s[2],ctx->sc_clock);
+  fprintf(ctx->sc_opf,"%68s%11.3f\n\n",s[3],ctx->sc_clock-ctx->sc_start);
+  fprintf(ctx->sc_opf,"%75s\n",s[4]);
+  fprintf(ctx->sc_opf,"%s%s\n",s[5],s[6]);
+	ctx->sc_lft-=8;
+  while(f && ctx->sc_lft--)
   {
 		if (f->f_n_serv==1)
 		{
@@ -1747,7 +3018,7 @@ static struct facilit *rept_page(struct facilit *f)
 		{
 			sprintf(fn,"%s[%d]",f->f_name,f->f_n_serv);
 		}
-		fprintf(opf," %-17s%6.4f %10.3f %13.3f %11d %9d %7d\n",
+		fprintf(ctx->sc_opf," %-17s%6.4f %10.3f %13.3f %11lld %9lld %7lld\n",
     fn,U(f->f_number),B(f->f_number),Lq(f->f_number), f->f_release_count,
 		f->f_preempt_count, f->f_exit_count_q);
 
@@ -1759,44 +3030,52 @@ static struct facilit *rept_page(struct facilit *f)
 /*---------------------------  COUNT LINES  --------------------------*/
 int lns(int i)
 {
-	lft-=i;
-	if (lft<=0) endpage();
-  return(lft);
+	struct simmContext *ctx = SIMM_CTX;
+
+	ctx->sc_lft-=i;
+	if (ctx->sc_lft<=0) endpage();
+  return(ctx->sc_lft);
 }
 
 /*----------------------------  END PAGE  ----------------------------*/
 void endpage()
 {
-	if (opf==display)
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (ctx->sc_opf==ctx->sc_display)
   { /* screen output: push to top of screen & pause */
-		while(lft>0)
+		while(ctx->sc_lft>0)
 		{
-			putc('\n',opf); lft--;
+			putc('\n',ctx->sc_opf); ctx->sc_lft--;
 		}
 		printf("\n[ENTER] to continue:");
 		getchar();
     /* if (mr) then clr_scr(); else */ printf("\n\n");
 	}
-  else if (lft<pl) putc(FF,opf);
+  else if (ctx->sc_lft<pl) putc(FF,ctx->sc_opf);
   newpage();
 }
 
 /*----------------------------  NEW PAGE  ----------------------------*/
 void newpage()
-{ /* set line count to top of page/screen after page change/screen  */
+{
+	struct simmContext *ctx = SIMM_CTX; /* set line count to top of page/screen after page change/screen  */
   /* clear by 'simm', another SimM module, or simulation program    */
-  lft=(opf==display)? sl:pl;
+  ctx->sc_lft=(ctx->sc_opf==ctx->sc_display)? sl:pl;
 }
 
 /*------------------------  REDIRECT OUTPUT  -------------------------*/
 FILE *sendto(FILE *dest)
 {
-  if (dest!=NULL) opf=dest;
-  return(opf);
+  struct simmContext *ctx = SIMM_CTX;
+
+  if (dest!=NULL) ctx->sc_opf=dest;
+  return(ctx->sc_opf);
 }
 /*------------------  DISPLAY ERROR MESSAGE & EXIT  ------------------*/
 void error(int n, char *s)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	FILE *dest;
   static char
   *m[8]= { "Simulation Error at Time ",
@@ -1808,19 +3087,19 @@ void error(int n, char *s)
            "Preempted Token Not in Event List",
 	         "Release of Idle/Unowned Facility"
 				  };
-  dest=opf;
+  dest=ctx->sc_opf;
   while(1)
 	{ /* send messages to both printer and screen */
-    fprintf(dest,"\n**** %s%.3f\n",m[0],clock);
+    fprintf(dest,"\n**** %s%.3f\n",m[0],ctx->sc_clock);
     if (n) fprintf(dest,"     %s\n",m[n]);
     if (s!=NULL) fprintf(dest,"     %s\n",s);
-    if (dest==display) break;
+    if (dest==ctx->sc_display) break;
 		else
 		{
-			dest=display;
+			dest=ctx->sc_display;
 		}
 	}
-  if (opf!=display) report();
+  if (ctx->sc_opf!=ctx->sc_display) report();
   /* if (mr) then mtr(0,1); */
   exit(0);
 }
@@ -1832,16 +3111,13 @@ void error(int n, char *s)
 */
 char *fname(int f)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-		if (fct == NULL) {
-			printf("\nError - fname - facility number does not exist");
-			exit(1);
-		}
+	if (f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number) {
+		printf("\nError - fname - facility number does not exist");
+		exit(1);
 	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
     return(fct->f_name);  //retorna endereo do array char contendo o nome; no seria preciso usar &, correto?
 }
 
@@ -1851,7 +3127,9 @@ char *fname(int f)
 */
 char *mname()
 {
-    return(sim[sn].name);
+    struct simmContext *ctx = SIMM_CTX;
+
+    return(ctx->sc_sim[ctx->sc_sn].name);
 }
 
 /*----------------------  GET FACILITY MAXIMAL QUEUE SIZE  ---------------------
@@ -1861,35 +3139,46 @@ char *mname()
 */
 int getFacMaxQueueSize(int f)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-		if (fct == NULL) {
-			printf("\nError - getFacMaxQueue - facility number does not exist");
-			exit(1);
-		}
+	if (f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number) {
+		printf("\nError - getFacMaxQueue - facility number does not exist");
+		exit(1);
 	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
     return(fct->f_max_queue);
 }
 
+/*----------------------  SET FACILITY QUEUE LENGTH BATCH MEANS SERIES  ---------------------
+* Associa  facility a srie de mdias de lotes s (ver bmStream), que passa a receber o tamanho da fila, ponderado pelo
+* tempo em que a fila permaneceu com aquele tamanho.  Cada mudana do tamanho da fila  uma observao, e os lotes se
+* fecham pelo nmero de observaes:  as duraes dos lotes variam com a carga, o que as estimativas da srie compensam
+* ponderando cada lote pela sua durao.  s = 0 desfaz a associao.
+*/
+void setFacQueueBatchMeans(int f, int s)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number) {
+		printf("\nError - setFacQueueBatchMeans - facility number does not exist");
+		exit(1);
+	}
+	ctx->sc_sim[ctx->sc_sn].fct_index[f]->f_bm = s;
+}
+
 /*----------------------  GET FACILITY DROPPED TOKENS COUNT  ---------------------
 * Included in 05.Jan.2006 by Marcos Portnoi
 * returns the facility dropped token count (for a single queue), given the facility number
 */
-int getFacDropTokenCount(int f)
+long long getFacDropTokenCount(int f)
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
-	fct = sim[sn].fct_begin;
-	while (fct->f_number != f)
-	{
-		fct=fct->fct_next;
-		if (fct == NULL) {
-			printf("\nError - getFacDropTokenCount - facility number does not exist");
-			exit(1);
-		}
+	if (f < 1 || f > ctx->sc_sim[ctx->sc_sn].fct_number) {
+		printf("\nError - getFacDropTokenCount - facility number does not exist");
+		exit(1);
 	}
+	fct = ctx->sc_sim[ctx->sc_sn].fct_index[f];
 	return(fct->f_tkn_dropped);
 }
 
@@ -1924,195 +3213,230 @@ Entao um acompanhamento da situa
 
 void dbg_init()
 {
+	struct simmContext *ctx = SIMM_CTX;
 
-	fp = fopen("debug_cr.txt","w");
+	ctx->sc_fp = fopen("debug_cr.txt","w");
 
-	fprintf(fp, "\n -----------------------------------------------------------------------");
-	fprintf(fp, "\n Depuracao do Programa CR - Core Routing");
-	fprintf(fp, "\n Dia/Hora de Geracao:");
+	fprintf(ctx->sc_fp, "\n -----------------------------------------------------------------------");
+	fprintf(ctx->sc_fp, "\n Depuracao do Programa CR - Core Routing");
+	fprintf(ctx->sc_fp, "\n Dia/Hora de Geracao:");
 
-	fclose(fp);
+	fclose(ctx->sc_fp);
 }
 
 void dbg_cab()
 {
+	struct simmContext *ctx = SIMM_CTX;
 
 	int n = 1;
 
-	fp = fopen("debug_cr.txt","a");
+	ctx->sc_fp = fopen("debug_cr.txt","a");
 
-	fprintf(fp, "\n\n-----------------------------------------------------------------------");
-	fprintf(fp, "\nCadeia:  tempo final - num da tkn - tipo do evento");
+	fprintf(ctx->sc_fp, "\n\n-----------------------------------------------------------------------");
+	fprintf(ctx->sc_fp, "\nCadeia:  tempo final - num da tkn - tipo do evento");
 	/* fprintf(fp, "\nCadeia:  tempo final - num da tkn - tipo do evento -
 	                           nodo em que o pkt se encontra."); */
-	fprintf(fp, "\nFacility: nome - num servs - 0/1 (sem/com serv)");
-	fprintf(fp, " - fila (0 - vazia), uso acumulado fct");
-	fprintf(fp, "\nFacility Servers: num do serv - num tkn (0 sem tkn em servico)");
-	fprintf(fp, " - prioridade da tkn, uso acumulado srv");
-	fprintf(fp, "\nFacility Queues: prioridade tkn - num tkn - tempo inter evento tkn -");
-	fprintf(fp, " - evento associado a tkn\n");
-
-	fclose(fp);
+	fprintf(ctx->sc_fp, "\nFacility: nome - num servs - 0/1 (sem/com serv)");
+	fprintf(ctx->sc_fp, " - fila (0 - vazia), uso acumulado fct");
+	fprintf(ctx->sc_fp, "\nFacility Servers: num do serv - num tkn (0 sem tkn em servico)");
+	fprintf(ctx->sc_fp, " - prioridade da tkn, uso acumulado srv");
+	fprintf(ctx->sc_fp, "\nFacility Queues: prioridade tkn - num tkn - tempo inter evento tkn -");
+	fprintf(ctx->sc_fp, " - evento associado a tkn\n");
+
+	fclose(ctx->sc_fp);
 }
 
 void dbg_cause(double tempo, int pkt, int ev)
 {
-	fp = fopen("debug_cr.txt","a");
-	fprintf(fp, "\n[Cause] Clock - %6.2f, Pkt: %4d, Tipo Ev: %2d", tempo, pkt, ev);
-	fclose(fp);
+	struct simmContext *ctx = SIMM_CTX;
+
+	ctx->sc_fp = fopen("debug_cr.txt","a");
+	fprintf(ctx->sc_fp, "\n[Cause] Clock - %6.2f, Pkt: %4d, Tipo Ev: %2d", tempo, pkt, ev);
+	fclose(ctx->sc_fp);
 }
 
 void dbg_tp_1()
 {
-	fp = fopen("debug_cr.txt","a");
-	fprintf(fp, "\n[Tipo 1] - Escalona pkt tipo 2 e gera um novo pkt tipo 1");
+	struct simmContext *ctx = SIMM_CTX;
+
+	ctx->sc_fp = fopen("debug_cr.txt","a");
+	fprintf(ctx->sc_fp, "\n[Tipo 1] - Escalona pkt tipo 2 e gera um novo pkt tipo 1");
 /*fprintf(fp, "\n-------------------------------------------------------"); */
-	fclose(fp);
+	fclose(ctx->sc_fp);
 }
 
 void dbg_tp_2()
 {
-	fp = fopen("debug_cr.txt","a");
-	fprintf(fp, "\n[Tipo 2] Encaminha o pkt para a facility designada como proximo nodo pelo pkt");
+	struct simmContext *ctx = SIMM_CTX;
+
+	ctx->sc_fp = fopen("debug_cr.txt","a");
+	fprintf(ctx->sc_fp, "\n[Tipo 2] Encaminha o pkt para a facility designada como proximo nodo pelo pkt");
 /*fprintf(fp, "\n----------------------------------------------------------------------------"); */
-	fclose(fp);
+	fclose(ctx->sc_fp);
 }
 
 void dbg_tp_3()
 {
-	fp = fopen("debug_cr.txt","a");
-	fprintf(fp, "\n[Tipo 3] Se nodo destino ele envia para o sink caso nao manda para proxima fct");
+	struct simmContext *ctx = SIMM_CTX;
+
+	ctx->sc_fp = fopen("debug_cr.txt","a");
+	fprintf(ctx->sc_fp, "\n[Tipo 3] Se nodo destino ele envia para o sink caso nao manda para proxima fct");
 /*fprintf(fp, "\n-----------------------------------------------------------------------------"); */
-	fclose(fp);
+	fclose(ctx->sc_fp);
 }
 
 void dbg_evc()
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct evchain *evc;
-	int n = 0;
+	int n = 0, now;
 
-	fp = fopen("debug_cr.txt","a");
+	ctx->sc_fp = fopen("debug_cr.txt","a");
 
-	evc = sim[sn].evc_begin;
+	now = ctx->sc_sim[ctx->sc_sn].evc_now_begin != NULL;	/* eventos imediatos primeiro */
+	evc = now ? ctx->sc_sim[ctx->sc_sn].evc_now_begin : ctx->sc_sim[ctx->sc_sn].evc_begin;
 
 	if (evc == NULL)
 	{
-		fprintf(fp, "\n\n[Cadeia atual]:");
-		fprintf(fp, "Cadeia vazia\n");
+		fprintf(ctx->sc_fp, "\n\n[Cadeia atual]:");
+		fprintf(ctx->sc_fp, "Cadeia vazia\n");
 		return;
 	}
 
-	fprintf(fp, "\n\n[Cadeia atual]:");
+	fprintf(ctx->sc_fp, "\n\n[Cadeia atual]:");
 /*fprintf(fp, "\n --------------\n"); */
 	while (evc != NULL)
 	{
-	 	if ( (n % 3) == 0 )	fprintf (fp, "\n");
+	 	if ( (n % 3) == 0 )	fprintf (ctx->sc_fp, "\n");
 		/* Imprime a sequencia por elemento da cadeia: tempo; token; tp evento */
-		fprintf(fp,"    [%2d] - %6.2f; %2d; %2d; **",
+		fprintf(ctx->sc_fp,"    [%2d] - %6.2f; %2d; %2d; **",
 		            n, evc->ev_time, evc->ev_tkn, evc->ev_type);
 		/* Imprime a sequencia por elemento da cadeia: tempo; pacote; onde se encontra; tp evento
 		fprintf(fp,"    [%2d] - %2d; %6.2f; %2d; %2d **",
 		            n, evc->ev_type, evc->ev_time, evc->ev_tkn, evc->ev_tkn_p->currentNode) */;
 		n++;
 		evc = evc->ev_next;
+		if (evc == NULL && now)
+		{
+			evc = ctx->sc_sim[ctx->sc_sn].evc_begin;
+			now = 0;
+		}
 	}
-	fclose(fp);
+	if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_HEAP4)
+		fprintf(ctx->sc_fp, "\n    (+ %d eventos no heap)", ctx->sc_sim[ctx->sc_sn].evc_heap_n);
+	else if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_PAIRING && ctx->sc_sim[ctx->sc_sn].evc_pheap != NULL)
+		fprintf(ctx->sc_fp, "\n    (+ eventos no pairing heap)");
+	else if (ctx->sc_sim[ctx->sc_sn].evc_mode == EVC_CALENDAR)
+		fprintf(ctx->sc_fp, "\n    (+ %d eventos no calendar queue)", ctx->sc_sim[ctx->sc_sn].evc_cal.cq_n);
+	fclose(ctx->sc_fp);
 }
 
 
 void dbg_fct()
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
 	int n = 0;
 
-	fp = fopen("debug_cr.txt","a");
+	ctx->sc_fp = fopen("debug_cr.txt","a");
 
-	fct = sim[sn].fct_begin;
+	fct = ctx->sc_sim[ctx->sc_sn].fct_begin;
 
-	fprintf(fp, "\n[Facilitys]:");
+	fprintf(ctx->sc_fp, "\n[Facilitys]:");
 	/*	fprintf(fp, "\n -----------"); */
 	while (fct != NULL)
 	{
 		/* Imprime a sequencia por facility: nome - num de servidores -
 		- 0/1 (sem servico ou com servico) - tam da fila (0 sem fila) - uso acumulado */
-		fprintf(fp,"\n %s - %2d; %2d; %2d; %2d; %6.2f",
+		fprintf(ctx->sc_fp,"\n %s - %2d; %2d; %2d; %2d; %6.2f",
 		            fct->f_name, fct->f_n_serv, fct->f_n_busy_serv, fct->f_serv->fs_tkn,
-								fct->f_n_length_q, fct->f_busy_time);
+								fct->f_n_length_q, sumValue(&fct->f_busy_time));
 		fct = fct->fct_next;
 	}
-	fclose(fp);
+	fclose(ctx->sc_fp);
 }
 
 void dbg_fct_srv()
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
 	struct fserv *srv;
 	int n = 0;
 
-	fp = fopen("debug_cr.txt","a");
+	ctx->sc_fp = fopen("debug_cr.txt","a");
 
-	fprintf(fp, "\n\n[Facilitys - Servidores]:");
+	fprintf(ctx->sc_fp, "\n\n[Facilitys - Servidores]:");
 /*fprintf(fp, "\n --------------\n"); */
 
-	fct = sim[sn].fct_begin;
+	fct = ctx->sc_sim[ctx->sc_sn].fct_begin;
 	while (fct != NULL)
 	{
-		fprintf(fp,"\n %s:", fct->f_name);
+		fprintf(ctx->sc_fp,"\n %s:", fct->f_name);
 		srv = fct->f_serv;
 		n = 0;
 		while (srv != NULL)
 		{
-	 	if ( (n % 3) == 0 )	fprintf (fp, "\n");
+	 	if ( (n % 3) == 0 )	fprintf (ctx->sc_fp, "\n");
 			/* Imprime a sequencia por servidor: num do servidor - num da token em servico
 			   (0 sem tkn em servico) - prioridade da token - uso acumulado do servidor */
-			fprintf(fp,"    [%2d] - %2d; %2d; %6.2f; **",
-	            srv->fs_number, srv->fs_tkn, srv->fs_p_tkn, srv->fs_busy_time);
+			fprintf(ctx->sc_fp,"    [%2d] - %2d; %2d; %6.2f; **",
+	            srv->fs_number, srv->fs_tkn, srv->fs_p_tkn, sumValue(&srv->fs_busy_time));
 			n++;
 			srv = srv->fs_next;
 		}
 		fct = fct->fct_next;
 	}
-	fclose(fp);
+	fclose(ctx->sc_fp);
+}
+
+static int dbg_fct_queue_elem(struct fqueue *que, int n)
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if ( (n % 3) == 0 )	fprintf (ctx->sc_fp, "\n");
+	/* Imprime a sequencia por facility das informacoes da fila se houver:
+		 prioridade da tkn - num do tkn - tempo de proc do tkn - evento associado a tkn */
+	fprintf(ctx->sc_fp,"    [%2d] - %2d; %2d; %6.2f; %2d **",
+	        n, que->fq_pri, que->fq_tkn, que->fq_time, que->fq_ev);
+	return (n + 1);
 }
 
 void dbg_fct_queue()
 {
+	struct simmContext *ctx = SIMM_CTX;
 	struct facilit *fct;
-	struct fqueue *que;
-	int n = 0;
+	struct fqueue *que, *que_level;
+	int n = 0, level;
 
-	fp = fopen("debug_cr.txt","a");
+	ctx->sc_fp = fopen("debug_cr.txt","a");
 
-	fprintf(fp, "\n\n[Facilitys - Filas]:");
+	fprintf(ctx->sc_fp, "\n\n[Facilitys - Filas]:");
 /*fprintf(fp, "\n --------------\n"); */
 
-	fct = sim[sn].fct_begin;
+	fct = ctx->sc_sim[ctx->sc_sn].fct_begin;
 	while (fct != NULL)
 	{
-		fprintf(fp,"\n %s:", fct->f_name);
+		fprintf(ctx->sc_fp,"\n %s:", fct->f_name);
 		if (fct->f_n_length_q > 0 )
 		{
 			n = 0;
-			que = fct->f_queue;
-			while (que != NULL)
-			{
-	 			if ( (n % 3) == 0 )	fprintf (fp, "\n");
-				/* Imprime a sequencia por facility das informacoes da fila se houver:
-					 prioridade da tkn - num do tkn - tempo de proc do tkn - evento associado a tkn */
-				fprintf(fp,"    [%2d] - %2d; %2d; %6.2f; %2d **",
-		            n, que->fq_pri, que->fq_tkn, que->fq_time, que->fq_ev);
-				n++;
-				que = que->fq_next;
-			}
+			/* ordem de atendimento:  prioridades acima da faixa de nveis, nveis FQ_LEVELS-1 a 0, prioridades abaixo */
+			for (que = fct->f_queue; que != NULL && que->fq_pri >= FQ_LEVELS; que = que->fq_next)
+				n = dbg_fct_queue_elem(que, n);
+			for (level = FQ_LEVELS - 1; level >= 0; level--)
+				for (que_level = fct->f_q_head[level]; que_level != NULL; que_level = que_level->fq_next)
+					n = dbg_fct_queue_elem(que_level, n);
+			for (; que != NULL; que = que->fq_next)
+				n = dbg_fct_queue_elem(que, n);
 		}
 		else
 		{
-			fprintf(fp,"\n    Fila vazia");
+			fprintf(ctx->sc_fp,"\n    Fila vazia");
 		}
 
 		fct = fct->fct_next;
 	}
-	fclose(fp);
+	fclose(ctx->sc_fp);
 }
 
 
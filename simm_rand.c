@@ -13,6 +13,30 @@
 *         pareto random variate generator (from Kenneth J. Christensen's page) included
 *           20.Dec.2005 Marcos Portnoi
 *
+*         estado dos geradores (sementes, stream corrente, randJain, normal) movido para o contexto de simulao
+*           corrente (struct simmContext); ranf no usa mais rand() da biblioteca C, mas o mesmo algoritmo com o estado
+*           no contexto (ranfNext), o que permite replicaes em paralelo em threads
+*           17.Out.2026
+*
+*         ranf (CPU==0) passa a usar o gerador xoshiro256++, com um estado por stream, nmero ilimitado de streams e
+*           streams separados por jump-ahead (2^128 valores); replicaes usam famlias de streams separadas por long
+*           jump (2^192).  Funes com stream explcito:  ranf_s, uniform_s, irandom_s, expntl_s, erlang_s, hyperx_s,
+*           normal_s, pareto_s.  O gerador anterior (seqncia de rand() da glibc) continua disponvel com RANF_CLASSIC 1
+*           17.Out.2026
+*
+*         valores uniformes gerados em blocos de RNG_BUF por stream; funes de gerao em bloco (ranf_bulk, uniform_bulk,
+*           expntl_bulk, normal_bulk, pareto_bulk), que produzem exatamente os mesmos valores que as chamadas individuais
+*           17.Out.2026
+*
+*         normal e expntl (xoshiro256++) passam a usar o mtodo ziggurat (Marsaglia e Tsang), com 256 camadas, que no caso
+*           mais comum usa um nico valor de 64 bits do gerador e nenhuma funo transcendental; os mtodos anteriores
+*           (polar e inverso) continuam disponveis com VARIATE_CLASSIC 1
+*           17.Out.2026
+*
+*         streams nomeados (rngNamedStream), para nmeros aleatrios comuns entre configuraes de um modelo, e modo de
+*           variveis antitticas (rngAntithetic)
+*           17.Out.2026
+*
 * Copyright (C) 2002, 2005, 2006, 2007 Marcos Portnoi, Sergio F. Brito
 *
 * This file is part of TARVOS Computer Networks Simulator.
@@ -36,18 +60,370 @@
 #define CPU 0           /* CPU type:  8086 or 68000 or 0 (random C
 													library function)  */
 
+#ifndef RANF_CLASSIC
+#define RANF_CLASSIC 0	/* com CPU 0:  1 reproduz a seqncia de rand() da glibc, com um nico gerador para todos os streams
+						   (resultados anteriores ao xoshiro256++); 0 usa o xoshiro256++ com um gerador por stream */
+#endif
+
+#ifndef VARIATE_CLASSIC
+#define VARIATE_CLASSIC RANF_CLASSIC	/* com o xoshiro256++:  1 gera normal e expntl pelos mtodos polar e de inverso
+										   (resultados anteriores ao ziggurat); 0 usa o ziggurat */
+#endif
+#define ZIGGURAT (CPU==0 && !RANF_CLASSIC && !VARIATE_CLASSIC)
+
 #define then
 
 #define A 16807L           /* multiplier (7**5) for 'ranf' */
 #define M 2147483647L      /* modulus (2**31-1) for 'ranf' */
 
 
-static long In[16]= {0L,   /* seeds for streams 1 thru 15  */
+static const long InSeeds[16]= {0L,   /* seeds for streams 1 thru 15  */
   1973272912L,  747177549L,   20464843L,  640830765L, 1098742207L,
     78126602L,   84743774L,  831312807L,  124667236L, 1172177002L,
   1124933064L, 1223960546L, 1878892440L, 1449793615L,  553303732L};
 
-static int strm=1;         /* index of current stream */
+/* As sementes dos streams 1 a 15 (sc_In) e o stream corrente (sc_strm) ficam no contexto de simulao corrente */
+
+#define RANF_MAX	2147483647			/* maior valor retornado por ranfNext */
+
+#if CPU==0 && RANF_CLASSIC
+/*-------------  GERADOR CLSSICO USADO POR ranf (CPU==0, RANF_CLASSIC)  -------------
+*
+*  Gerador aditivo com realimentao x[i] = x[i-3] + x[i-31], o mesmo algoritmo de random()/rand() da glibc, com o estado
+*  no contexto de simulao em vez de oculto na biblioteca C.  Aps ranfSeed(ctx, n), produz exatamente a seqncia que
+*  rand() produziria aps srand(n) na glibc.
+*/
+static void ranfSeed(struct simmContext *ctx, unsigned int n)
+{
+	int i;
+	long w;
+
+	ctx->sc_rnd[0] = (n == 0 ? 1 : (int)n);
+	for (i = 1; i < 31; i++)	/* 16807 * x mod (2**31 - 1), sem overflow (Schrage) */
+	{
+		w = 16807L * (ctx->sc_rnd[i-1] % 127773) - 2836L * (ctx->sc_rnd[i-1] / 127773);
+		if (w < 0)
+			w += 2147483647;
+		ctx->sc_rnd[i] = (int)w;
+	}
+	ctx->sc_rnd_f = 3;
+	ctx->sc_rnd_r = 0;
+	for (i = 0; i < 310; i++)	/* descarta os primeiros valores, como a glibc */
+	{
+		ctx->sc_rnd[ctx->sc_rnd_f] = (int)((unsigned int)ctx->sc_rnd[ctx->sc_rnd_f] + (unsigned int)ctx->sc_rnd[ctx->sc_rnd_r]);
+		ctx->sc_rnd_f = (ctx->sc_rnd_f + 1) % 31;
+		ctx->sc_rnd_r = (ctx->sc_rnd_r + 1) % 31;
+	}
+}
+
+/* Retorna o prximo inteiro do gerador, entre 0 e RANF_MAX */
+static int ranfNext()
+{
+	struct simmContext *ctx = SIMM_CTX;
+	int f = ctx->sc_rnd_f, r = ctx->sc_rnd_r;
+
+	ctx->sc_rnd[f] = (int)((unsigned int)ctx->sc_rnd[f] + (unsigned int)ctx->sc_rnd[r]);
+	ctx->sc_rnd_f = (f == 30 ? 0 : f + 1);
+	ctx->sc_rnd_r = (r == 30 ? 0 : r + 1);
+	return ((int)((unsigned int)ctx->sc_rnd[f] >> 1));
+}
+#endif
+
+#if CPU==0 && !RANF_CLASSIC
+/*-------------  GERADOR xoshiro256++ (CPU==0)  -------------
+*
+*  xoshiro256++ (D. Blackman, S. Vigna), perodo 2^256 - 1.  Cada stream n (1, 2, ...) tem o seu prprio estado; o stream 1
+*  parte do estado obtido da semente do contexto (rngSeed) por splitmix64, e o stream n+1 parte do estado inicial do stream n
+*  avanado de 2^128 valores (jump), de modo que os streams no se sobrepem.  A replicao r (rngReplication) avana o
+*  estado da semente de r * 2^192 valores (long jump) antes de criar os streams.  Os streams so criados sob demanda.
+*
+*  Streams nomeados (rngNamedStream) no dependem da ordem em que so criados:  o estado inicial  obtido por splitmix64 da
+*  semente, da replicao e de um hash do nome (e do stream corrente no momento da criao).  Assim, uma fonte de trfego ou
+*  um ponto de deciso aleatria do modelo recebe a mesma seqncia em duas configuraes diferentes do modelo (nmeros
+*  aleatrios comuns), mesmo que uma delas crie outros streams ou consuma mais valores de outros streams.  Os estados no so
+*  separados por jumps, mas a probabilidade de sobreposio de dois streams no perodo de 2^256  desprezvel.
+*
+*  No segundo membro de um par antittico (rngAntithetic(RNG_ANTI_MIRROR)), os 56 bits superiores de cada valor de 64 bits
+*  so invertidos:  os valores uniformes passam de u para 1 - u (exatamente), e no ziggurat a camada  mantida e a abscissa
+*   espelhada (normal:  x -> -x no caso comum).  Como o espelhamento s dentro da camada quase no produz correlao negativa
+*  na exponencial, expntl usa a inverso (montona em u) nos dois membros do par (RNG_ANTI_FIRST e RNG_ANTI_MIRROR).
+*/
+static const unsigned long long rngJumpPoly[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+static const unsigned long long rngLongJumpPoly[4] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+
+static unsigned long long rngRotl(unsigned long long x, int k)
+{
+	return ((x << k) | (x >> (64 - k)));
+}
+
+/* Prximo valor de 64 bits do gerador de estado st */
+static unsigned long long rngNext(unsigned long long *st)
+{
+	unsigned long long result = rngRotl(st[0] + st[3], 23) + st[0];
+	unsigned long long t = st[1] << 17;
+
+	st[2] ^= st[0];
+	st[3] ^= st[1];
+	st[1] ^= st[2];
+	st[0] ^= st[3];
+	st[2] ^= t;
+	st[3] = rngRotl(st[3], 45);
+	return (result);
+}
+
+/* Avana o estado st de 2^128 (rngJumpPoly) ou 2^192 (rngLongJumpPoly) valores */
+static void rngJump(unsigned long long *st, const unsigned long long *poly)
+{
+	unsigned long long s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	int i, b;
+
+	for (i = 0; i < 4; i++)
+		for (b = 0; b < 64; b++)
+		{
+			if (poly[i] & (1ULL << b))
+			{
+				s0 ^= st[0];
+				s1 ^= st[1];
+				s2 ^= st[2];
+				s3 ^= st[3];
+			}
+			rngNext(st);
+		}
+	st[0] = s0;
+	st[1] = s1;
+	st[2] = s2;
+	st[3] = s3;
+}
+
+#define RNG_MIRROR	0xffffffffffffff00ULL	/* bits invertidos no modo antittico */
+
+/* Preenche o estado st a partir de x (splitmix64) */
+static void rngSplitMix(unsigned long long x, unsigned long long *st)
+{
+	unsigned long long z;
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		st[i] = z ^ (z >> 31);
+	}
+}
+
+/* Estado inicial do stream nomeado rn, a partir da semente e da replicao do contexto */
+static void rngNamedStart(struct simmContext *ctx, struct rngNamed *rn)
+{
+	rngSplitMix(ctx->sc_rng_seed ^ rn->rn_key ^ ((unsigned long long)ctx->sc_rng_rep * 0xd1b54a32d192ed03ULL), rn->rn_st.rs_s);
+	rn->rn_st.rs_z2 = 0.0;
+	rn->rn_st.rs_pos = RNG_BUF;
+	rn->rn_st.rs_anti = (ctx->sc_rng_anti == RNG_ANTI_MIRROR);
+}
+
+/* Descarta os streams numerados do contexto, calcula o estado inicial do stream 1 a partir da semente e da replicao e
+*  reinicia os streams nomeados */
+static void rngRestart(struct simmContext *ctx)
+{
+	int i;
+
+	rngSplitMix(ctx->sc_rng_seed, ctx->sc_rng_next);
+	for (i = 0; i < ctx->sc_rng_rep; i++)
+		rngJump(ctx->sc_rng_next, rngLongJumpPoly);
+	free(ctx->sc_rng);
+	ctx->sc_rng = NULL;
+	ctx->sc_rng_n = ctx->sc_rng_size = 0;
+	for (i = 0; i < ctx->sc_rngn_n; i++)
+		rngNamedStart(ctx, &ctx->sc_rngn[i]);
+}
+
+/* Retorna o stream n do contexto, criando-o (e os anteriores) se necessrio */
+static struct rngStream *rngGet(struct simmContext *ctx, int n)
+{
+	if (n <= ctx->sc_rng_n && n > 0)
+		return (&ctx->sc_rng[n - 1]);
+	if (n > RNG_NAMED)
+	{
+		if (n - RNG_NAMED > ctx->sc_rngn_n)
+			error(0, "ranf_s Argument Error: named stream not created");
+		return (&ctx->sc_rngn[n - RNG_NAMED - 1].rn_st);
+	}
+	if (n < 1)
+		error(0, "ranf_s Argument Error: stream < 1");
+	if (n > ctx->sc_rng_size)
+	{
+		if (ctx->sc_rng_size == 0)
+			ctx->sc_rng_size = 16;
+		while (ctx->sc_rng_size < n)
+			ctx->sc_rng_size *= 2;
+		ctx->sc_rng = (struct rngStream*)realloc(ctx->sc_rng, ctx->sc_rng_size * sizeof *ctx->sc_rng);
+		if (ctx->sc_rng == NULL)
+		{
+			printf("\nError - ranf - insufficient memory to allocate for random streams");
+			exit(1);
+		}
+	}
+	while (ctx->sc_rng_n < n)
+	{
+		memcpy(ctx->sc_rng[ctx->sc_rng_n].rs_s, ctx->sc_rng_next, sizeof ctx->sc_rng_next);
+		ctx->sc_rng[ctx->sc_rng_n].rs_z2 = 0.0;
+		ctx->sc_rng[ctx->sc_rng_n].rs_pos = RNG_BUF;
+		ctx->sc_rng[ctx->sc_rng_n].rs_anti = (ctx->sc_rng_anti == RNG_ANTI_MIRROR);
+		ctx->sc_rng_n++;
+		rngJump(ctx->sc_rng_next, rngJumpPoly);
+	}
+	return (&ctx->sc_rng[n - 1]);
+}
+
+/* Gera os prximos RNG_BUF valores uniformes do stream st (53 bits, em (0, 1):  nunca 0 nem 1).  A recorrncia do gerador 
+*  seqencial; a converso para double fica num lao separado, que o compilador pode vetorizar.  A seqncia  a mesma que
+*  seria obtida gerando um valor por vez. */
+static void rngRefill(struct rngStream *st)
+{
+	int i;
+
+	for (i = 0; i < RNG_BUF; i++)
+		st->rs_r[i] = rngNext(st->rs_s);
+	if (st->rs_anti)
+		for (i = 0; i < RNG_BUF; i++)
+			st->rs_r[i] ^= RNG_MIRROR;
+	for (i = 0; i < RNG_BUF; i++)
+		st->rs_u[i] = ((double)(st->rs_r[i] >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+	st->rs_pos = 0;
+}
+
+/* Prximo valor uniforme em (0, 1) do stream st */
+static double rngUniform(struct rngStream *st)
+{
+	if (st->rs_pos == RNG_BUF)
+		rngRefill(st);
+	return (st->rs_u[st->rs_pos++]);
+}
+
+/* Prximo valor de 64 bits do stream st; consome a mesma posio da seqncia que rngUniform */
+static unsigned long long rngRaw(struct rngStream *st)
+{
+	if (st->rs_pos == RNG_BUF)
+		rngRefill(st);
+	return (st->rs_r[st->rs_pos++]);
+}
+#endif
+
+#if ZIGGURAT
+/*-------------  MTODO ZIGGURAT PARA normal E expntl  -------------
+*
+*  G. Marsaglia, W. W. Tsang, "The Ziggurat Method for Generating Random Variables", J. Stat. Software 5(8), 2000.  A rea
+*  sob a densidade  coberta por ZIG_N camadas horizontais de mesma rea; x[i]  a largura da camada i (x[0]  a largura
+*  equivalente da base, que inclui a cauda, x[1] = r  o incio da cauda e x[ZIG_N] = 0) e f[i] = f(x[i]).  Os 8 bits
+*  inferiores do valor de 64 bits escolhem a camada e os 53 superiores a abscissa; se esta cai dentro da camada de cima
+*  (x < x[i+1]), o valor  aceito sem outros clculos, o que ocorre em cerca de 99% das vezes.  Caso contrrio, testa-se
+*  a cunha sob a curva ou gera-se a cauda, com valores uniformes adicionais do mesmo stream.  As tabelas so calculadas
+*  uma nica vez, na inicializao do programa (antes de main, portanto antes de qualquer thread).
+*/
+#define ZIG_N	256
+
+struct zigTables {
+	double xn[ZIG_N + 1], fn[ZIG_N + 1];	/* normal:  f(x) = exp(-x*x/2) */
+	double xe[ZIG_N + 1], fe[ZIG_N + 1];	/* exponencial:  f(x) = exp(-x) */
+};
+
+static struct zigTables zigBuild()
+{
+	const double rn = 3.6541528853610088, vn = 4.92867323399e-3;			/* incio da cauda e rea de cada camada */
+	const double re = 7.69711747013104972, ve = 3.9496598225815571993e-3;
+	struct zigTables t;
+	int i;
+
+	t.xn[0] = vn / exp(-0.5 * rn * rn);
+	t.xn[1] = rn;
+	t.xe[0] = ve / exp(-re);
+	t.xe[1] = re;
+	for (i = 2; i < ZIG_N; i++)
+	{
+		t.xn[i] = sqrt(-2.0 * log(vn / t.xn[i-1] + exp(-0.5 * t.xn[i-1] * t.xn[i-1])));
+		t.xe[i] = -log(ve / t.xe[i-1] + exp(-t.xe[i-1]));
+	}
+	t.xn[ZIG_N] = t.xe[ZIG_N] = 0.0;
+	for (i = 0; i <= ZIG_N; i++)
+	{
+		t.fn[i] = exp(-0.5 * t.xn[i] * t.xn[i]);
+		t.fe[i] = exp(-t.xe[i]);
+	}
+	return (t);
+}
+
+static const struct zigTables zig = zigBuild();
+
+/* Varivel normal padro (mdia 0, desvio padro 1) do stream st */
+static double zigNormal(struct rngStream *st)
+{
+	unsigned long long w;
+	double u, x, a, b;
+	int i;
+
+	for (;;)
+	{
+		w = rngRaw(st);
+		i = (int)(w & 0xff);
+		u = ((double)(w >> 11) + 0.5) * (2.0 / 9007199254740992.0) - 1.0;	/* em (-1, 1) */
+		x = u * zig.xn[i];
+		if (fabs(x) < zig.xn[i+1])
+			return (x);
+		if (i == 0)		/* cauda, |x| > r */
+		{
+			do
+			{
+				a = -log(rngUniform(st)) / zig.xn[1];
+				b = -log(rngUniform(st));
+			} while (b + b < a * a);
+			return (u < 0.0 ? -(zig.xn[1] + a) : zig.xn[1] + a);
+		}
+		if (zig.fn[i+1] + (zig.fn[i] - zig.fn[i+1]) * rngUniform(st) < exp(-0.5 * x * x))
+			return (x);
+	}
+}
+
+/* Varivel exponencial de mdia 1 do stream st */
+static double zigExpntl(struct rngStream *st)
+{
+	unsigned long long w;
+	double x;
+	int i;
+
+	for (;;)
+	{
+		w = rngRaw(st);
+		i = (int)(w & 0xff);
+		x = ((double)(w >> 11) + 0.5) * (1.0 / 9007199254740992.0) * zig.xe[i];
+		if (x < zig.xe[i+1])
+			return (x);
+		if (i == 0)		/* cauda:  sem memria, r mais uma nova exponencial */
+			return (zig.xe[1] - log(rngUniform(st)));
+		if (zig.fe[i+1] + (zig.fe[i] - zig.fe[i+1]) * rngUniform(st) < exp(-x))
+			return (x);
+	}
+}
+#endif
+
+/* Valores iniciais do estado dos geradores num contexto de simulao novo (chamada pelo kernel) */
+void ranfContextInit(struct simmContext *ctx)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		ctx->sc_In[i] = InSeeds[i];
+	ctx->sc_strm = 1;
+	ctx->sc_z2 = 0.0;
+	ctx->sc_jain_x = 1;
+#if CPU==0 && RANF_CLASSIC
+	ranfSeed(ctx, 1);	/* estado de rand() antes de qualquer srand() */
+#endif
+#if CPU==0 && !RANF_CLASSIC
+	ctx->sc_rng_seed = 1;
+	ctx->sc_rng_rep = 0;
+	rngRestart(ctx);
+#endif
+}
 
 /* FILE	*istf, *ostf; */
 static	char	state1[256],state2[256];
@@ -61,19 +437,20 @@ static	char	state1[256],state2[256];
 /*--------------------------------------------------------------------*/
 double ranf()
   {
+    struct simmContext *ctx = SIMM_CTX;
     short *p,*q,k; long Hi,Lo;
     /* generate product using double precision simulation  (comments  */
     /* refer to In's lower 16 bits as "L", its upper 16 bits as "H")  */
 /*here*/
-	p=(short *) & In[strm]; Hi= *(p+1)*A;                 /* 16807*H->Hi */
-    *(p+1)=0; Lo=In[strm]*A;                           /* 16807*L->Lo */
+	p=(short *) & ctx->sc_In[ctx->sc_strm]; Hi= *(p+1)*A;                 /* 16807*H->Hi */
+    *(p+1)=0; Lo=ctx->sc_In[ctx->sc_strm]*A;                           /* 16807*L->Lo */
     p=(short *)&Lo; Hi+= *(p+1);    /* add high-order bits of Lo to Hi */
     q=(short *)&Hi;                       /* low-order bits of Hi->LO */
     *(p+1)= *q&0X7FFF;                               /* clear sign bit */
     k= *(q+1)<<1; if (*q&0X8000) then k++;         /* Hi bits 31-45->K */
     /* form Z + K [- M] (where Z=Lo): presubtract M to avoid overflow */
     Lo-=M; Lo+=k; if (Lo<0) then Lo+=M;
-    In[strm]=Lo;
+    ctx->sc_In[ctx->sc_strm]=Lo;
     return((double)Lo*4.656612875E-10);             /* Lo x 1/(2**31-1) */
   }
 #endif
@@ -87,23 +464,24 @@ double ranf()
 /*--------------------------------------------------------------------*/
 double ranf()
   {
+    struct simmContext *ctx = SIMM_CTX;
     short *p,*q,k; long Hi,Lo;
     /* generate product using double precision simulation  (comments  */
     /* refer to In's lower 16 bits as "L", its upper 16 bits as "H")  */
-    p=(short *)&In[strm]; Hi= *(p)*A;                   /* 16807*H->Hi */
-    *(p)=0; Lo=In[strm]*A;                             /* 16807*L->Lo */
+    p=(short *)&ctx->sc_In[ctx->sc_strm]; Hi= *(p)*A;                   /* 16807*H->Hi */
+    *(p)=0; Lo=ctx->sc_In[ctx->sc_strm]*A;                             /* 16807*L->Lo */
     p=(short *)&Lo; Hi+= *(p);      /* add high-order bits of Lo to Hi */
     q=(short *)&Hi;                       /* low-order bits of Hi->LO */
     *(p)= *(q+1)&0X7FFF;                             /* clear sign bit */
     k= *(q)<<1; if (*(q+1)&0X8000) then k++;       /* Hi bits 31-45->K */
     /* form Z + K [- M] (where Z=Lo): presubtract M to avoid overflow */
     Lo-=M; Lo+=k; if (Lo<0) then Lo+=M;
-    In[strm]=Lo;
+    ctx->sc_In[ctx->sc_strm]=Lo;
     return((double)Lo*4.656612875E-10);             /* Lo x 1/(2**31-1) */
   }
 #endif
 
-#if CPU==0
+#if CPU==0 && RANF_CLASSIC
 /*-------------  UNIFORM [0, 1] RANDOM NUMBER GENERATOR  -------------*/
 /*                                                                    */
 /* This implementation uses the C library function "random" available */
@@ -116,16 +494,147 @@ double ranf()
 double ranf() {
 	/* return(random()/2.147483647E9); Para o  UNIX */
 	double num_alea;
-	num_alea = rand ();
+	num_alea = ranfNext ();
 	if ( num_alea < 0.) {
 		printf ("\nError - ranf - random number less than zero");
 		exit(0);
 	}
 	while (num_alea == 0.) {															/* Para evitar que ranf gere 0*/
-		num_alea = rand ();																/* Para o Visual C */
+		num_alea = ranfNext ();
 	}
-	return ( (float) num_alea / RAND_MAX );
+	if (SIMM_CTX->sc_rng_anti == RNG_ANTI_MIRROR)										/* modo antittico:  continua em (0, 1] */
+		num_alea = RANF_MAX + 1.0 - num_alea;
+	return ( (float) num_alea / RANF_MAX );
   }
+
+/* Com o gerador clssico h um nico gerador:  o stream n  ignorado */
+double ranf_s(int n) {
+	return (ranf());
+}
+#endif
+
+#if CPU==0 && !RANF_CLASSIC
+/*-------------  UNIFORM (0, 1) RANDOM NUMBER GENERATOR  -------------*/
+/*                                                                    */
+/* xoshiro256++, um gerador por stream; nunca retorna 0 (geradores    */
+/* que usam log) nem 1.                                               */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+double ranf() {
+	struct simmContext *ctx = SIMM_CTX;
+
+	return (rngUniform(rngGet(ctx, ctx->sc_strm)));
+}
+
+/* Valor uniforme em (0, 1) do stream n (1, 2, ...), sem alterar o stream corrente */
+double ranf_s(int n) {
+	return (rngUniform(rngGet(SIMM_CTX, n)));
+}
+
+/* Define a semente do contexto:  todos os streams recomeam a partir dela */
+void rngSeed(unsigned long long s) {
+	struct simmContext *ctx = SIMM_CTX;
+
+	ctx->sc_rng_seed = s;
+	rngRestart(ctx);
+}
+
+/* Escolhe a famlia de streams da replicao rep (0, 1, 2, ...), separada das demais por long jumps; os streams recomeam */
+void rngReplication(int rep) {
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (rep < 0)
+		error(0, "rngReplication Argument Error");
+	ctx->sc_rng_rep = rep;
+	rngRestart(ctx);
+}
+
+/* Retorna o nmero do stream nomeado name, criando-o no primeiro uso (ver comentrio do gerador xoshiro256++).  O nmero pode
+*  ser usado com as funes _s e com stream(). */
+int rngNamedStream(char *name) {
+	struct simmContext *ctx = SIMM_CTX;
+	struct rngNamed *rn;
+	unsigned long long h = 0xcbf29ce484222325ULL;	/* FNV-1a */
+	char *p;
+	int i;
+
+	if (strlen(name) >= sizeof rn->rn_name)
+		error(0, "rngNamedStream Argument Error: name too long");
+	for (i = 0; i < ctx->sc_rngn_n; i++)
+		if (strcmp(ctx->sc_rngn[i].rn_name, name) == 0)
+			return (RNG_NAMED + i + 1);
+	if (ctx->sc_rngn_n == ctx->sc_rngn_size)
+	{
+		ctx->sc_rngn_size = (ctx->sc_rngn_size == 0 ? 16 : 2 * ctx->sc_rngn_size);
+		ctx->sc_rngn = (struct rngNamed*)realloc(ctx->sc_rngn, ctx->sc_rngn_size * sizeof *ctx->sc_rngn);
+		if (ctx->sc_rngn == NULL)
+		{
+			printf("\nError - rngNamedStream - insufficient memory to allocate for random streams");
+			exit(1);
+		}
+	}
+	for (p = name; *p; p++)
+		h = (h ^ (unsigned char)*p) * 0x100000001b3ULL;
+	rn = &ctx->sc_rngn[ctx->sc_rngn_n++];
+	strcpy(rn->rn_name, name);
+	rn->rn_key = h ^ ((unsigned long long)ctx->sc_strm * 0x94d049bb133111ebULL);
+	rngNamedStart(ctx, rn);
+	return (RNG_NAMED + ctx->sc_rngn_n);
+}
+
+/* Define o modo antittico (RNG_ANTI_OFF, RNG_ANTI_FIRST ou RNG_ANTI_MIRROR):  as duas simulaes de um par devem usar a
+*  mesma semente e replicao, a primeira com RNG_ANTI_FIRST e a segunda com RNG_ANTI_MIRROR.  Todos os streams recomeam. */
+void rngAntithetic(int mode) {
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (mode < RNG_ANTI_OFF || mode > RNG_ANTI_MIRROR)
+		error(0, "rngAntithetic Argument Error");
+	ctx->sc_rng_anti = mode;
+	rngRestart(ctx);
+}
+#endif
+
+#if CPU!=0 || RANF_CLASSIC
+/* Geradores com nmero fixo de streams:  ranf_s usa o stream n temporariamente (CPU!=0); a semente  a do stream
+*  corrente e a replicao escolhe o stream usado pelo prximo simm() */
+#if CPU!=0
+double ranf_s(int n) {
+	struct simmContext *ctx = SIMM_CTX;
+	int s = ctx->sc_strm;
+	double u;
+
+	ctx->sc_strm = n;
+	u = ranf();
+	ctx->sc_strm = s;
+	return (u);
+}
+#endif
+
+void rngSeed(unsigned long long s) {
+	struct simmContext *ctx = SIMM_CTX;
+
+#if CPU==0
+	ranfSeed(SIMM_CTX, (unsigned int)s);
+#else
+	seed((long)s, ctx->sc_strm);
+#endif
+}
+
+void rngReplication(int rep) {
+	SIMM_CTX->sc_rns = (CPU==0 ? rep : (rep - 1) % 15 + 1);
+}
+
+/* H um nico gerador (CPU==0) ou 15 streams fixos:  os streams nomeados so o stream corrente */
+int rngNamedStream(char *name) {
+	return (SIMM_CTX->sc_strm);
+}
+
+/* Modo antittico:  s com CPU==0, onde ranf passa a retornar os valores espelhados com RNG_ANTI_MIRROR */
+void rngAntithetic(int mode) {
+	if (mode < RNG_ANTI_OFF || mode > RNG_ANTI_MIRROR)
+		error(0, "rngAntithetic Argument Error");
+	SIMM_CTX->sc_rng_anti = mode;
+}
 #endif
 
 /*--------------------  SELECT GENERATOR STREAM  ---------------------*/
@@ -165,54 +674,78 @@ stream(n)
 
 int stream (int n)
 {
+	struct simmContext *ctx = SIMM_CTX;
+
 	/* set stream for 1<=n<=15, returns stream for n= 0 */
 
 	if ((n<0) || (n>15)) then error (0,"Stream Argument Error");
-	if (n) strm=n;
-	return (strm);
+	if (n) ctx->sc_strm=n;
+	return (ctx->sc_strm);
 }
 #endif
 
 //This stream function definition uses de C library 'srand' function to seed the random number generator
 //  (included mainly for backward compatibility with SMPL)
 //  Use 'x=stream(0)' to return the actual stream number
-//  Use 'stream(n)' to set the stream (or seed) to n (n can be any integer)
+//  Use 'stream(n)' to set the stream (or seed) to n (n can be any non-negative integer)
 //included July/2005 by Marcos Portnoi
+//With xoshiro256++ (RANF_CLASSIC 0), stream(n) with 1 <= n <= RNG_STREAMS (or a number returned by rngNamedStream) selects
+//  stream n, which continues from where it stopped; any other n is taken as a seed, like rngSeed(n):  all streams restart
+//  from it and stream 1 becomes the current stream (so stream(0) then returns 1).  Streams are only created when used, so
+//  e.g. stream(time(NULL)) costs no more than stream(1)
 #if CPU==0
 
 int stream (int n) {
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (n < 0) then error(0,"stream Argument Error");
 	if (n) {
-		strm=n;
-		srand(strm);
+		ctx->sc_strm=n;
+#if RANF_CLASSIC
+		ranfSeed(ctx, ctx->sc_strm);
+#else
+		if (n > RNG_STREAMS && (n <= RNG_NAMED || n - RNG_NAMED > ctx->sc_rngn_n)) {	/* valor de semente, no nmero de stream */
+			rngSeed((unsigned long long)n);
+			ctx->sc_strm=1;
+		}
+#endif
 		//let's have this functionality below deactivated for now
 		//randJain(strm);  //seeds Jain's random number generator too with the same seed
 	}
-	return (strm);
+	return (ctx->sc_strm);
 }
 #endif
 
 /*--------------------------  SET/GET SEED  --------------------------*/
 long seed(long Ik, int n) { /* set seed of stream n for Ik>0, return current seed for Ik=0  */
+  struct simmContext *ctx = SIMM_CTX;
+
   if ((n<1)||(n>15)) then error(0,"seed Argument Error");
-  if (Ik>0L) then  In[n]=Ik;
-  return(In[n]);
+  if (Ik>0L) then  ctx->sc_In[n]=Ik;
+  return(ctx->sc_In[n]);
 }
 
 /*------------  UNIFORM [a, b] RANDOM VARIATE GENERATOR  -------------*/
-double uniform(double a, double b) { 
+/*  As funes terminadas em _s usam o stream n; as demais, o stream  */
+/*  corrente (stream()).                                              */
+double uniform_s(int n, double a, double b) { 
 	/* 'uniform' returns a pseudo-random variate from a uniform     */
     /* distribution with lower bound a and upper bound b.           */
     if (a>b) then error(0,"uniform Argument Error: a > b");
-    return(a+(b-a)*ranf());
+    return(a+(b-a)*ranf_s(n));
+}
+
+double uniform(double a, double b) {
+	return(uniform_s(SIMM_CTX->sc_strm,a,b));
 }
 
 /*--------------------  RANDOM INTEGER GENERATOR  --------------------*/
-int irandom(int i,int n)
+int irandom_s(int s, int i, int n)
 { /* 'random' returns an integer equiprobably selected from the   */
   /* set of integers i, i+1, i+2, . . , n.                        */
   double num_alea;
 	if (i>n) then error(0,"random Argument Error: i > n");
- 	num_alea = ranf();
+ 	num_alea = ranf_s(s);
 	if ( num_alea == 1. )
 	{
 		return (n);
@@ -222,51 +755,90 @@ int irandom(int i,int n)
   return(i+n);
 }
 
+int irandom(int i,int n)
+{
+	return(irandom_s(SIMM_CTX->sc_strm,i,n));
+}
+
 /*--------------  EXPONENTIAL RANDOM VARIATE GENERATOR  --------------*/
-double expntl(double x)
+double expntl_s(int n, double x)
 { /* 'expntl' returns a psuedo-random variate from a negative     */
   /* exponential distribution with mean x.                        */
-  return(-x*log(ranf()));
+#if ZIGGURAT
+  struct simmContext *ctx = SIMM_CTX;
+
+  if (ctx->sc_rng_anti == RNG_ANTI_OFF)
+    return(x*zigExpntl(rngGet(ctx,n)));
+#endif
+  return(-x*log(ranf_s(n)));
+}
+
+double expntl(double x)
+{
+  return(expntl_s(SIMM_CTX->sc_strm,x));
 }
 
 /*----------------  ERLANG RANDOM VARIATE GENERATOR  -----------------*/
-double erlang(double x, double s)
+double erlang_s(int n, double x, double s)
 { /* 'erlang' returns a psuedo-random variate from an erlang      */
   /* distribution with mean x and standard deviation s.           */
   int i,k; double z;
   if (s>x) then error(0,"erlang Argument Error: s > x");
   z=x/s; k=(int) (z*z);
-  z=1.0; for (i=0; i<k; i++) z*=ranf();
+  z=1.0; for (i=0; i<k; i++) z*=ranf_s(n);
   return(-(x/k)*log(z));
 }
 
+double erlang(double x, double s)
+{
+  return(erlang_s(SIMM_CTX->sc_strm,x,s));
+}
+
 /*-----------  HYPEREXPONENTIAL RANDOM VARIATE GENERATION  -----------*/
-double hyperx(double x, double s)
+double hyperx_s(int n, double x, double s)
 { /* 'hyperx' returns a psuedo-random variate from Morse's two-   */
   /* stage hyperexponential distribution with mean x and standard */
   /* deviation s, s>x.  */
   double cv,z,p;
   if (s<=x) then error(0,"hyperx Argument Error: s not > x");
   cv=s/x; z=cv*cv; p=0.5*(1.0-sqrt((z-1.0)/(z+1.0)));
-  z=(ranf()>p)? (x/(1.0-p)):(x/p);
-  return(-0.5*z*log(ranf()));
+  z=(ranf_s(n)>p)? (x/(1.0-p)):(x/p);
+  return(-0.5*z*log(ranf_s(n)));
+}
+
+double hyperx(double x, double s)
+{
+  return(hyperx_s(SIMM_CTX->sc_strm,x,s));
 }
 
 /*-----------------  NORMAL RANDOM VARIATE GENERATOR  ----------------*/
-double normal(double x, double s)
+double normal_s(int n, double x, double s)
 { /* 'normal' returns a psuedo-random variate from a normal dis-  */
   /* tribution with mean x and standard deviation s.              */
-  double v1,v2,w,z1; static double z2=0.0;
-  if (z2!=0.0)
-    then {z1=z2; z2=0.0;}  /* use value from previous call */
+#if ZIGGURAT
+  return(x+s*zigNormal(rngGet(SIMM_CTX,n)));
+#else
+#if CPU==0 && !RANF_CLASSIC
+  double v1,v2,w,z1; double *z2 = &rngGet(SIMM_CTX,n)->rs_z2;	/* segundo valor guardado por stream */
+#else
+  double v1,v2,w,z1; double *z2 = &SIMM_CTX->sc_z2;
+#endif
+  if (*z2!=0.0)
+    then {z1= *z2; *z2=0.0;}  /* use value from previous call */
   else
   {
 		do
-			{v1=2.0*ranf()-1.0; v2=2.0*ranf()-1.0; w=v1*v1+v2*v2;}
+			{v1=2.0*ranf_s(n)-1.0; v2=2.0*ranf_s(n)-1.0; w=v1*v1+v2*v2;}
 		while (w>=1.0);
-		w=sqrt((-2.0*log(w))/w); z1=v1*w; z2=v2*w;
+		w=sqrt((-2.0*log(w))/w); z1=v1*w; *z2=v2*w;
   }
   return(x+z1*s);
+#endif
+}
+
+double normal(double x, double s)
+{
+  return(normal_s(SIMM_CTX->sc_strm,x,s));
 }
 
 /*
@@ -280,13 +852,17 @@ double normal(double x, double s)
 *   Email:  christen@csee.usf.edu 
 *
 */
-double pareto(double a, double k) {
+double pareto_s(int n, double a, double k) {
   double z;     // Uniform random number from 0 to 1
   double rv;    // RV to be returned
 
-  // Pull a uniform RV (0 < z < 1)
+  // Pull a uniform RV (0 < z < 1); the classic generators keep using randJain, as before
   do {
+#if CPU==0 && !RANF_CLASSIC
+    z = ranf_s(n);
+#else
     z = randJain(0);
+#endif
   } while ((z == 0) || (z == 1));
 
   // Generate Pareto rv using the inversion method
@@ -295,6 +871,91 @@ double pareto(double a, double k) {
   return(rv);
 }
 
+double pareto(double a, double k) {
+  return(pareto_s(SIMM_CTX->sc_strm, a, k));
+}
+
+/*
+*  GERAO EM BLOCO
+*
+*  Preenchem buf com count valores do stream n, exatamente os mesmos (e na mesma ordem) que count chamadas sucessivas da
+*  funo individual correspondente (ranf_s, uniform_s, expntl_s, normal_s, pareto_s) produziriam; assim, o resultado de
+*  uma simulao no depende de se usar uma forma ou a outra.  Os valores uniformes so copiados do buffer do stream e as
+*  transformaes so feitas num lao separado, sem dependncia entre elementos.
+*/
+void ranf_bulk(int n, double *buf, int count) {
+#if CPU==0 && !RANF_CLASSIC
+  struct rngStream *st = rngGet(SIMM_CTX, n);
+  int k;
+
+  while (count > 0) {
+    if (st->rs_pos == RNG_BUF)
+      rngRefill(st);
+    k = RNG_BUF - st->rs_pos;
+    if (k > count)
+      k = count;
+    memcpy(buf, &st->rs_u[st->rs_pos], k * sizeof *buf);
+    st->rs_pos += k;
+    buf += k;
+    count -= k;
+  }
+#else
+  int i;
+
+  for (i = 0; i < count; i++)
+    buf[i] = ranf_s(n);
+#endif
+}
+
+void uniform_bulk(int n, double a, double b, double *buf, int count) {
+  int i;
+
+  if (a>b) then error(0,"uniform Argument Error: a > b");
+  ranf_bulk(n, buf, count);
+  for (i = 0; i < count; i++)
+    buf[i] = a+(b-a)*buf[i];
+}
+
+void expntl_bulk(int n, double x, double *buf, int count) {
+  int i;
+
+#if ZIGGURAT
+  struct simmContext *ctx = SIMM_CTX;
+  struct rngStream *st;
+
+  if (ctx->sc_rng_anti == RNG_ANTI_OFF) {
+    st = rngGet(ctx, n);
+    for (i = 0; i < count; i++)
+      buf[i] = x*zigExpntl(st);
+    return;
+  }
+#endif
+  ranf_bulk(n, buf, count);
+  for (i = 0; i < count; i++)
+    buf[i] = -x*log(buf[i]);
+}
+
+/* Os mtodos polar e ziggurat rejeitam valores, logo o nmero de valores uniformes consumidos no  conhecido antes */
+void normal_bulk(int n, double x, double s, double *buf, int count) {
+  int i;
+
+  for (i = 0; i < count; i++)
+    buf[i] = normal_s(n, x, s);
+}
+
+void pareto_bulk(int n, double a, double k, double *buf, int count) {
+  int i;
+
+#if CPU==0 && !RANF_CLASSIC
+  ranf_bulk(n, buf, count);	/* valores em (0, 1):  pareto_s nunca rejeita */
+  for (i = 0; i < count; i++)
+    buf[i] = k / pow(buf[i], (1.0 / a));
+#else
+  for (i = 0; i < count; i++)
+    buf[i] = pareto_s(n, a, k);
+#endif
+}
+
 /*
 *  ALTERNATIVE UNIFORM RANDOM NUMBER GENERATOR
 *	
@@ -315,28 +976,28 @@ double randJain(int seed) {
   const long  m = 2147483647;  // Modulus
   const long  q =     127773;  // m div a
   const long  r =       2836;  // m mod a
-  static long x = 1;           // Random int value (default initial seed = 1)
+  long       *x = &SIMM_CTX->sc_jain_x;  // Random int value (default initial seed = 1), no contexto corrente
   long        x_div_q;         // x divided by q
   long        x_mod_q;         // x modulo q
   long        x_new;           // New x value
 
   // Set the seed if argument is non-zero and then return zero
   if (seed > 0) {
-    x = seed;
+    *x = seed;
     return(0.0);
   }
 
   // RNG using integer arithmetic
-  x_div_q = x / q;
-  x_mod_q = x % q;
+  x_div_q = *x / q;
+  x_mod_q = *x % q;
   x_new = (a * x_mod_q) - (r * x_div_q);
   if (x_new > 0)
-    x = x_new;
+    *x = x_new;
   else
-    x = x_new + m;
+    *x = x_new + m;
 
   // Return a random value between 0.0 and 1.0
-  return((double) x / m);
+  return((double) *x / m);
 }
 
 /*
@@ -26,6 +26,24 @@
 * along with TARVOS Computer Networks Simulator.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+/* Alteraes:
+*
+*	replicaes independentes em paralelo, com parada pelo intervalo de confiana (replMetric, replRun, replReport)
+*	17.Out.2026
+*
+*	mdias de lotes numa simulao longa, com verificao da autocorrelao e fim automtico (bmStream, bmAutoStop)
+*	17.Out.2026
+*
+*	deteco do fim do transitrio (warm-up) pelo MSER-5 nas sries de mdias de lotes (bmWarmup, bmReset)
+*	17.Out.2026
+*
+*	pares de replicaes antitticas em replRun (replAntithetic)
+*	17.Out.2026
+*
+*	histogramas log-lineares, com quantis calculados no relatrio (histCreate, histRecord, histQuantile, histReport)
+*	17.Out.2026
+*/
+
 #include "simm_globals.h"
 
 /*--------  COMPUTE pth QUANTILE OF THE NORMAL DISTRIBUTION  ---------*/
@@ -62,3 +80,890 @@ double T(double p, double ndf)
   z1+=x; if (p>0.5) z1=-z1;
   return(z1);
 }
+
+/*-----------  REPLICAES INDEPENDENTES EM PARALELO  -----------
+*
+*  Executa replicaes independentes de um modelo em vrias threads, cada replicao no seu prprio contexto de
+*  simulao (simmContextCreate) e com a sua prpria famlia de streams aleatrios (rngReplication), at que a
+*  semi-amplitude relativa do intervalo de confiana, calculado com T(), de todas as mtricas registradas fique abaixo
+*  do valor desejado, ou at o nmero mximo de replicaes.
+*
+*  Uso:
+*	replMetric("U lnk3", U, tarvosModel.lnk[3].facility);	//registra as mtricas (funo e argumento), antes de replRun
+*	replMetric("delay n6", getNodeMeanDelay, 6);
+*	replRun(model, 4, 5, 200, 0.05, 0.02);					//model(rep) executa uma replicao completa: simm(), modelo, lao de eventos
+*	replReport();
+*
+*  Com o xoshiro256++, os streams de replicaes diferentes no se sobrepem, e o modelo pode escolher streams com stream()
+*  normalmente; com o gerador clssico (RANF_CLASSIC), a replicao define apenas a semente do simm() da replicao, e o
+*  modelo no deve chamar stream().  As mtricas so
+*  avaliadas na thread da replicao, logo aps o retorno do modelo, ainda no contexto da replicao.  As replicaes
+*  so acumuladas na ordem do seu nmero, e o critrio de parada  testado a cada replicao acumulada; o resultado ,
+*  portanto, o mesmo para qualquer nmero de threads (replicaes que terminem depois da parada so descartadas).
+*  Os traces do TARVOS so mantidos por contexto:  cada replicao grava os seus prprios arquivos, com "_repN" antes da
+*  extenso (p.ex., traceall_rep3.txt), fechados quando o contexto da replicao  destrudo.  tarvosParam continua nico
+*  para o processo e  compartilhado pelas replicaes:  no alter-lo durante replRun.
+*
+*  Com replAntithetic(1), as replicaes 2k-1 e 2k usam a mesma famlia de streams, a segunda com os valores espelhados
+*  (rngAntithetic), e a unidade acumulada  a mdia do par; maxReps e minReps continuam contando replicaes.
+*
+*  Para comparar duas configuraes com nmeros aleatrios comuns, model(rep) pode executar as duas, chamando
+*  rngReplication(rep) antes de cada uma, e uma mtrica pode retornar a diferena; os streams nomeados (rngNamedStream)
+*  das fontes e dos pontos de deciso do modelo recebem ento as mesmas seqncias nas duas configuraes.
+*/
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+#define REPL_MUTEX				CRITICAL_SECTION
+#define replMutexInit(m)		InitializeCriticalSection(m)
+#define replMutexLock(m)		EnterCriticalSection(m)
+#define replMutexUnlock(m)		LeaveCriticalSection(m)
+#define replMutexDestroy(m)		DeleteCriticalSection(m)
+#else
+#include <pthread.h>
+#define REPL_MUTEX				pthread_mutex_t
+#define replMutexInit(m)		pthread_mutex_init(m, NULL)
+#define replMutexLock(m)		pthread_mutex_lock(m)
+#define replMutexUnlock(m)		pthread_mutex_unlock(m)
+#define replMutexDestroy(m)		pthread_mutex_destroy(m)
+#endif
+
+#define REPL_METRICS	32		/* nmero mximo de mtricas registradas */
+#define REPL_THREADS	64		/* nmero mximo de threads de replRun */
+
+struct replMetricDef {
+	char name[30];				/* nome da mtrica, para replReport */
+	double (*fn)(int arg);		/* funo que retorna o valor da mtrica na replicao corrente */
+	int arg;					/* argumento passado a fn (facility, nodo etc.) */
+	int n;						/* replicaes acumuladas */
+	double mean, m2;			/* mdia e soma dos quadrados dos desvios (Welford) */
+	double hw;					/* semi-amplitude do intervalo de confiana */
+};
+
+static struct replMetricDef replMetrics[REPL_METRICS];
+static int replNMetrics = 0;
+
+static struct {
+	void (*model)(int rep);		/* executa uma replicao */
+	int minReps, maxReps;		/* limites do nmero de replicaes */
+	double alpha;				/* 1-alpha  o nvel de confiana */
+	double relPrec;				/* semi-amplitude relativa desejada */
+	int next;					/* ltima replicao distribuda a uma thread */
+	int done;					/* replicaes acumuladas (1..done), na ordem */
+	int stop;					/* critrio de parada atingido */
+	double *val;				/* val[(rep-1)*replNMetrics+m]:  valor da mtrica m na replicao rep */
+	char *finished;				/* finished[rep-1]:  replicao terminada, ainda no acumulada */
+	int unit;					/* replicaes por unidade acumulada:  2 com pares antitticos, 1 sem */
+	REPL_MUTEX lock;
+} repl;
+static int replAnti = 0;			/* pares de replicaes antitticas (replAntithetic) */
+
+/* Registra uma mtrica de sada para replRun; retorna o seu ndice */
+int replMetric(char *name, double (*fn)(int arg), int arg)
+{
+	struct replMetricDef *m;
+
+	if (replNMetrics >= REPL_METRICS)
+	{
+		printf("\nError - replMetric - number of metrics exceeds REPL_METRICS");
+		exit(1);
+	}
+	m = &replMetrics[replNMetrics];
+	strncpy(m->name, name, sizeof m->name - 1);
+	m->name[sizeof m->name - 1] = '\0';
+	m->fn = fn;
+	m->arg = arg;
+	return (replNMetrics++);
+}
+
+/* Acumula a unidade que termina na replicao rep (j terminada) e testa o critrio de parada; chamada com repl.lock
+*  adquirido */
+static void replAccumulate(int rep)
+{
+	int i, ok = 1;
+	double x, d;
+	struct replMetricDef *m;
+
+	for (i = 0; i < replNMetrics; i++)
+	{
+		m = &replMetrics[i];
+		x = repl.val[(rep - 1) * replNMetrics + i];
+		if (repl.unit == 2)
+			x = (x + repl.val[(rep - 2) * replNMetrics + i]) / 2.0;
+		m->n++;
+		d = x - m->mean;
+		m->mean += d / m->n;
+		m->m2 += d * (x - m->mean);
+		m->hw = (m->n > 1 ? T(repl.alpha / 2, m->n - 1) * sqrt(m->m2 / (m->n - 1) / m->n) : 0.0);
+		if (m->n < 2 || m->hw > repl.relPrec * fabs(m->mean))
+			ok = 0;
+	}
+	repl.done = rep;
+	if (rep >= repl.minReps && ok)
+		repl.stop = 1;
+}
+
+/* Lao de cada thread:  obtm a prxima replicao, executa-a num contexto novo e acumula as replicaes prontas */
+static void replWorker()
+{
+	int rep, i;
+	double v[REPL_METRICS];
+	struct simmContext *ctx;
+
+	for (;;)
+	{
+		replMutexLock(&repl.lock);
+		if (repl.stop || repl.next >= repl.maxReps)
+		{
+			replMutexUnlock(&repl.lock);
+			return;
+		}
+		rep = ++repl.next;
+		replMutexUnlock(&repl.lock);
+
+		ctx = simmContextCreate();
+		ctx->sc_rep = rep;
+		simmSetContext(ctx);
+		if (repl.unit == 2)		/* par antittico:  mesma famlia de streams */
+		{
+			rngReplication((rep + 1) / 2);
+			rngAntithetic(rep % 2 == 0 ? RNG_ANTI_MIRROR : RNG_ANTI_FIRST);
+		}
+		else
+			rngReplication(rep);	/* streams aleatrios prprios da replicao */
+		repl.model(rep);
+		for (i = 0; i < replNMetrics; i++)
+			v[i] = replMetrics[i].fn(replMetrics[i].arg);
+		simmContextDestroy(ctx);
+
+		replMutexLock(&repl.lock);
+		memcpy(&repl.val[(rep - 1) * replNMetrics], v, replNMetrics * sizeof v[0]);
+		repl.finished[rep - 1] = 1;
+		while (!repl.stop && repl.done + repl.unit <= repl.maxReps && repl.finished[repl.done]
+				&& repl.finished[repl.done + repl.unit - 1])
+			replAccumulate(repl.done + repl.unit);
+		replMutexUnlock(&repl.lock);
+	}
+}
+
+#if defined(_WIN32)
+static unsigned __stdcall replThread(void *arg) { (void)arg; replWorker(); return 0; }
+#else
+static void *replThread(void *arg) { (void)arg; replWorker(); return NULL; }
+#endif
+
+/* Executa as replicaes; retorna o nmero de replicaes usadas nas estimativas */
+int replRun(void (*model)(int rep), int threads, int minReps, int maxReps, double alpha, double relPrec)
+{
+	int i;
+#if defined(_WIN32)
+	HANDLE th[REPL_THREADS];
+#else
+	pthread_t th[REPL_THREADS];
+#endif
+
+	if (threads < 1 || threads > REPL_THREADS || minReps < 2 || maxReps < minReps || alpha <= 0.0 || alpha >= 1.0)
+	{
+		printf("\nError - replRun - invalid arguments");
+		exit(1);
+	}
+	if (replNMetrics == 0)
+	{
+		printf("\nError - replRun - no metric registered (see replMetric)");
+		exit(1);
+	}
+	for (i = 0; i < replNMetrics; i++)
+		replMetrics[i].n = 0, replMetrics[i].mean = replMetrics[i].m2 = replMetrics[i].hw = 0.0;
+	repl.model = model;
+	repl.minReps = minReps;
+	repl.maxReps = maxReps;
+	repl.alpha = alpha;
+	repl.relPrec = relPrec;
+	repl.next = repl.done = repl.stop = 0;
+	repl.unit = (replAnti ? 2 : 1);
+	repl.val = (double*)malloc(maxReps * replNMetrics * sizeof *repl.val);
+	repl.finished = (char*)calloc(maxReps, sizeof *repl.finished);
+	if (repl.val == NULL || repl.finished == NULL)
+	{
+		printf("\nError - replRun - insufficient memory to allocate for replication results");
+		exit(1);
+	}
+	replMutexInit(&repl.lock);
+
+	for (i = 0; i < threads; i++)
+	{
+#if defined(_WIN32)
+		th[i] = (HANDLE)_beginthreadex(NULL, 0, replThread, NULL, 0, NULL);
+		if (th[i] == 0)
+#else
+		if (pthread_create(&th[i], NULL, replThread, NULL) != 0)
+#endif
+		{
+			printf("\nError - replRun - cannot create thread");
+			exit(1);
+		}
+	}
+	for (i = 0; i < threads; i++)
+	{
+#if defined(_WIN32)
+		WaitForSingleObject(th[i], INFINITE);
+		CloseHandle(th[i]);
+#else
+		pthread_join(th[i], NULL);
+#endif
+	}
+
+	replMutexDestroy(&repl.lock);
+	free(repl.val);
+	free(repl.finished);
+	return (repl.done);
+}
+
+/* Liga (on != 0) ou desliga os pares de replicaes antitticas nas prximas chamadas de replRun */
+void replAntithetic(int on)
+{
+	replAnti = (on != 0);
+}
+
+/* Nmero de replicaes usadas nas estimativas da ltima chamada de replRun */
+int replCount()
+{
+	return (repl.done);
+}
+
+/* Replicao executada no contexto corrente por replRun (1, 2, ...); 0 fora de replRun */
+int replCurrent()
+{
+	return (SIMM_CTX->sc_rep);
+}
+
+/* Mdia da mtrica m sobre as replicaes */
+double replMean(int m)
+{
+	return (replMetrics[m].mean);
+}
+
+/* Semi-amplitude do intervalo de confiana (1-alpha) da mtrica m */
+double replHalfWidth(int m)
+{
+	return (replMetrics[m].hw);
+}
+
+/* Relatrio das mtricas registradas, no destino de sada corrente */
+void replReport()
+{
+	int i;
+	FILE *opf = SIMM_CTX->sc_opf;
+
+	fprintf(opf, "\n INDEPENDENT REPLICATIONS:  %d replications%s, %s, %.0f%% confidence\n", repl.done,
+		repl.unit == 2 ? " (antithetic pairs)" : "", repl.stop ? "target precision reached" : "target precision NOT reached", 100.0 * (1.0 - repl.alpha));
+	fprintf(opf, " %-30s %14s %14s %10s\n", "METRIC", "MEAN", "HALF-WIDTH", "REL. HW");
+	for (i = 0; i < replNMetrics; i++)
+		fprintf(opf, " %-30s %14.6g %14.6g %9.2f%%\n", replMetrics[i].name, replMetrics[i].mean, replMetrics[i].hw,
+			replMetrics[i].mean != 0.0 ? 100.0 * replMetrics[i].hw / fabs(replMetrics[i].mean) : 0.0);
+}
+
+/*-----------  MDIAS DE LOTES (BATCH MEANS) NUMA NICA SIMULAO LONGA  -----------
+*
+*  Cada srie de observaes registrada com bmStream  agrupada em lotes de tamanho fixo; as mdias dos lotes completos
+*  so guardadas (no mximo BM_BATCHES) e, quando o vetor enche, os lotes adjacentes so agrupados dois a dois e o
+*  tamanho do lote dobra.  O intervalo de confiana da mdia usa T() sobre as mdias dos lotes, e a autocorrelao de
+*  lag 1 entre as mdias dos lotes  verificada:  enquanto ela for maior que BM_CORR_LIMIT, os lotes so considerados
+*  pequenos demais e a srie no  dada como pronta.
+*
+*  Com bmAutoStop(ev, alpha, relPrec), assim que todas as sries estiverem prontas e com semi-amplitude relativa menor
+*  que relPrec, o evento ev (tipicamente o fim da simulao)  escalonado para o instante corrente, com token -1.
+*
+*  Observaes com peso (bmObserveWeighted) servem para variveis contnuas no tempo, como o tamanho de fila:  o peso
+*   a durao do valor observado.  Os lotes so fechados pelo nmero de observaes, e no por intervalos fixos de
+*  tempo, para que o mesmo cdigo sirva s duas espcies de srie; numa srie com pesos os lotes tm duraes
+*  desiguais, e por isso a mdia geral, a varincia e a autocorrelao das mdias dos lotes so ponderadas pela soma dos
+*  pesos de cada lote (com pesos iguais, reduzem-se s estimativas usuais).  O estado fica no contexto de simulao
+*  corrente (sc_stat).
+*
+*  Com bmWarmup(ev), cada srie tambm alimenta um detector de fim do transitrio (MSER-5):  as observaes so
+*  agrupadas em lotes de 5 e, a cada lote, procura-se o ponto de truncamento d que minimiza
+*	MSER(d) = soma((Y[i] - mdia(Y[d..k-1]))^2, i = d..k-1) / (k-d)^2
+*  entre os k lotes j vistos, com d na primeira metade.  O teste  feito quando h MSER_MIN_BATCHES lotes e, depois, a cada
+*  vez que o nmero de observaes dobra.  Se o mnimo no est na fronteira (d < k/2) e o ponto de truncamento  anterior
+*  ao teste precedente, que tambm encontrou um mnimo fora da fronteira, o transitrio da srie terminou no lote d (a
+*  confirmao evita aceitar um patamar passageiro de uma tendncia ainda em curso).  Quando todas as sries chegam a este ponto, o evento
+*  ev (token -1)  escalonado para o instante corrente; o modelo deve ento chamar statReset() (ou reset(), se no usar o
+*  TARVOS), que zera as estatsticas do kernel, das sries de mdias de lotes e, no TARVOS, dos nodos.  Como a deciso
+*  s  tomada depois do ponto de truncamento, a parte descartada  um pouco maior que a estimada pelo MSER.  Se o
+*  vetor de lotes enche (MSER_BATCHES), os lotes so agrupados dois a dois (MSER-10, MSER-20...).
+*/
+#define BM_STREAMS		32		/* nmero mximo de sries de observaes */
+#define BM_BATCHES		64		/* nmero mximo de mdias de lotes guardadas (par) */
+#define BM_MIN_BATCHES	20		/* nmero mnimo de lotes para que a srie seja considerada pronta */
+#define BM_CORR_LIMIT	0.2		/* autocorrelao de lag 1 mxima entre as mdias dos lotes */
+#define MSER_SIZE			5		/* tamanho inicial dos lotes do MSER */
+#define MSER_BATCHES		256		/* nmero mximo de lotes guardados pelo MSER (par) */
+#define MSER_MIN_BATCHES	50		/* nmero mnimo de lotes para aceitar o ponto de truncamento */
+
+struct bmSeries {
+	char name[30];				/* nome da srie, para bmReport */
+	int size;					/* observaes por lote */
+	int k;						/* lotes completos */
+	int n;						/* observaes no lote corrente */
+	double sum, wsum;			/* soma ponderada e soma dos pesos do lote corrente */
+	double mean[BM_BATCHES];	/* mdias dos lotes completos */
+	double weight[BM_BATCHES];	/* soma dos pesos de cada lote completo (para agrupar lotes) */
+	long obs;					/* total de observaes */
+	double gmean, hw, r1;		/* mdia dos lotes completos, semi-amplitude do IC, autocorrelao de lag 1 */
+	int ready;					/* srie pronta:  lotes suficientes e pouco correlacionados */
+	int size0;					/* tamanho inicial do lote (restaurado por bmReset) */
+	int mk, mn, msize;			/* MSER:  lotes completos, observaes no lote corrente, observaes por lote */
+	double msum, mwsum;			/* MSER:  soma ponderada e soma dos pesos do lote corrente */
+	double mmean[MSER_BATCHES];	/* MSER:  mdias dos lotes completos */
+	double mweight[MSER_BATCHES];	/* MSER:  soma dos pesos de cada lote */
+	double mend[MSER_BATCHES];	/* MSER:  instante de trmino de cada lote */
+	long mobs, mnext;			/* MSER:  observaes vistas e nmero de observaes do prximo teste */
+	double mcand;				/* MSER:  instante do ltimo teste com mnimo fora da fronteira; negativo se nenhum */
+	int warm;					/* fim do transitrio detectado */
+	double warmTime;			/* instante estimado do fim do transitrio */
+};
+
+struct bmState {
+	int n;						/* sries registradas (1..n) */
+	struct bmSeries s[BM_STREAMS + 1];
+	double alpha;				/* 1-alpha  o nvel de confiana */
+	double relPrec;				/* semi-amplitude relativa desejada (bmAutoStop) */
+	int ev;						/* evento escalonado ao atingir a preciso; 0 se bmAutoStop no foi chamada */
+	int fired;					/* evento ev j escalonado */
+	int wev;					/* evento escalonado no fim do transitrio; 0 se bmWarmup no foi chamada */
+	int wfired;					/* evento wev j escalonado */
+};
+
+/* Estado das mdias de lotes do contexto corrente, criado no primeiro uso */
+static struct bmState *bmContext()
+{
+	struct simmContext *ctx = SIMM_CTX;
+	struct bmState *bm;
+
+	if (ctx->sc_stat == NULL)
+	{
+		bm = (struct bmState*)calloc(1, sizeof *bm);
+		if (bm == NULL)
+		{
+			printf("\nError - bmContext - insufficient memory to allocate for batch means");
+			exit(1);
+		}
+		bm->alpha = 0.05;
+		ctx->sc_stat = bm;
+	}
+	return ((struct bmState*)ctx->sc_stat);
+}
+
+/* Registra uma srie de observaes, com o tamanho inicial do lote; retorna o nmero da srie (1, 2, ...) */
+int bmStream(char *name, int size)
+{
+	struct bmState *bm = bmContext();
+	struct bmSeries *s;
+
+	if (bm->n >= BM_STREAMS)
+	{
+		printf("\nError - bmStream - number of series exceeds BM_STREAMS");
+		exit(1);
+	}
+	s = &bm->s[++bm->n];
+	memset(s, 0, sizeof *s);
+	strncpy(s->name, name, sizeof s->name - 1);
+	s->size = s->size0 = (size > 0 ? size : 1);
+	s->msize = MSER_SIZE;
+	s->mcand = -1.0;
+	return (bm->n);
+}
+
+/* Recalcula mdia, semi-amplitude e autocorrelao da srie a partir das mdias dos lotes */
+static void bmEstimate(struct bmState *bm, struct bmSeries *s)
+{
+	int i;
+	double var = 0.0, cov = 0.0, wsum = 0.0, d;
+
+	if (s->k < 2)
+		return;
+	s->gmean = 0.0;
+	for (i = 0; i < s->k; i++)	/* mdia ponderada pelos pesos dos lotes (igual  mdia simples se os pesos forem 1) */
+	{
+		s->gmean += s->weight[i] * s->mean[i];
+		wsum += s->weight[i];
+	}
+	s->gmean /= wsum;
+	for (i = 0; i < s->k; i++)	/* desvios em relao  mdia ponderada, ponderados pelos pesos dos lotes */
+	{
+		d = s->mean[i] - s->gmean;
+		var += s->weight[i] * d * d;
+		if (i > 0)
+			cov += 0.5 * (s->weight[i] + s->weight[i-1]) * d * (s->mean[i-1] - s->gmean);
+	}
+	var /= wsum;
+	cov /= wsum;
+	s->r1 = (var > 0.0 ? cov / var : 0.0);
+	s->hw = T(bm->alpha / 2, s->k - 1) * sqrt(var / (s->k - 1));
+	s->ready = (s->k >= BM_MIN_BATCHES && s->r1 <= BM_CORR_LIMIT);
+}
+
+/* Testa o critrio de parada de bmAutoStop e escalona o evento de fim quando atingido */
+static void bmCheckStop(struct bmState *bm)
+{
+	int i;
+	struct bmSeries *s;
+
+	for (i = 1; i <= bm->n; i++)
+	{
+		s = &bm->s[i];
+		if (!s->ready || s->hw > bm->relPrec * fabs(s->gmean))
+			return;
+	}
+	bm->fired = 1;
+	schedulep(bm->ev, 0.0, -1, NULL);
+}
+
+/* Procura o ponto de truncamento do MSER entre os lotes da srie; marca a srie se o transitrio terminou */
+static void bmMser(struct bmSeries *s)
+{
+	int d, best = 0;
+	double s1 = 0.0, s2 = 0.0, m, v, min = -1.0, t;
+
+	if (s->mk < MSER_MIN_BATCHES || s->mobs < s->mnext)
+		return;
+	s->mnext = 2 * s->mobs;
+	for (d = s->mk - 1; d >= 0; d--)	/* somas dos lotes d..k-1, de trs para a frente */
+	{
+		s1 += s->mmean[d];
+		s2 += s->mmean[d] * s->mmean[d];
+		if (2 * d > s->mk)
+			continue;
+		m = s1 / (s->mk - d);
+		v = (s2 - s1 * m) / ((double)(s->mk - d) * (s->mk - d));
+		if (min < 0.0 || v <= min)		/* <=:  em caso de empate, o menor d */
+			min = v, best = d;
+	}
+	if (2 * best >= s->mk - 1)			/* mnimo na fronteira d = k/2:  transitrio ainda em curso */
+	{
+		s->mcand = -1.0;
+		return;
+	}
+	t = (best > 0 ? s->mend[best - 1] : 0.0);
+	if (s->mcand >= 0.0 && t <= s->mcand)	/* confirmado pelo teste anterior */
+	{
+		s->warm = 1;
+		s->warmTime = t;
+	}
+	else
+		s->mcand = simtime();
+}
+
+/* Acumula a observao no detector de transitrio da srie e testa o evento de bmWarmup */
+static void bmWarmupObserve(struct bmState *bm, struct bmSeries *p, double x, double w)
+{
+	int i;
+
+	p->mobs++;
+	p->msum += w * x;
+	p->mwsum += w;
+	if (++p->mn < p->msize)
+		return;
+	p->mmean[p->mk] = p->msum / p->mwsum;
+	p->mweight[p->mk] = p->mwsum;
+	p->mend[p->mk] = simtime();
+	p->mk++;
+	p->mn = 0;
+	p->msum = p->mwsum = 0.0;
+	if (p->mk == MSER_BATCHES)
+	{
+		for (i = 0; i < MSER_BATCHES / 2; i++)
+		{
+			p->mmean[i] = (p->mweight[2*i] * p->mmean[2*i] + p->mweight[2*i+1] * p->mmean[2*i+1]) / (p->mweight[2*i] + p->mweight[2*i+1]);
+			p->mweight[i] = p->mweight[2*i] + p->mweight[2*i+1];
+			p->mend[i] = p->mend[2*i+1];
+		}
+		p->mk = MSER_BATCHES / 2;
+		p->msize *= 2;
+	}
+	bmMser(p);
+	if (!p->warm)
+		return;
+	for (i = 1; i <= bm->n; i++)
+		if (!bm->s[i].warm)
+			return;
+	bm->wfired = 1;
+	schedulep(bm->wev, 0.0, -1, NULL);
+}
+
+/* Registra a observao x, com peso w, na srie s */
+void bmObserveWeighted(int s, double x, double w)
+{
+	struct bmState *bm = bmContext();
+	struct bmSeries *p;
+	int i;
+
+	if (s < 1 || s > bm->n)
+	{
+		printf("\nError - bmObserve - series number does not exist");
+		exit(1);
+	}
+	if (w <= 0.0)
+		return;
+	p = &bm->s[s];
+	if (bm->wev != 0 && !bm->wfired && !p->warm)
+		bmWarmupObserve(bm, p, x, w);
+	p->obs++;
+	p->sum += w * x;
+	p->wsum += w;
+	if (++p->n < p->size)
+		return;
+
+	p->mean[p->k] = p->sum / p->wsum;	/* lote completo */
+	p->weight[p->k] = p->wsum;
+	p->k++;
+	p->n = 0;
+	p->sum = p->wsum = 0.0;
+	if (p->k == BM_BATCHES)				/* agrupa os lotes dois a dois e dobra o tamanho do lote */
+	{
+		for (i = 0; i < BM_BATCHES / 2; i++)
+		{
+			p->mean[i] = (p->weight[2*i] * p->mean[2*i] + p->weight[2*i+1] * p->mean[2*i+1]) / (p->weight[2*i] + p->weight[2*i+1]);
+			p->weight[i] = p->weight[2*i] + p->weight[2*i+1];
+		}
+		p->k = BM_BATCHES / 2;
+		p->size *= 2;
+	}
+	bmEstimate(bm, p);
+	if (bm->ev != 0 && !bm->fired)
+		bmCheckStop(bm);
+}
+
+/* Registra a observao x na srie s */
+void bmObserve(int s, double x)
+{
+	bmObserveWeighted(s, x, 1.0);
+}
+
+/* Escalona o evento ev (token -1) quando todas as sries atingirem a semi-amplitude relativa relPrec, com confiana 1-alpha */
+void bmAutoStop(int ev, double alpha, double relPrec)
+{
+	struct bmState *bm = bmContext();
+
+	if (ev == 0 || alpha <= 0.0 || alpha >= 1.0 || relPrec <= 0.0)
+	{
+		printf("\nError - bmAutoStop - invalid arguments");
+		exit(1);
+	}
+	bm->ev = ev;
+	bm->alpha = alpha;
+	bm->relPrec = relPrec;
+	bm->fired = 0;
+}
+
+/* Ativa a deteco do fim do transitrio (MSER-5) em todas as sries; o evento ev (token -1)  escalonado quando todas
+*  as sries tiverem passado do transitrio */
+void bmWarmup(int ev)
+{
+	struct bmState *bm = bmContext();
+	int i;
+
+	if (ev == 0)
+	{
+		printf("\nError - bmWarmup - invalid event");
+		exit(1);
+	}
+	bm->wev = ev;
+	bm->wfired = 0;
+	for (i = 1; i <= bm->n; i++)
+	{
+		bm->s[i].mk = bm->s[i].mn = bm->s[i].warm = 0;
+		bm->s[i].msize = MSER_SIZE;
+		bm->s[i].msum = bm->s[i].mwsum = bm->s[i].warmTime = 0.0;
+		bm->s[i].mobs = bm->s[i].mnext = 0;
+		bm->s[i].mcand = -1.0;
+	}
+}
+
+/* Instante estimado do fim do transitrio da srie s; negativo se ainda no detectado */
+double bmWarmupTime(int s)
+{
+	struct bmSeries *p = &bmContext()->s[s];
+
+	return (p->warm ? p->warmTime : -1.0);
+}
+
+/* Descarta as observaes de todas as sries (chamada por reset()); o registro das sries e o detector de transitrio
+*  so mantidos */
+void bmReset()
+{
+	struct bmState *bm = (struct bmState*)SIMM_CTX->sc_stat;
+	struct bmSeries *p;
+	int i;
+
+	if (bm == NULL)
+		return;
+	for (i = 1; i <= bm->n; i++)
+	{
+		p = &bm->s[i];
+		p->size = p->size0;
+		p->k = p->n = p->ready = 0;
+		p->obs = 0;
+		p->sum = p->wsum = p->gmean = p->hw = p->r1 = 0.0;
+	}
+	bm->fired = 0;
+}
+
+/* Mdia da srie s (sobre os lotes completos) */
+double bmMean(int s)
+{
+	return (bmContext()->s[s].gmean);
+}
+
+/* Semi-amplitude do intervalo de confiana da mdia da srie s */
+double bmHalfWidth(int s)
+{
+	return (bmContext()->s[s].hw);
+}
+
+/* Relatrio das sries de mdias de lotes, no destino de sada corrente */
+void bmReport()
+{
+	int i;
+	struct bmState *bm = bmContext();
+	struct bmSeries *s;
+	FILE *opf = SIMM_CTX->sc_opf;
+
+	fprintf(opf, "\n BATCH MEANS:  %.0f%% confidence\n", 100.0 * (1.0 - bm->alpha));
+	fprintf(opf, " %-30s %10s %8s %8s %14s %14s %7s %12s %s\n", "SERIES", "OBS", "BATCHES", "SIZE", "MEAN", "HALF-WIDTH", "LAG1",
+		"WARM-UP", "");
+	for (i = 1; i <= bm->n; i++)
+	{
+		s = &bm->s[i];
+		fprintf(opf, " %-30s %10ld %8d %8d %14.6g %14.6g %7.3f ", s->name, s->obs, s->k, s->size, s->gmean, s->hw, s->r1);
+		if (s->warm)
+			fprintf(opf, "%12.4f", s->warmTime);
+		else
+			fprintf(opf, "%12s", "-");
+		fprintf(opf, " %s\n", s->ready ? "" : "(not ready)");
+	}
+}
+
+/*-----------  HISTOGRAMAS LOG-LINEARES (QUANTIS)  -----------
+*
+*  Histogramas no estilo do HDR Histogram, para estimar quantis (p50, p99, p99.9...) sem guardar as observaes.  Cada
+*  potncia de 2 entre HIST_MIN e HIST_MAX  dividida em HIST_SUB faixas iguais; o ndice da faixa de um valor sai direto
+*  do expoente e dos HIST_SUB_BITS bits mais significativos da mantissa (frexp), logo histRecord  O(1).  O erro relativo
+*  de um quantil  no mximo 1/HIST_SUB:  histQuantile retorna o limite superior da faixa (nunca acima do mximo
+*  observado).  Valores menores que HIST_MIN (inclusive zero) contam na faixa 0 e so relatados como 0; valores a partir de
+*  HIST_MAX contam na ltima faixa e so relatados pelo mximo observado.  As observaes devem ser no negativas.
+*
+*  report() chama histReport(), que lista os histogramas do contexto corrente (nenhuma linha se no houver histogramas), e
+*  reset() zera todos eles (histReset).  O estado fica no contexto de simulao corrente (sc_hist).
+*/
+#define HIST_SUB_BITS	6										/* faixas por potncia de 2:  2^HIST_SUB_BITS */
+#define HIST_SUB		(1 << HIST_SUB_BITS)
+#define HIST_EXP_MIN	(-30)									/* HIST_MIN = 2^HIST_EXP_MIN (cerca de 1 ns, em segundos) */
+#define HIST_EXP_MAX	20										/* HIST_MAX = 2^HIST_EXP_MAX (cerca de 12 dias) */
+#define HIST_BUCKETS	((HIST_EXP_MAX - HIST_EXP_MIN) * HIST_SUB + 2)	/* mais a faixa 0 e a ltima faixa */
+#define HIST_MIN_VALUE	(1.0 / 1073741824.0)					/* 2^HIST_EXP_MIN */
+
+struct histogram {
+	char name[30];				/* nome do histograma, para histReport */
+	unsigned long long n;		/* nmero de observaes */
+	double max;					/* maior valor observado */
+	double sum;					/* soma das observaes (mdia no relatrio) */
+	unsigned long long *count;	/* count[i]:  observaes na faixa i */
+};
+
+struct histState {
+	int n;						/* histogramas registrados (1..n) */
+	int size;					/* posies alocadas em h */
+	struct histogram *h;		/* h[0] no  usado */
+};
+
+/* Estado dos histogramas do contexto corrente, criado no primeiro uso */
+static struct histState *histContext()
+{
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (ctx->sc_hist == NULL)
+	{
+		ctx->sc_hist = calloc(1, sizeof(struct histState));
+		if (ctx->sc_hist == NULL)
+		{
+			printf("\nError - histContext - insufficient memory to allocate for histograms");
+			exit(1);
+		}
+	}
+	return ((struct histState*)ctx->sc_hist);
+}
+
+/* Registra um histograma; retorna o seu nmero (1, 2, ...) */
+int histCreate(char *name)
+{
+	struct histState *hs = histContext();
+	struct histogram *h;
+
+	if (hs->n + 1 >= hs->size)
+	{
+		hs->size = (hs->size == 0 ? 16 : 2 * hs->size);
+		hs->h = (struct histogram*)realloc(hs->h, hs->size * sizeof *hs->h);
+		if (hs->h == NULL)
+		{
+			printf("\nError - histCreate - insufficient memory to allocate for histograms");
+			exit(1);
+		}
+	}
+	h = &hs->h[++hs->n];
+	memset(h, 0, sizeof *h);
+	strncpy(h->name, name, sizeof h->name - 1);
+	h->count = (unsigned long long*)calloc(HIST_BUCKETS, sizeof *h->count);
+	if (h->count == NULL)
+	{
+		printf("\nError - histCreate - insufficient memory to allocate for histogram buckets");
+		exit(1);
+	}
+	return (hs->n);
+}
+
+/* Histograma h do contexto corrente; termina a simulao se h no existe (func  o nome da funo chamante, para a mensagem) */
+static struct histogram *histGet(int h, const char *func)
+{
+	struct histState *hs = histContext();
+
+	if (h < 1 || h > hs->n)
+	{
+		printf("\nError - %s - histogram number does not exist", func);
+		exit(1);
+	}
+	return (&hs->h[h]);
+}
+
+/* Registra a observao x (x >= 0) no histograma h */
+void histRecord(int h, double x)
+{
+	struct histogram *p = histGet(h, "histRecord");
+	double m;
+	int e, i;
+
+	if (!(x >= 0.0))		/* tambm rejeita NaN */
+	{
+		printf("\nError - histRecord - observation must be non-negative");
+		exit(1);
+	}
+	p->n++;
+	p->sum += x;
+	if (x > p->max)
+		p->max = x;
+	if (x < HIST_MIN_VALUE)
+		i = 0;
+	else
+	{
+		m = frexp(x, &e);							/* x = m * 2^e, 0.5 <= m < 1 */
+		if (e - 1 >= HIST_EXP_MAX)
+			i = HIST_BUCKETS - 1;
+		else
+			i = 1 + (e - 1 - HIST_EXP_MIN) * HIST_SUB + (int)((m - 0.5) * (2 * HIST_SUB));
+	}
+	p->count[i]++;
+}
+
+/* Limite superior da faixa i (i entre 1 e HIST_BUCKETS - 2) */
+static double histUpper(int i)
+{
+	i--;
+	return (ldexp(1.0 + (double)(i % HIST_SUB + 1) / HIST_SUB, i / HIST_SUB + HIST_EXP_MIN));
+}
+
+/* Quantil q (0 < q <= 1) do histograma h; 0 se no h observaes */
+double histQuantile(int h, double q)
+{
+	struct histogram *p = histGet(h, "histQuantile");
+	unsigned long long target, acc = 0;
+	double v;
+	int i;
+
+	if (!(q > 0.0 && q <= 1.0))
+	{
+		printf("\nError - histQuantile - quantile must be in (0, 1]");
+		exit(1);
+	}
+	if (p->n == 0)
+		return (0.0);
+	target = (unsigned long long)ceil(q * (double)p->n);
+	if (target < 1)
+		target = 1;
+	for (i = 0; i < HIST_BUCKETS; i++)
+	{
+		acc += p->count[i];
+		if (acc >= target)
+			break;
+	}
+	if (i == 0)
+		return (0.0);
+	if (i >= HIST_BUCKETS - 1)
+		return (p->max);
+	v = histUpper(i);
+	return (v < p->max ? v : p->max);
+}
+
+/* Maior valor observado no histograma h */
+double histMax(int h)
+{
+	return (histGet(h, "histMax")->max);
+}
+
+/* Nmero de observaes do histograma h */
+double histCount(int h)
+{
+	return ((double)histGet(h, "histCount")->n);
+}
+
+/* Zera todos os histogramas do contexto corrente (chamada por reset()) */
+void histReset()
+{
+	struct histState *hs = (struct histState*)SIMM_CTX->sc_hist;
+	int i;
+
+	if (hs == NULL)
+		return;
+	for (i = 1; i <= hs->n; i++)
+	{
+		hs->h[i].n = 0;
+		hs->h[i].max = hs->h[i].sum = 0.0;
+		memset(hs->h[i].count, 0, HIST_BUCKETS * sizeof *hs->h[i].count);
+	}
+}
+
+/* Libera os histogramas do contexto ctx (chamada por simmContextDestroy) */
+void histContextFree(struct simmContext *ctx)
+{
+	struct histState *hs = (struct histState*)ctx->sc_hist;
+	int i;
+
+	if (hs == NULL)
+		return;
+	for (i = 1; i <= hs->n; i++)
+		free(hs->h[i].count);
+	free(hs->h);
+	free(hs);
+	ctx->sc_hist = NULL;
+}
+
+/* Relatrio dos histogramas (mdia, quantis e mximo), no destino de sada corrente; nada se no houver histogramas */
+void histReport()
+{
+	struct histState *hs = (struct histState*)SIMM_CTX->sc_hist;
+	struct histogram *p;
+	FILE *opf = SIMM_CTX->sc_opf;
+	int i;
+
+	if (hs == NULL || hs->n == 0)
+		return;
+	fprintf(opf, "\n HISTOGRAMS:  quantiles within %.1f%%\n", 100.0 / HIST_SUB);
+	fprintf(opf, " %-30s %10s %12s %12s %12s %12s %12s %12s\n", "HISTOGRAM", "OBS", "MEAN", "P50", "P90", "P99", "P99.9", "MAX");
+	for (i = 1; i <= hs->n; i++)
+	{
+		p = &hs->h[i];
+		fprintf(opf, " %-30s %10.0f %12.6g %12.6g %12.6g %12.6g %12.6g %12.6g\n", p->name, (double)p->n,
+			p->n > 0 ? p->sum / p->n : 0.0, histQuantile(i, 0.5), histQuantile(i, 0.9), histQuantile(i, 0.99),
+			histQuantile(i, 0.999), p->max);
+	}
+}
@@ -70,6 +70,93 @@ typedef struct Packet TOKEN;
 
 #endif
 
+/* Pool de ns de tamanho fixo, usado pelo kernel para os elementos da cadeia de eventos (evchain), das filas (fqueue) e
+*  dos servidores (fserv).  A memria  obtida em blocos de SP_CHUNK ns; ns liberados vo para uma lista de ns livres e
+*  so reaproveitados antes de um novo bloco ser alocado.  Os blocos s so devolvidos ao sistema ao fim do programa ou
+*  quando o contexto de simulao  destrudo (simmContextDestroy).
+*/
+#define SP_CHUNK	1024		/* ns por bloco */
+
+#define POOL_EVCHAIN	0		/* identificadores dos pools do kernel (ver getPoolChunks e demais funes) */
+#define POOL_FQUEUE		1
+#define POOL_FSERV		2
+#define POOLS			3
+
+#define RNG_BUF	64				/* tamanho do buffer de valores uniformes de cada stream */
+#define RNG_NAMED	1000000000	/* os streams nomeados (rngNamedStream) so numerados a partir de RNG_NAMED + 1 */
+#define RNG_STREAMS	1024		/* maior stream numerado escolhido por stream(n); valores maiores so tratados como semente */
+
+#define RNG_ANTI_OFF	0		/* modos de rngAntithetic:  valores normais */
+#define RNG_ANTI_FIRST	1		/* primeiro membro de um par antittico:  valores normais, geradores montonos */
+#define RNG_ANTI_MIRROR	2		/* segundo membro:  valores espelhados (u -> 1 - u), geradores montonos */
+
+/* Estado de um stream de nmeros aleatrios (gerador xoshiro256++, ver simm_rand.c) */
+struct rngStream {
+	unsigned long long rs_s[4];	/* estado do gerador */
+	double rs_z2;				/* segundo valor gerado por normal(), usado na chamada seguinte com o mesmo stream */
+	double rs_u[RNG_BUF];		/* prximos valores uniformes do stream, gerados em bloco */
+	unsigned long long rs_r[RNG_BUF];	/* valores de 64 bits que deram origem a rs_u (usados pelo ziggurat) */
+	int rs_pos;					/* prximo valor a usar em rs_u/rs_r; RNG_BUF se o buffer est vazio */
+	int rs_anti;				/* 1 se o stream gera os valores antitticos (u -> 1 - u), ver rngAntithetic */
+};
+
+/* Stream nomeado (rngNamedStream):  o estado inicial depende apenas do nome, da semente e da replicao */
+struct rngNamed {
+	char rn_name[32];			/* nome do stream */
+	unsigned long long rn_key;	/* hash do nome e do stream corrente quando o stream foi criado */
+	struct rngStream rn_st;		/* estado do stream */
+};
+
+struct simmPool {
+	char sp_name[20];			/* nome do pool, para mensagens de erro e relatrios */
+	int sp_size;					/* tamanho de cada n, arredondado para o alinhamento de double */
+	void *sp_free;				/* lista de ns livres; o incio de cada n livre aponta para o prximo */
+	char *sp_next;				/* prximo n ainda no usado do bloco corrente */
+	char *sp_end;				/* final do bloco corrente */
+	void *sp_chunk_list;		/* blocos alocados, encadeados pelo incio de cada bloco (ver simmContextDestroy) */
+	int sp_chunks;				/* nmero de blocos alocados */
+	int sp_live;				/* ns em uso */
+	int sp_peak;				/* maior nmero de ns em uso simultaneamente */
+	long long sp_allocs;		/* total de alocaes */
+	long long sp_reuses;		/* alocaes atendidas por n reaproveitado da lista de livres */
+};
+
+/* Calendar queue (Brown, 1988) usado pelo modo EVC_CALENDAR do conjunto de eventos futuros.
+*  Cada bucket  uma lista duplamente encadeada ordenada por (ev_time, ev_seq); o evento de tempo t fica no bucket
+*  virtual floor(t/cq_width), guardado no bucket (floor(t/cq_width) % cq_nb) do vetor.  O nmero de buckets dobra ou cai pela
+*  metade conforme a populao de eventos, com a largura recalculada a partir dos intervalos observados entre eventos; entre
+*  redimensionamentos, a largura  dobrada ou reduzida  metade quando o custo mdio das operaes fica alto.
+*/
+#define CQ_MIN_BUCKETS	16		/* nmero mnimo (e inicial) de buckets */
+#define CQ_GAPS			32		/* nmero de intervalos entre eventos guardados para o clculo da largura dos buckets */
+
+struct calqueue {
+	struct evchain **cq_bucket;		/* vetor de buckets (primeiro elemento de cada bucket) */
+	struct evchain **cq_tail;		/* ltimo elemento de cada bucket */
+	int cq_nb;						/* nmero de buckets */
+	int cq_n;						/* nmero de eventos no calendar queue */
+	double cq_width;				/* largura (em tempo simulado) de cada bucket */
+	long long cq_vb;				/* bucket virtual corrente; nenhum evento est num bucket virtual anterior */
+	struct evchain *cq_min;			/* menor evento, se j localizado (NULL caso contrrio) */
+	double cq_last;					/* tempo do ltimo menor evento localizado */
+	double cq_gap[CQ_GAPS];			/* ltimos intervalos observados entre menores eventos sucessivos (vetor circular) */
+	int cq_ngaps;					/* nmero de intervalos observados (limitado a 2*CQ_GAPS) */
+	int cq_win_ops;					/* operaes na janela corrente de avaliao da largura */
+	long long cq_win_scan;			/* buckets percorridos na janela corrente */
+	long long cq_win_walk;			/* elementos percorridos nas inseres da janela corrente */
+	int cq_win_mult;				/* tamanho da janela de avaliao, em mltiplos do nmero de buckets */
+	int cq_last_dir;				/* ltimo ajuste de largura:  1 (dobrou), -1 (reduziu) ou 0 (nenhum) */
+	/* estatsticas, apresentadas por reportEvChain() */
+	int cq_resizes;					/* mudanas no nmero de buckets */
+	int cq_recalibrations;			/* ajustes da largura sem mudana no nmero de buckets */
+	int cq_peak_n;					/* maior nmero de eventos no calendar queue */
+	long long cq_mins;				/* localizaes do menor evento */
+	long long cq_scans;				/* buckets percorridos na localizao do menor evento */
+	long long cq_direct;			/* localizaes que precisaram de busca direta (um ano inteiro sem eventos) */
+	long long cq_inserts;			/* inseres */
+	long long cq_walk;				/* elementos percorridos nas inseres */
+};
+
 /* Armazena informacoes de simulacao do modelo atual
 *  Poderemos ter varias simulacoes para o mesmo modelo
 */
@@ -77,9 +164,51 @@ struct simul {
 	char name[50];						/* nome a ser usado para denominar o modelo simulado */
 	struct evchain *evc_begin;			/* Apontador para o inicio da cadeia de eventos (tokens) */
 	struct evchain *evc_end;			/* Apontador para o final da cadeia de eventos (tokens) */
+	struct evchain *evc_now_begin;		/* incio da fila de eventos imediatos (escalonados com te = 0), retirados antes da cadeia */
+	struct evchain *evc_now_end;		/* final da fila de eventos imediatos */
 	struct facilit *fct_begin;			/* Apontador para o inicio da lista de facilities */
 	int fct_number;						/* Especifica o ultimo numero de facility especificada */
+	struct facilit **fct_index;			/* vetor de facilities indexado pelo nmero da facility (a posio 0 no  usada) */
+	int fct_index_size;					/* nmero de posies alocadas para fct_index */
+	int evc_mode;						/* estrutura usada para o conjunto de eventos futuros:  EVC_LIST, EVC_HEAP4, EVC_PAIRING ou EVC_CALENDAR */
+	long long evc_seq;					/* contador de inseres na cadeia de eventos; desempata eventos de mesmo tempo (FIFO) */
+	struct evchain **evc_heap;			/* vetor do heap 4-rio (modo EVC_HEAP4); a raiz  o elemento 0 */
+	int evc_heap_n;						/* nmero de elementos no heap 4-rio */
+	int evc_heap_size;					/* nmero de posies alocadas para evc_heap */
+	struct evchain *evc_pheap;			/* raiz do pairing heap (modo EVC_PAIRING) */
+	struct calqueue evc_cal;			/* calendar queue (modo EVC_CALENDAR) */
+	struct evchain **evc_tkn_tab;		/* ndice de eventos pendentes por nmero de token (tabela hash), usado por cancelp_tkn */
+	int evc_tkn_size;					/* nmero de posies de evc_tkn_tab (potncia de 2) */
+	int evc_count;						/* nmero de eventos pendentes */
+	long long evc_ids;					/* ltimo identificador de evento atribudo (ev_id) */
+};
+
+/* Estruturas disponveis para o conjunto de eventos futuros (ver funo setEvChainMode).
+*  EVC_LIST  a lista duplamente encadeada ordenada original do simm.  Nos demais modos, a lista evc_begin..evc_end
+*  guarda apenas os eventos com o menor tempo pendente (o grupo de cabea); os demais ficam no heap ou no calendar queue.
+*/
+#define EVC_LIST		0		/* lista duplamente encadeada ordenada (padro) */
+#define EVC_HEAP4		1		/* heap implcito 4-rio */
+#define EVC_PAIRING		2		/* pairing heap */
+#define EVC_CALENDAR	3		/* calendar queue com redimensionamento automtico */
+
+/* Nmero de nveis de prioridade com fila prpria em cada facility (0 a FQ_LEVELS-1; ver fqInsert).  No pode passar
+*  de 64, o tamanho do mapa de bits f_q_bitmap.
+*/
+#define FQ_LEVELS		64
+
+/* Soma compensada (Kahan-Neumaier):  o valor da soma  ks_sum + ks_c.  Ver sumAdd e sumValue em simm_globals.h */
+struct simmSum {
+	double ks_sum;				/* soma */
+	double ks_c;				/* parcelas de baixa ordem perdidas em ks_sum */
+};
 
+/* Mdia e varincia correntes (Welford; com pesos, West).  Ver momAdd, momVar e momTimeVar em simm_globals.h */
+struct simmMoments {
+	long long w_n;				/* nmero de observaes */
+	double w_wsum;				/* soma dos pesos */
+	double w_mean;				/* mdia ponderada */
+	double w_m2;				/* soma ponderada dos quadrados dos desvios em relao  mdia */
 };
 
 /* estrutura da facility tipicamente associada a servidores */
@@ -90,18 +219,31 @@ struct facilit {
 	int f_n_busy_serv;			/* num de servidores ocupados */
 	int f_n_length_q;			/* tamanho fila; cada facility tem s uma fila associada nesta implementao*/
 	int f_max_queue;			/* tamanho mximo da fila */
-	int f_exit_count_q;			/* numero de dequeues durante o perodo simulado */
+	long long f_exit_count_q;	/* numero de dequeues durante o perodo simulado */
 	double f_last_ch_time_q;	/* momento da ultima mudanca na fila */
-	double f_busy_time;			/* tempo que a facility fica ocupada - somatorio de fs_busy_time de todos os seus servidores */
-	int f_preempt_count;		/* numero de preempes efetivamente realizadas */
-	double length_time_prod_sum;	/* utilizado para obter o tamanho medio da fila */
-	int f_release_count;		/* total de tokens que foram servidas pela facility. The preempt function *does not* increment this variable! Only the release function is incrementing this variable, in contrast to SMPL approach.*/
+	struct simmSum f_busy_time;	/* tempo que a facility fica ocupada - somatorio de fs_busy_time de todos os seus servidores */
+	long long f_preempt_count;	/* numero de preempes efetivamente realizadas */
+	struct simmSum length_time_prod_sum;	/* utilizado para obter o tamanho medio da fila */
+	struct simmMoments f_q_mom;	/* tamanho da fila ponderado pelo tempo em que permaneceu (varincia:  LqVar) */
+	struct simmMoments f_s_mom;	/* tempos de servio terminados por release (varincia:  BVar) */
+	long long f_release_count;	/* total de tokens que foram servidas pela facility. The preempt function *does not* increment this variable! Only the release function is incrementing this variable, in contrast to SMPL approach.*/
 	struct fserv *f_serv;		/* apontador para a lista de servidores */
-	struct fqueue *f_queue;		/* apontador para a fila de tokens de espera */
+	struct fserv **f_srv_vec;	/* vetor de servidores, indexado por fs_number */
+	int *f_idle;				/* heap (mnimo) dos nmeros dos servidores livres */
+	int f_n_idle;				/* nmero de servidores em f_idle */
+	int *f_busy;				/* heap (mnimo) dos servidores ocupados por (fs_p_tkn, fs_number):  vtima de preempo na raiz */
+	int f_n_busy_heap;			/* nmero de servidores em f_busy */
+	struct fserv **f_srv_tab;	/* tabela hash token -> servidor que a atende, encadeada por fs_tab_next */
+	int f_srv_tab_mask;			/* nmero de posies de f_srv_tab menos 1 (potncia de 2) */
+	struct fqueue *f_queue;		/* fila de tokens de espera com prioridade fora da faixa 0..FQ_LEVELS-1, ordenada por prioridade */
+	struct fqueue *f_q_head[FQ_LEVELS];	/* incio da fila FIFO de tokens de espera de cada nvel de prioridade */
+	struct fqueue *f_q_tail[FQ_LEVELS];	/* final da fila FIFO de cada nvel de prioridade */
+	unsigned long long f_q_bitmap;	/* bit p ligado se a fila do nvel de prioridade p no est vazia */
 	struct facilit *fct_next;	/* apontador para a proxima facility */
 	int f_up;					// status da facility:  1 para operacional (up), 0 para no-operacional (down) (25.Dec.2005 Marcos Portnoi)
-	int f_tkn_dropped;			/* nmero de tokens descartadas pela facility (ao entrar em estado down, a fila  descartada e este contador  atualizado.
+	long long f_tkn_dropped;	/* nmero de tokens descartadas pela facility (ao entrar em estado down, a fila  descartada e este contador  atualizado.
 								Se uma token for escalonada para uma facility (requestp ou preemptp) e esta estiver down, este contador tambm ser incrementado.*/
+	int f_bm;					/* srie de mdias de lotes que recebe o tamanho da fila (ver setFacQueueBatchMeans); 0 se nenhuma */
 };
 
 /* estrutura de cada servidor associado a uma facility */
@@ -109,10 +251,12 @@ struct fserv {
 	int fs_number;				/* numero do servidor */
 	int fs_tkn;					/* numero da token em processamento neste servidor */
 	int fs_p_tkn;				/* prioridade da token */
-	int fs_release_count;   	/* numero de tokens que foram servidas por este servidor. The preempt function *does not* increment this variable! Only the release function is incrementing this variable, in contrast to SMPL approach. */
+	long long fs_release_count;	/* numero de tokens que foram servidas por este servidor. The preempt function *does not* increment this variable! Only the release function is incrementing this variable, in contrast to SMPL approach. */
 	double fs_start;			/* momento de inicio do servico */
-	double fs_busy_time;		/* somatorio do tempo que o servidor ficou ocupado na simulacao */
+	struct simmSum fs_busy_time;	/* somatorio do tempo que o servidor ficou ocupado na simulacao */
 	struct fserv *fs_next;		/* apontador para o proximo servidor */
+	int fs_heap_pos;			/* posio do servidor em f_idle ou em f_busy */
+	struct fserv *fs_tab_next;	/* prximo servidor no mesmo bucket de f_srv_tab */
 };						
 
 struct fqueue {					/* estrutura da fila que  associada a facility */
@@ -154,8 +298,22 @@ struct evchain {					//declaracao da estrutura dos elementos da cadeia de evento
 	int ev_type;					//tipo do evento associado a esta token para ser processada
 	struct evchain *ev_previous;	//apontador para a token anterior (alterado de 'prior', (2005) Marcos Portnoi)
 	struct evchain *ev_next;		//apontador para a proxima token
+	long long ev_seq;				//ordem de insero, para desempate entre eventos de mesmo tempo (modos heap)
+	int ev_pos;						//posio do elemento no vetor do heap 4-rio (modo EVC_HEAP4) ou bucket do calendar queue (modo EVC_CALENDAR)
+	struct evchain *ev_child;		//primeiro filho no pairing heap (modo EVC_PAIRING); ev_previous e ev_next ligam os irmos
+	long long ev_id;				//identificador nico do evento pendente (0 quando fora da cadeia); validao de EVHANDLE
+	struct evchain *ev_tkn_next;	//prximo evento no mesmo bucket do ndice de tokens (evc_tkn_tab)
+	struct evchain *ev_tkn_previous;	//evento anterior no mesmo bucket do ndice de tokens
 
 									//Inicio da declaracao da estrutura da token
 	TOKEN *ev_tkn_p;				//Apontador do tipo da struct associada a token - packet
 									//Final da declaracao da estrutura da token
-};
\ No newline at end of file
+};
+
+/* Handle de um evento escalonado por schedulep_h, usado por cancelp_handle.  O handle deixa de ser vlido quando o
+*  evento ocorre ou  cancelado (ev_id do elemento no confere mais com eh_id).
+*/
+typedef struct evHandle {
+	struct evchain *eh_evc;			//elemento da cadeia de eventos
+	long long eh_id;				//identificador do evento no momento do escalonamento
+} EVHANDLE;
\ No newline at end of file
@@ -58,7 +58,8 @@ int *invertExplicitRoute(int route[], int size) {
 
 /* GRAVA UMA ROTA PERCORRIDA PELO PACOTE
 *
-*  Esta funo grava o nodo atual no objeto RecordRoute do prprio pacote.  Se este objeto for nulo, a funo cria-o e grava o nodo atual.
+*  Esta funo grava o nodo atual no objeto RecordRoute do prprio pacote.  Se este objeto for nulo, a funo cria-o e grava o nodo atual; o
+*  objeto criado fica com o pacote no pool de pacotes e  reaproveitado pelos prximos usos do pacote (ver createPacket).
 *  Em adio, o ndice para gravao do prximo nodo  incrementado (o objeto RecordRoute  um ponteiro para um array de inteiros).
 */
 void recordRoute(struct Packet *pkt) {
@@ -47,7 +47,7 @@ void decidePathStaticRoute(struct Packet *pkt) {
 			associando uma rota, label, tabela de roteamento */
 			pkt->outgoingLink = 1;
 			/* Link configurado para 1 por default */
-			if (irandom(1, 100) > 50)
+			if (irandom_s(tarvosStream(&tarvosContext()->tc_rngRoute, "decidePathStaticRoute"), 1, 100) > 50)
 				pkt->outgoingLink = 0;
 			/* Com 50% de probabilidade a configurao anterior pode ser mudada para o Link 2 */
 			break;
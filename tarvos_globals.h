@@ -134,8 +134,6 @@ enum EventType {EXPOO_1_ARRIVAL=1, EXPOO_2_ARRIVAL, CBR_1_ARRIVAL, CBR_2_ARRIVAL
 
 #ifdef MAIN_MODULE //se estiver definido, as estruturas e variveis sero definidas, e no apenas declaradas como extern; somente o arquivo com a funo main() deve conter uma linha tipo #define MAIN_MODULE
 
-struct TarvosModel tarvosModel = {0};
-
 /*struct TarvosParam {
 	int pathMsgSize; //tamanho em bytes de uma mensagem de controle PATH
 	int resvMsgSize; //tamanho em bytes de uma mensagem de controle RESV
@@ -153,10 +151,10 @@ struct TarvosModel tarvosModel = {0};
 	double helloInterval; //intervalo de tempo para gerao das mensagens HELLO a partir de um LSR
 	double LSPrefreshInterval; //intervalo de tempo para gerao de mensagens PATH refresh para as LSPs
 	double ResvRefreshInterval; //intervalo de tempo para gerao de mensagens RESV refresh para as LSPs
-	int traceMain; //flag que ativa as impresses de trace principais; 0 = OFF, 1 = ON.  Vrias funes geram trace para arquivos especficos
-	int traceDrop; //flag que ativa as impresses de trace para pacotes descartados; 0 = OFF, 1 = ON.
-	int traceSource; //flag que ativa as impresses de trace para geradores de trfego; 0 = OFF, 1 = ON.
-	int traceExpoo; //flag que ativa as impresses de trace para gerador de trfego Exponencial On/Off; 0 = OFF, 1 = ON.
+	int traceMain; //nvel das impresses de trace principais; 0 = OFF, 1 = ON, 2 = detalhado (ver tracePoint).  Vrias funes geram trace para arquivos especficos
+	int traceDrop; //nvel das impresses de trace para pacotes descartados; 0 = OFF, 1 = ON, 2 = detalhado.
+	int traceSource; //nvel das impresses de trace para geradores de trfego; 0 = OFF, 1 = ON, 2 = detalhado.
+	int traceExpoo; //nvel das impresses de trace para gerador de trfego Exponencial On/Off; 0 = OFF, 1 = ON, 2 = detalhado.
 	int traceJitterDelayGlobal; //flag que ativa as impresses de trace para medies de Jitter e Delay nodo a nodo, globais; 0 = OFF, 1 = ON.
 	int traceJitterDelayAppl; //flag que ativa as impresses de trace para medies de Jitter e Delay nodo a nodo para aplicaes; 0 = OFF, 1 = ON.
 	char libFile[50];  //nome do arquivo contendo a LIB para MPLS (para leitura do simulador)
@@ -171,6 +169,20 @@ struct TarvosModel tarvosModel = {0};
 	char jitterNodes[50];  //nome dos arquivos base que contero as medies Jitter de cada nodo
 	char applDelayNodes[50];  //nome dos arquivos base que contero as medies Delay de cada nodo para Aplicaes
 	char applJitterNodes[50];  //nome dos arquivos base que contero as medies Jitter de cada nodo para Aplicaes
+	int traceFormat; //formato dos traces:  TRACE_TEXT (um arquivo texto por trace, como acima) ou TRACE_BINARY (todos os traces num nico arquivo binrio binTrace; ver traceDecode)
+	char binTrace[50]; //nome do arquivo que conter o trace binrio (traceFormat = TRACE_BINARY)
+	int traceAsync; //flag que ativa a gravao dos traces por uma thread dedicada (writer), alimentada por um buffer circular; 0 = OFF, 1 = ON.
+	int traceRingSize; //capacidade do buffer circular da gravao assncrona, em registros (arredondada para potncia de 2)
+	int traceOverflow; //com o buffer circular cheio:  TRACE_WAIT (aguarda espao) ou TRACE_DISCARD (descarta e conta o registro; ver getTraceDiscardCount)
+	int jitterDelayOneFile; //flag que grava as medies de Delay e Jitter de todos os nodos (globais e de Aplicaes) num s arquivo, jitterDelayFile, com o nodo em cada linha, em vez de 2 arquivos por nodo; 0 = OFF, 1 = ON.
+	char jitterDelayFile[50]; //nome do arquivo nico das medies de Delay e Jitter (jitterDelayOneFile = 1)
+	double jitterDelayInterval; //intervalo de agregao das medies de Delay e Jitter:  0 grava cada pacote; > 0 grava, por nodo e por intervalo, o nmero de amostras e o mnimo, a mdia e o mximo
+	int traceFilter; //flag que ativa os filtros dos pontos de trace (traceFilterNodes, traceFilterLSPs, traceFilterEvents, traceFilterMsgTypes e traceSampleN; ver tracePoint); 0 = OFF, 1 = ON.
+	int traceFilterNodes[TRACE_FILTER_SIZE]; //nodos cujos pontos de trace so registrados, terminada por 0; a lista vazia ({0}) registra todos os nodos
+	int traceFilterLSPs[TRACE_FILTER_SIZE]; //LSPids cujos pontos de trace so registrados, terminada por 0; a lista vazia ({0}) registra todas as LSPs
+	unsigned int traceFilterEvents; //mscara dos eventos registrados (bit 1<<TREV_...; ver enum TraceEvent); 0 registra todos os eventos
+	unsigned int traceFilterMsgTypes; //mscara dos tipos de mensagem registrados (bit 1<<MSG_...; ver enum MsgType); 0 registra todos os tipos
+	int traceSampleN; //amostragem de pacotes:  registra os pontos de trace de 1 em cada traceSampleN pacotes, escolhidos por hash do ID do pacote; 0 ou 1 registra todos
 };
 */
 
@@ -190,7 +202,7 @@ struct TarvosParam tarvosParam = {120,	//tamanho em bytes de uma mensagem de con
 	0.005,								//intervalo de tempo para gerao das mensagens HELLO a partir de um LSR
 	30,									//intervalo de tempo para gerao de mensagens PATH refresh para as LSPs
 	30,									//intervalo de tempo para gerao de mensagens RESV refresh para as LSPs
-	0,									//flag traceMain; 0 para OFF, 1 para ON
+	0,									//flag traceMain; 0 para OFF, 1 para ON, 2 para detalhado
 	1,									//flag traceDrop;
 	0,									//flag traceSource;
 	0,									//flag traceExpoo;
@@ -207,18 +219,71 @@ struct TarvosParam tarvosParam = {120,	//tamanho em bytes de uma mensagem de con
 	"stats\\delay_node%02d.xls",		//nome dos arquivos base que contero as medies Delay de cada nodo
 	"stats\\jitter_node%02d.xls",		//nome dos arquivos base que contero as medies Jitter de cada nodo
 	"stats\\Appldelay_node%02d.xls",	//nome dos arquivos base que contero as medies Delay de cada nodo para Aplicaes
-	"stats\\Appljitter_node%02d.xls"};	//nome dos arquivos base que contero as medies Jitter de cada nodo para Aplicaes
+	"stats\\Appljitter_node%02d.xls",	//nome dos arquivos base que contero as medies Jitter de cada nodo para Aplicaes
+	TRACE_TEXT,							//formato dos traces:  TRACE_TEXT ou TRACE_BINARY
+	"trace.bin",						//nome do arquivo que conter o trace binrio (traceFormat = TRACE_BINARY)
+	0,									//flag traceAsync; 0 para OFF, 1 para ON
+	16384,								//capacidade do buffer circular da gravao assncrona, em registros
+	TRACE_WAIT,							//com o buffer circular cheio:  TRACE_WAIT ou TRACE_DISCARD
+	0,									//flag jitterDelayOneFile; 0 para OFF (um arquivo por nodo), 1 para ON (um s arquivo)
+	"stats\\jitterdelay.xls",			//nome do arquivo nico das medies de Delay e Jitter (jitterDelayOneFile = 1)
+	0,									//intervalo de agregao das medies de Delay e Jitter (0 grava cada pacote)
+	0,									//flag traceFilter; 0 para OFF (todos os pontos de trace so registrados), 1 para ON
+	{0},								//nodos filtrados pelos pontos de trace, terminada por 0 ({0} para todos)
+	{0},								//LSPids filtrados pelos pontos de trace, terminada por 0 ({0} para todas)
+	0,									//mscara dos eventos registrados (bit 1<<TREV_...; 0 para todos)
+	0,									//mscara dos tipos de mensagem registrados (bit 1<<MSG_...; 0 para todos)
+	0};									//amostragem de 1 em N pacotes nos pontos de trace (0 ou 1 para todos)
 
 #else //arquivo no contm a funo main(): declarar estruturas como extern
 
 extern struct TarvosParam tarvosParam; //parmetros para o TARVOS
-extern struct TarvosModel tarvosModel;
 
 #endif
 
+/* O modelo (tarvosModel) pertence ao contexto de simulao corrente; tarvosParam, acima,  configurao e continua nica para o processo,
+*  compartilhada (somente leitura durante a simulao) por todas as simulaes.
+*/
+struct TarvosContext *tarvosContext();
+#define tarvosModel (tarvosContext()->tc_model)
+int tarvosStream(int *stream, char *name);
+
+/* PONTOS DE TRACE ESTRUTURADOS
+*
+*  tracePoint(type, level, event, node, lsp, pkt, msgType, args...) registra o evento event (enum TraceEvent) no trace type (enum TraceType) se o nvel do trace
+*  em tarvosParam (traceMain, traceDrop, traceSource ou traceExpoo) for pelo menos level.  O nvel  testado antes de qualquer outra coisa:  com o trace
+*  desligado, os argumentos nem so avaliados.  Os argumentos so os do formato do evento (ver traceFormats) e so gravados no registro como valores;
+*  o texto s  montado na gravao dos arquivos texto (ou por traceDecode).  node, lsp e pkt identificam o nodo, o LSPid e o pacote do registro (0 se
+*  no se aplica), e msgType o tipo da mensagem (enum MsgType; MSG_NONE se no se aplica); com traceFilter ligado, so comparados com os filtros de
+*  tarvosParam (traceSelect) logo depois do nvel, antes de o registro ser montado.  node, lsp, pkt e msgType podem ser avaliados duas vezes e devem
+*  ser expresses simples.
+*  Compilando com TARVOS_TRACE 0 todos os pontos de trace desaparecem do cdigo.
+*/
+#ifndef TARVOS_TRACE
+#define TARVOS_TRACE 1
+#endif
+#define traceLevel(type)	((type)==TRACE_MAIN ? tarvosParam.traceMain : (type)==TRACE_DROP ? tarvosParam.traceDrop : \
+							 (type)==TRACE_SOURCE ? tarvosParam.traceSource : tarvosParam.traceExpoo)
+#if TARVOS_TRACE
+#define traceOn(type, level)		(traceLevel(type)>=(level))
+#define tracePoint(type, level, event, node, lsp, pkt, msgType, ...)	do { if (traceOn(type, level) && (!tarvosParam.traceFilter || traceSelect(event, node, lsp, pkt, msgType))) \
+																traceEvent(type, event, node, pkt, __VA_ARGS__); } while (0)
+#else
+#define traceOn(type, level)		0
+#define tracePoint(type, level, ...)	((void)0)
+#endif
+int traceSelect(int event, int node, int lsp, int pkt, int msgType);
+void traceEvent(int type, int event, int node, int pkt, ...);
+
 /* --------- Prototypes de funes usadas no Computer Networks Simulator -----------------*/
 struct Packet *createPacket();
 void freePkt(struct Packet *pkt);
+const char *getMsgTypeName(int msgType);
+void pktPoolFree(struct TarvosContext *tc);
+void traceContextFree(struct TarvosContext *tc);
+int getPktPoolLive();
+int getPktPoolPeak();
+long long getPktPoolRecycled();
 void createTrafficSource (int n_src);
 void expTrafficGenerator(int ev, int n_src, int length, int source, int dst, double tau, int prio);
 int nodeReceivePacket(struct Packet *pkt);
@@ -239,7 +304,7 @@ char *getLinkStatus(int linkNumber);
 int getPktInTransitQueueSize(int linkNumber);
 void removePktFromTransitQueue(int linkNumber, int pktId);
 void createNode(int n_node);
-void insertInNodeMsgQueue(int n_node, char *msgType, int msgID, int msgIDack, int LSPid, int er[], int erIndex, int source, int dst, double timeout, int ev, int iIface, int oIface, int iLabel, int oLabel, int resourcesReserved);
+void insertInNodeMsgQueue(int n_node, int msgType, int msgID, int msgIDack, int LSPid, int er[], int erIndex, int source, int dst, double timeout, int ev, int iIface, int oIface, int iLabel, int oLabel, int resourcesReserved);
 struct nodeMsgQueue *searchInNodeMsgQueueLSPid(int n_node, int LSPid);
 struct nodeMsgQueue *searchInNodeMsgQueueAck(int n_node, int msgIDack);
 void removeFromNodeMsgQueueLSPid(int n_node, int LSPid);
@@ -250,6 +315,13 @@ void setNodeCtrlMsgHandlEv(int n_node, int ev);
 int getNodeCtrlMsgHandlEv(int n_node);
 void setNodeLSPTimeout(int n_node, double timeout);
 double getNodeLSPTimeout(int n_node);
+double getNodeMeanDelay(int n_node);
+void setNodeDelayBatchMeans(int n_node, int s);
+void setNodeHistograms(int n_node);
+double getNodeDelayQuantile(int n_node, double q);
+double getNodeDelayStdDev(int n_node);
+double getNodeJitterStdDev(int n_node);
+void nodeResetStats(int n_node);
 void decidePathStaticRoute(struct Packet *pkt);
 void cbrTrafficGenerator(int ev, int n_src, int length, int source, int dst, double rate, int prio);
 void expooTrafficGenerator(int ev, int n_src, int length, int source, int dst, double rate, double ton, double toff, int prio);
@@ -278,6 +350,9 @@ void mainTrace(char *entry);
 void dropPktTrace(char *entry);
 void sourceTrace(char *entry);
 void expooSourceTrace(char *entry);
+void traceFlush();
+long long traceDecode(char *binFile);
+long long getTraceDiscardCount();
 int applyPolicer(struct Packet *pkt);
 int reserveResouces(int LSPid, int link);
 double getLSPcbs(int LSPid);
@@ -311,10 +386,10 @@ int getLSPtunnelStatus(int LSPid);
 int setLSPtunnelDone(int LSPid);
 int setLSPtunnelNotDone(int LSPid);
 struct LIBEntry *searchInLIBnodLSPstatBak(int node, int LSPid, char *status);
-void jitterDelayTrace(int node, double stime, double jitter, double delay);
-void jitterDelayApplTrace(int node, double stime, double jitter, double delay);
-struct Packet *createPathErrControlMsg(int source, int dst, int LSPid, char *errorCode, char *errorValue);
-struct Packet *createResvErrControlMsg(int source, int dst, int LSPid, int iLabel, char *errorCode, char *errorValue);
+void jitterDelayTrace(int node, int pkt, double stime, double jitter, double delay);
+void jitterDelayApplTrace(int node, int pkt, double stime, double jitter, double delay);
+struct Packet *createPathErrControlMsg(int source, int dst, int LSPid, int errorCode, int errorValue);
+struct Packet *createResvErrControlMsg(int source, int dst, int LSPid, int iLabel, int errorCode, int errorValue);
 struct Packet *createPathPreemptControlMsg(int source, int dst, int er[], int LSPid);
 struct Packet *createResvPreemptControlMsg(int source, int dst, int er[], int msgIDack, int LSPid, int label);
 int preemptResouces(int LSPid, int node, int link);
@@ -325,7 +325,6 @@ void setDuplexLinkDown(int linkNumber) {
 */
 void setSimplexLinkDown(int linkNumber) {
 	int i, packetsDropped;
-	char dropTraceEntry[255];
 
 	strcpy(tarvosModel.lnk[linkNumber].status, "down");
 	//coloca o servidor de transmisso em down;
@@ -335,20 +334,16 @@ void setSimplexLinkDown(int linkNumber) {
 	for (i=0;i<packetsDropped;i++) {
 		nodeIncDroppedPacketsNumber(tarvosModel.lnk[linkNumber].src);
 	}
-	sprintf(dropTraceEntry, "LINK %d DOWN at simtime: %f  Total Packets Dropped:  %d\n", linkNumber, simtime(),packetsDropped);
-	dropPktTrace(dropTraceEntry);
-	mainTrace(dropTraceEntry);
+	tracePoint(TRACE_DROP, 1, TREV_LINK_DOWN, tarvosModel.lnk[linkNumber].src, 0, 0, MSG_NONE, linkNumber, simtime(), packetsDropped);
+	tracePoint(TRACE_MAIN, 1, TREV_LINK_DOWN, tarvosModel.lnk[linkNumber].src, 0, 0, MSG_NONE, linkNumber, simtime(), packetsDropped);
 }
 
 /*  COLOCA O LINK EM ESTADO UP (OPERACIONAL)
 */
 void setSimplexLinkUp(int linkNumber) {
-	char mainTraceEntry[255];
-
 	strcpy(tarvosModel.lnk[linkNumber].status, "up");
 	setFacUp(tarvosModel.lnk[linkNumber].facility);
-	sprintf(mainTraceEntry, "LINK %d UP at simtime: %f\n", linkNumber, simtime());
-	mainTrace(mainTraceEntry);
+	tracePoint(TRACE_MAIN, 1, TREV_LINK_UP, tarvosModel.lnk[linkNumber].src, 0, 0, MSG_NONE, linkNumber, simtime());
 }
 
 /*  COLOCA O DUPLEX LINK EM ESTADO UP (OPERACIONAL)
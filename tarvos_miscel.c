@@ -25,11 +25,55 @@
 #include "tarvos_globals.h"
 #include "simm_globals.h"
 
+/* Libera o estado do shell de um contexto de simulao; chamada por simmContextDestroy */
+static void tarvosContextFree(void *shell) {
+	pktPoolFree((struct TarvosContext *)shell);
+	traceContextFree((struct TarvosContext *)shell);
+	free(shell);
+}
+
+/* CONTEXTO DO SHELL TARVOS
+*
+*  Retorna a estrutura TarvosContext do contexto de simulao corrente do kernel, criando-a (zerada) no primeiro uso.  A estrutura  guardada
+*  no campo sc_shell do contexto e liberada por simmContextDestroy (tarvosContextFree).  Os pacotes descartados das filas dos links pelo kernel
+*  (setFacDown) voltam ao pool de pacotes por freePkt.
+*/
+struct TarvosContext *tarvosContext() {
+	struct simmContext *ctx = SIMM_CTX;
+
+	if (ctx->sc_shell == NULL) {
+		ctx->sc_shell = calloc(1, sizeof(struct TarvosContext));
+		if (ctx->sc_shell == NULL) {
+			printf("\nError - tarvosContext - insufficient memory to allocate for TARVOS context");
+			exit(1);
+		}
+		ctx->sc_shell_free = tarvosContextFree;
+		ctx->sc_tkn_free = freePkt;
+	}
+	return (struct TarvosContext *)ctx->sc_shell;
+}
+
+/* STREAMS ALEATRIOS NOMEADOS
+*
+*  Retorna o stream aleatrio guardado em *stream, criando-o com rngNamedStream(name) no primeiro uso (*stream == 0).  Cada fonte de trfego e
+*  cada ponto de deciso aleatria do TARVOS tem o seu stream, de modo que duas configuraes do modelo (por exemplo, com e sem setBackupLSP)
+*  consomem as mesmas seqncias aleatrias nos mesmos pontos (nmeros aleatrios comuns), reduzindo a varincia da diferena entre elas.
+*/
+int tarvosStream(int *stream, char *name) {
+	if (*stream == 0)
+		*stream = rngNamedStream(name);
+	return *stream;
+}
+
 /* MASTER RESET ou RESET DOS ACUMULADORES ESTATSTICOS
 *
-*  Inicializa os acumuladores estatsticos pertinentes tanto do shell TARVOS, quanto do kernel SimM.
+*  Inicializa os acumuladores estatsticos pertinentes tanto do shell TARVOS, quanto do kernel SimM.  Pode ser chamada num instante fixo
+*  (RESET_TIME) ou quando o detector de transitrio (bmWarmup) escalonar o evento de reset.
 */
 void statReset() {
-	//colocar aqui as rotinas de inicializao dos contadores estatsticos do TARVOS
-	reset();
+	int i;
+
+	for (i=1; i<=NODES; i++) //estatsticas dos nodos
+		nodeResetStats(i);
+	reset(); //kernel:  facilities, relgio de incio das medies e sries de mdias de lotes
 }
\ No newline at end of file
@@ -64,21 +64,27 @@ void createNode(int n_node) {
 	tarvosModel.node[n_node].bytesReceived = 0; //Quantidade de bytes recebidos pelo nodo (admite-se pacotes de tamanho diferente)
 	tarvosModel.node[n_node].bytesForwarded = 0; //quantidade de bytes encaminhados a partir deste nodo
 	tarvosModel.node[n_node].delay=0; //atraso medido para o ltimo pacote recebido pelo nodo
-	tarvosModel.node[n_node].delaySum=0; //somatrio dos atrasos medidos para pacotes recebidos por este nodo
+	memset(&tarvosModel.node[n_node].delaySum, 0, sizeof tarvosModel.node[n_node].delaySum); //somatrio dos atrasos medidos para pacotes recebidos por este nodo
+	memset(&tarvosModel.node[n_node].delayMom, 0, sizeof tarvosModel.node[n_node].delayMom); //mdia e varincia dos atrasos
 	tarvosModel.node[n_node].meanDelay=0; //atraso mdio medido para os pacotes recebidos por este nodo
 	tarvosModel.node[n_node].jitter=0; //ltimo jitter medido para o ltimo pacote recebido por este nodo
-	tarvosModel.node[n_node].jitterSum=0; //somatrio dos jitters medidos para os pacotes recebidos por este nodo
+	memset(&tarvosModel.node[n_node].jitterSum, 0, sizeof tarvosModel.node[n_node].jitterSum); //somatrio dos jitters medidos para os pacotes recebidos por este nodo
+	memset(&tarvosModel.node[n_node].jitterMom, 0, sizeof tarvosModel.node[n_node].jitterMom); //mdia e varincia dos jitters
 	tarvosModel.node[n_node].meanJitter=0; //jitter mdio medido para os pacotes recebidos por este nodo
+	tarvosModel.node[n_node].bmDelay=0; //nenhuma srie de mdias de lotes para o atraso
+	tarvosModel.node[n_node].hist=0; //nenhum histograma de atraso e jitter
 	//abaixo, estatsticas para pacotes no-controle
 	tarvosModel.node[n_node].packetsReceivedAppl = 0; //Nmero de pacotes que chegaram a este nodo
 	tarvosModel.node[n_node].packetsForwardedAppl = 0; //Nmero de pacotes que foram encaminhados a partir deste nodo
 	tarvosModel.node[n_node].bytesReceivedAppl = 0; //Quantidade de bytes recebidos pelo nodo (admite-se pacotes de tamanho diferente)
 	tarvosModel.node[n_node].bytesForwardedAppl = 0; //quantidade de bytes encaminhados a partir deste nodo
 	tarvosModel.node[n_node].delayAppl=0; //atraso medido para o ltimo pacote recebido pelo nodo
-	tarvosModel.node[n_node].delaySumAppl=0; //somatrio dos atrasos medidos para pacotes recebidos por este nodo
+	memset(&tarvosModel.node[n_node].delaySumAppl, 0, sizeof tarvosModel.node[n_node].delaySumAppl); //somatrio dos atrasos medidos para pacotes recebidos por este nodo
+	memset(&tarvosModel.node[n_node].delayMomAppl, 0, sizeof tarvosModel.node[n_node].delayMomAppl); //mdia e varincia dos atrasos
 	tarvosModel.node[n_node].meanDelayAppl=0; //atraso mdio medido para os pacotes recebidos por este nodo
 	tarvosModel.node[n_node].jitterAppl=0; //ltimo jitter medido para o ltimo pacote recebido por este nodo
-	tarvosModel.node[n_node].jitterSumAppl=0; //somatrio dos jitters medidos para os pacotes recebidos por este nodo
+	memset(&tarvosModel.node[n_node].jitterSumAppl, 0, sizeof tarvosModel.node[n_node].jitterSumAppl); //somatrio dos jitters medidos para os pacotes recebidos por este nodo
+	memset(&tarvosModel.node[n_node].jitterMomAppl, 0, sizeof tarvosModel.node[n_node].jitterMomAppl); //mdia e varincia dos jitters
 	tarvosModel.node[n_node].meanJitterAppl=0; //jitter mdio medido para os pacotes recebidos por este nodo
 	links=(sizeof tarvosModel.lnk / sizeof *(tarvosModel.lnk)); //tamanho do vetor de links (que  o nmero real de links + 1)
 	tarvosModel.node[n_node].nextLabel=(int(*)[])malloc(links * sizeof(**(tarvosModel.node[n_node].nextLabel))); //cria vetor com [nmero de links] posies
@@ -129,10 +135,9 @@ static struct nodeMsgQueue *createNodeMsgQueue(int n_node) {
 *  (nota:  a Lista de Mensagens  uma lista dinmica duplamente encadeada circular com Head Node)
 *  Passar todo o contedo de uma linha da lista como parmetros
 */
-void insertInNodeMsgQueue(int n_node, char *msgType, int msgID, int msgIDack, int LSPid, int er[], int erIndex, int source, int dst, double timeout,
+void insertInNodeMsgQueue(int n_node, int msgType, int msgID, int msgIDack, int LSPid, int er[], int erIndex, int source, int dst, double timeout,
 						  int ev, int iIface, int oIface, int iLabel, int oLabel, int resourcesReserved) {
 	struct nodeMsgQueue *p; //varivel tipo apontador auxiliar
-	char traceString[255];
 
 	p=tarvosModel.node[n_node].nodeMsgQueue;
 	p->previous->next = (nodeMsgQueue*)malloc(sizeof *(p->previous->next)); //cria mais um n ao final da lista (lista duplamente encadeada)
@@ -144,7 +149,7 @@ void insertInNodeMsgQueue(int n_node, char *msgType, int msgID, int msgIDack, in
 	p->previous->next->next=p; //atualiza ponteiro next do novo n da lista
 	p->previous=p->previous->next; //atualiza ponteiro previous do Head Node
 	p->previous->previous->next=p->previous; //atualiza ponteiro next do penltimo n
-	strcpy(p->previous->msgType, msgType);
+	p->previous->msgType=msgType;
 	p->previous->msgID=msgID;
 	p->previous->msgIDack=msgIDack;
 	p->previous->LSPid=LSPid;
@@ -161,8 +166,7 @@ void insertInNodeMsgQueue(int n_node, char *msgType, int msgID, int msgIDack, in
 	p->previous->ev=ev; /*insere o evento de tratamento informado pelo usurio (pode ser, por exemplo, um evento de transmisso do pacote;
 						um LER de destino recebe uma mensagem PATH e gera automaticamente uma mensagem RESV para o caminho inverso; deve ento
 						escalonar este evento para tratar a mensagem RESV recm-criada*/
-	sprintf(traceString, "CtrlMsg inserted in node Queue: node:  %d  msgID:  %d  LSPid:  %d  src:  %d  dst:  %d  iLabel:  %d\n", n_node, msgID, LSPid, source, dst, iLabel);
-	mainTrace(traceString);
+	tracePoint(TRACE_MAIN, 1, TREV_MSGQ_INSERT, n_node, LSPid, 0, msgType, n_node, msgID, LSPid, source, dst, iLabel);
 }
 
 /* BUSCA ITEM NA LISTA DE MENSAGENS DE CONTROLE DO NODO POR LSP_ID
@@ -209,16 +213,13 @@ struct nodeMsgQueue *searchInNodeMsgQueueAck(int n_node, int msgIDack) {
 */
 void removeFromNodeMsgQueueLSPid(int n_node, int LSPid) {
 	struct nodeMsgQueue *p; //varivel tipo apontador auxiliar
-	char traceString[255];
 
 	p=searchInNodeMsgQueueLSPid(n_node, LSPid);
 	if (p!=NULL) { //se for NULL, item no foi encontrado
 		p->next->previous=p->previous;
 		p->previous->next=p->next;
 		//Debug
-		sprintf(traceString, "Ctrl Msg REMOVED - msgID: %d msgIDack: %d LSPid: %d src: %d dst: %d iIface: %d oIface: %d  %s\n", p->msgID, p->msgIDack, p->LSPid, p->src,
-			p->dst, p->iIface, p->oIface, p->msgType);
-		mainTrace(traceString);
+		tracePoint(TRACE_MAIN, 1, TREV_MSGQ_REMOVE, n_node, p->LSPid, 0, p->msgType, p->msgID, p->msgIDack, p->LSPid, p->src, p->dst, p->iIface, p->oIface, getMsgTypeName(p->msgType));
 		free(p); //libera espao ocupado por n em p
 	}
 }
@@ -229,16 +230,13 @@ void removeFromNodeMsgQueueLSPid(int n_node, int LSPid) {
 */
 void removeFromNodeMsgQueueAck(int n_node, int msgIDack) {
 	struct nodeMsgQueue *p; //varivel tipo apontador auxiliar
-	char traceString[255];
 
 	p=searchInNodeMsgQueueAck(n_node, msgIDack);
 	if (p!=NULL) { //se for NULL, item no foi encontrado
 		p->next->previous=p->previous;
 		p->previous->next=p->next;
 		//Debug
-		sprintf(traceString, "Ctrl Msg REMOVED - msgID: %d msgIDack: %d LSPid: %d src: %d dst: %d iIface: %d oIface: %d  %s\n", p->msgID, p->msgIDack, p->LSPid, p->src,
-			p->dst, p->iIface, p->oIface, p->msgType);
-		mainTrace(traceString);
+		tracePoint(TRACE_MAIN, 1, TREV_MSGQ_REMOVE, n_node, p->LSPid, 0, p->msgType, p->msgID, p->msgIDack, p->LSPid, p->src, p->dst, p->iIface, p->oIface, getMsgTypeName(p->msgType));
 		free(p); //libera espao ocupado por n em p
 	}
 }
@@ -331,10 +329,12 @@ static void nodeUpdateForwardStats(struct Packet *pkt) {
 *  bytesReceived:  quantidade de bytes recebidos pelo nodo
 *  packetsReceived:  quantidade de pacotes recebidos pelo nodo
 *  delay:  atraso registrado para o pacote
-*  delaySum:  somatrio de todos os delays registrados no nodo
+*  delaySum:  somatrio compensado (sumAdd) de todos os delays registrados no nodo
+*  delayMom:  mdia e varincia (momAdd) dos delays registrados no nodo
 *  meanDelay:  atraso mdio (meanDelay = delaySum/packetsReceived)
 *  jitter:  jitter deste pacote (jitter = atraso deste pacote - atraso do pacote anterior)
-*  jitterSum:  somatrio dos jitters
+*  jitterSum:  somatrio compensado dos jitters
+*  jitterMom:  mdia e varincia dos jitters (somente a partir do segundo pacote)
 *  meanJitter:  jitter mdio (meanJitter = jitterSum / (packetsReceived-1)). Notice that meanJitter = jitterSum / #Jitter Samples. And #Jitter Samples = packetsReceived - 1 (every two packets received yield one jitter sample).
 *
 *  O nmero packetsForwarded NO  atualizado aqui!  Cuidar disso na funo nodeUpdateForwardStats.
@@ -356,15 +356,25 @@ static void nodeUpdateStats(struct Packet *pkt) {
 	tarvosModel.node[pkt->currentNode].packetsReceived++; //atualiza estatsticas do nodo para packetsReceived
 	tarvosModel.node[pkt->currentNode].bytesReceived+=pkt->length; //atualiza estatsticas do nodo para bytesReceived
 	tarvosModel.node[pkt->currentNode].delay=stime-pkt->generationTime; //atualiza delay deste pacote
-	tarvosModel.node[pkt->currentNode].delaySum+=tarvosModel.node[pkt->currentNode].delay; //atualiza somatrio dos delays
-	tarvosModel.node[pkt->currentNode].meanDelay=tarvosModel.node[pkt->currentNode].delaySum/tarvosModel.node[pkt->currentNode].packetsReceived; //atualiza delay mdio
-	if (tarvosModel.node[pkt->currentNode].packetsReceived>1) //s calcula jitter se houver pacote anterior recebido (no calcula para o primeiro pacote)
+	sumAdd(&tarvosModel.node[pkt->currentNode].delaySum, tarvosModel.node[pkt->currentNode].delay); //atualiza somatrio dos delays
+	momAdd(&tarvosModel.node[pkt->currentNode].delayMom, tarvosModel.node[pkt->currentNode].delay, 1.0); //atualiza varincia dos delays
+	tarvosModel.node[pkt->currentNode].meanDelay=sumValue(&tarvosModel.node[pkt->currentNode].delaySum)/tarvosModel.node[pkt->currentNode].packetsReceived; //atualiza delay mdio
+	if (tarvosModel.node[pkt->currentNode].packetsReceived>1) { //s calcula jitter se houver pacote anterior recebido (no calcula para o primeiro pacote)
 		tarvosModel.node[pkt->currentNode].jitter=tarvosModel.node[pkt->currentNode].delay-previousDelay; //calcula jitter para este pacote
-	tarvosModel.node[pkt->currentNode].jitterSum+=tarvosModel.node[pkt->currentNode].jitter; //calcula somatrio dos jitters
+		momAdd(&tarvosModel.node[pkt->currentNode].jitterMom, tarvosModel.node[pkt->currentNode].jitter, 1.0); //atualiza varincia dos jitters
+	}
+	sumAdd(&tarvosModel.node[pkt->currentNode].jitterSum, tarvosModel.node[pkt->currentNode].jitter); //calcula somatrio dos jitters
 	if (tarvosModel.node[pkt->currentNode].packetsReceived>1) //s calcula o jitter mdio se houver pacote j recebido
-		tarvosModel.node[pkt->currentNode].meanJitter=tarvosModel.node[pkt->currentNode].jitterSum/(tarvosModel.node[pkt->currentNode].packetsReceived-1); //calcula jitter mdio (a quantidade de jitters guardados  igual  de pacotes recebidos -1)
+		tarvosModel.node[pkt->currentNode].meanJitter=sumValue(&tarvosModel.node[pkt->currentNode].jitterSum)/(tarvosModel.node[pkt->currentNode].packetsReceived-1); //calcula jitter mdio (a quantidade de jitters guardados  igual  de pacotes recebidos -1)
+	if (tarvosModel.node[pkt->currentNode].bmDelay!=0) //alimenta a srie de mdias de lotes do atraso, se houver
+		bmObserve(tarvosModel.node[pkt->currentNode].bmDelay, tarvosModel.node[pkt->currentNode].delay);
+	if (tarvosModel.node[pkt->currentNode].hist!=0) { //alimenta os histogramas do nodo, se houver; o jitter entra em valor absoluto
+		histRecord(tarvosModel.node[pkt->currentNode].hist, tarvosModel.node[pkt->currentNode].delay);
+		if (tarvosModel.node[pkt->currentNode].packetsReceived>1)
+			histRecord(tarvosModel.node[pkt->currentNode].hist+1, fabs(tarvosModel.node[pkt->currentNode].jitter));
+	}
 	//Desabilitar a chamada abaixo para distribuio
-	jitterDelayTrace(pkt->currentNode, stime, tarvosModel.node[pkt->currentNode].jitter, tarvosModel.node[pkt->currentNode].delay);
+	jitterDelayTrace(pkt->currentNode, pkt->id, stime, tarvosModel.node[pkt->currentNode].jitter, tarvosModel.node[pkt->currentNode].delay);
 
 	//estatsticas para pacotes exclusivamente de aplicao
 	if (pkt->lblHdr.msgID==0) {
@@ -372,15 +382,23 @@ static void nodeUpdateStats(struct Packet *pkt) {
 		tarvosModel.node[pkt->currentNode].packetsReceivedAppl++; //atualiza estatsticas do nodo para packetsReceived
 		tarvosModel.node[pkt->currentNode].bytesReceivedAppl+=pkt->length; //atualiza estatsticas do nodo para bytesReceived
 		tarvosModel.node[pkt->currentNode].delayAppl=stime-pkt->generationTime; //atualiza delay deste pacote
-		tarvosModel.node[pkt->currentNode].delaySumAppl+=tarvosModel.node[pkt->currentNode].delayAppl; //atualiza somatrio dos delays
-		tarvosModel.node[pkt->currentNode].meanDelayAppl=tarvosModel.node[pkt->currentNode].delaySumAppl/tarvosModel.node[pkt->currentNode].packetsReceivedAppl; //atualiza delay mdio
-		if (tarvosModel.node[pkt->currentNode].packetsReceivedAppl>1) //s calcula jitter se houver pacote anterior recebido (no calcula para o primeiro pacote)
+		sumAdd(&tarvosModel.node[pkt->currentNode].delaySumAppl, tarvosModel.node[pkt->currentNode].delayAppl); //atualiza somatrio dos delays
+		momAdd(&tarvosModel.node[pkt->currentNode].delayMomAppl, tarvosModel.node[pkt->currentNode].delayAppl, 1.0); //atualiza varincia dos delays
+		tarvosModel.node[pkt->currentNode].meanDelayAppl=sumValue(&tarvosModel.node[pkt->currentNode].delaySumAppl)/tarvosModel.node[pkt->currentNode].packetsReceivedAppl; //atualiza delay mdio
+		if (tarvosModel.node[pkt->currentNode].packetsReceivedAppl>1) { //s calcula jitter se houver pacote anterior recebido (no calcula para o primeiro pacote)
 			tarvosModel.node[pkt->currentNode].jitterAppl=tarvosModel.node[pkt->currentNode].delayAppl-previousDelay; //calcula jitter para este pacote
-		tarvosModel.node[pkt->currentNode].jitterSumAppl+=tarvosModel.node[pkt->currentNode].jitterAppl; //calcula somatrio dos jitters
+			momAdd(&tarvosModel.node[pkt->currentNode].jitterMomAppl, tarvosModel.node[pkt->currentNode].jitterAppl, 1.0); //atualiza varincia dos jitters
+		}
+		sumAdd(&tarvosModel.node[pkt->currentNode].jitterSumAppl, tarvosModel.node[pkt->currentNode].jitterAppl); //calcula somatrio dos jitters
 		if (tarvosModel.node[pkt->currentNode].packetsReceivedAppl>1) //s calcula o jitter mdio se houver pacote j recebido
-			tarvosModel.node[pkt->currentNode].meanJitterAppl=tarvosModel.node[pkt->currentNode].jitterSumAppl/(tarvosModel.node[pkt->currentNode].packetsReceivedAppl-1); //calcula jitter mdio (a quantidade de jitters guardados  igual  de pacotes recebidos -1)
+			tarvosModel.node[pkt->currentNode].meanJitterAppl=sumValue(&tarvosModel.node[pkt->currentNode].jitterSumAppl)/(tarvosModel.node[pkt->currentNode].packetsReceivedAppl-1); //calcula jitter mdio (a quantidade de jitters guardados  igual  de pacotes recebidos -1)
+		if (tarvosModel.node[pkt->currentNode].hist!=0) {
+			histRecord(tarvosModel.node[pkt->currentNode].hist+2, tarvosModel.node[pkt->currentNode].delayAppl);
+			if (tarvosModel.node[pkt->currentNode].packetsReceivedAppl>1)
+				histRecord(tarvosModel.node[pkt->currentNode].hist+3, fabs(tarvosModel.node[pkt->currentNode].jitterAppl));
+		}
 		//Desabilitar a chamada abaixo para distribuio
-		jitterDelayApplTrace(pkt->currentNode, stime, tarvosModel.node[pkt->currentNode].jitterAppl, tarvosModel.node[pkt->currentNode].delayAppl);
+		jitterDelayApplTrace(pkt->currentNode, pkt->id, stime, tarvosModel.node[pkt->currentNode].jitterAppl, tarvosModel.node[pkt->currentNode].delayAppl);
 	}
 }	
 
@@ -412,11 +430,9 @@ void nodeIncDroppedPacketsNumber(int nodeNumber) {
 *  11.Jan.2006 Marcos Portnoi
 */
 void nodeDropPacket(struct Packet *pkt, char *dropReason) {
-	char dropTraceEntry[255];
-
 	nodeIncDroppedPacketsNumber(pkt->currentNode); //incrementa contador de packets dropped
-	sprintf(dropTraceEntry, "simtime: %f  node: %d  ID: %d  msgID: %d label: %d src: %d  dst: %d outgoingLink: %d  reason: %s\n", simtime(), pkt->currentNode, pkt->id, pkt->lblHdr.msgID, pkt->lblHdr.label, pkt->src, pkt->dst, pkt->outgoingLink, dropReason);
-	dropPktTrace(dropTraceEntry);
+	tracePoint(TRACE_DROP, 1, TREV_PKT_DROP, pkt->currentNode, pkt->lblHdr.LSPid, pkt->id, pkt->lblHdr.msgType, simtime(), pkt->currentNode, pkt->id, pkt->lblHdr.msgID, pkt->lblHdr.label, pkt->src,
+		pkt->dst, pkt->outgoingLink, dropReason);
 	freePkt(pkt); //descarta o pacote da memria
 }
 
@@ -427,15 +443,12 @@ void nodeDropPacket(struct Packet *pkt, char *dropReason) {
 *  A funo retorna 0 se houve alguma falha no processamento da mensagem, e retorna 1 se houve o processamento completo bem sucedido.
 */
 static int nodeReceiveCtrlMsg(struct Packet *pkt) {
-	char mainTraceString[255];
-	
 	//trace para DEBUG
-	sprintf(mainTraceString, "Ctrl Msg Received - node:  %d  msgID:  %d  msgIDack:  %d  LSPid:  %d  src:  %d  dst:  %d label:  %d  %s\n", pkt->currentNode,
-		pkt->lblHdr.msgID, pkt->lblHdr.msgIDack, pkt->lblHdr.LSPid, pkt->src, pkt->dst, pkt->lblHdr.label, pkt->lblHdr.msgType);
-	mainTrace(mainTraceString);
+	tracePoint(TRACE_MAIN, 1, TREV_CTRLMSG_RECEIVED, pkt->currentNode, pkt->lblHdr.LSPid, pkt->id, pkt->lblHdr.msgType, pkt->currentNode, pkt->lblHdr.msgID, pkt->lblHdr.msgIDack, pkt->lblHdr.LSPid,
+		pkt->src, pkt->dst, pkt->lblHdr.label, getMsgTypeName(pkt->lblHdr.msgType));
 	
 	//PATH_LABEL_REQUEST
-	if (strcmp(pkt->lblHdr.msgType, "PATH_LABEL_REQUEST")==0) {
+	if (pkt->lblHdr.msgType==MSG_PATH_LABEL_REQUEST) {
 		if (nodeProcessPathLabelRequest(pkt)==1) //verifique se o processamento da PATH foi bem sucedido
 			return 1; //PATH foi processada de forma bem sucedida; reporte isso para a funo chamante
 		else
@@ -443,7 +456,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 
 	//RESV_LABEL_MAPPING
-	if (strcmp(pkt->lblHdr.msgType, "RESV_LABEL_MAPPING")==0) {
+	if (pkt->lblHdr.msgType==MSG_RESV_LABEL_MAPPING) {
 		if (nodeProcessResvLabelMapping(pkt)==1)
 			return 1; //retorne sucesso para processamento RESV_LABEL_MAPPING
 		else
@@ -451,7 +464,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 
 	//PATH_REFRESH
-	if (strcmp(pkt->lblHdr.msgType, "PATH_REFRESH")==0) {
+	if (pkt->lblHdr.msgType==MSG_PATH_REFRESH) {
 		if (nodeProcessPathRefresh(pkt)==1) //verifique se o processamento da PATH_REFRESH foi bem sucedido
 			return 1; //PATH_REFRESH foi bem sucedida; reporte isso para a funo chamante
 		else
@@ -459,7 +472,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 
 	//RESV_REFRESH
-	if (strcmp(pkt->lblHdr.msgType, "RESV_REFRESH")==0) {
+	if (pkt->lblHdr.msgType==MSG_RESV_REFRESH) {
 		if (nodeProcessResvRefresh(pkt)==1) //verifique se o processamento foi bem sucedido
 			return 1; //retorne SUCESSO
 		else
@@ -467,7 +480,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 
 	//HELLO
-	if (strcmp(pkt->lblHdr.msgType, "HELLO")==0) {
+	if (pkt->lblHdr.msgType==MSG_HELLO) {
 		if (nodeProcessHello(pkt)==1)
 			return 1; //retorne SUCESSO como processamento da mensagem HELLO
 		else
@@ -475,7 +488,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 
 	//HELLO_ACK
-	if (strcmp(pkt->lblHdr.msgType, "HELLO_ACK")==0) {
+	if (pkt->lblHdr.msgType==MSG_HELLO_ACK) {
 		if (nodeProcessHelloAck(pkt)==1)
 			return 1; //retorne SUCESSO como processamento da mensagem HELLO_ACK
 		else
@@ -483,7 +496,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 	
 	//PATH_DETOUR
-	if (strcmp(pkt->lblHdr.msgType, "PATH_DETOUR")==0) {
+	if (pkt->lblHdr.msgType==MSG_PATH_DETOUR) {
 		if (nodeProcessPathDetour(pkt)==1) //verifique se o processamento da PATH foi bem sucedido
 			return 1; //PATH foi processada de forma bem sucedida; reporte isso para a funo chamante
 		else
@@ -491,7 +504,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 
 	//RESV_DETOUR_MAPPING
-	if (strcmp(pkt->lblHdr.msgType, "RESV_DETOUR_MAPPING")==0) {
+	if (pkt->lblHdr.msgType==MSG_RESV_DETOUR_MAPPING) {
 		if (nodeProcessResvDetourMapping(pkt)==1)
 			return 1; //retorne sucesso para processamento RESV_DETOUR_MAPPING
 		else
@@ -499,7 +512,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 	
 	//PATH_ERR
-	if (strcmp(pkt->lblHdr.msgType, "PATH_ERR")==0) {
+	if (pkt->lblHdr.msgType==MSG_PATH_ERR) {
 		if (nodeProcessPathErr(pkt)==1) //verifique se o processamento da PATH foi bem sucedido
 			return 1; //PATH foi processada de forma bem sucedida; reporte isso para a funo chamante
 		else
@@ -507,7 +520,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 
 	//RESV_ERR
-	if (strcmp(pkt->lblHdr.msgType, "RESV_ERR")==0) {
+	if (pkt->lblHdr.msgType==MSG_RESV_ERR) {
 		if (nodeProcessResvErr(pkt)==1) //verifique se o processamento da RESV foi bem sucedido
 			return 1; //PATH foi processada de forma bem sucedida; reporte isso para a funo chamante
 		else
@@ -515,7 +528,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 	
 	//PATH_LABEL_REQUEST_PREEMPT
-	if (strcmp(pkt->lblHdr.msgType, "PATH_LABEL_REQUEST_PREEMPT")==0) {
+	if (pkt->lblHdr.msgType==MSG_PATH_LABEL_REQUEST_PREEMPT) {
 		if (nodeProcessPathPreempt(pkt)==1) //verifique se o processamento da PATH foi bem sucedido
 			return 1; //PATH foi processada de forma bem sucedida; reporte isso para a funo chamante
 		else
@@ -523,7 +536,7 @@ static int nodeReceiveCtrlMsg(struct Packet *pkt) {
 	}
 
 	//RESV_LABEL_MAPPING_PREEMPT
-	if (strcmp(pkt->lblHdr.msgType, "RESV_LABEL_MAPPING_PREEMPT")==0) {
+	if (pkt->lblHdr.msgType==MSG_RESV_LABEL_MAPPING_PREEMPT) {
 		if (nodeProcessResvPreempt(pkt)==1)
 			return 1; //retorne sucesso para processamento RESV_LABEL_MAPPING_PREEMPT
 		else
@@ -654,6 +667,98 @@ double getNodeLSPTimeout(int n_node) {
 	return tarvosModel.node[n_node].LSPtimeout;
 }
 
+/* ZERA AS ESTATSTICAS DO NODO
+*
+*  Zera os contadores e acumuladores estatsticos do nodo (globais e de aplicao), como na criao do nodo, a fim de eliminar o transitrio
+*  (ver statReset).  Os demais campos (rtulos, timeouts, fila de mensagens de controle, srie de mdias de lotes) no so alterados.
+*/
+void nodeResetStats(int n_node) {
+	struct Node *node=&tarvosModel.node[n_node];
+
+	node->packetsReceived=node->packetsForwarded=node->packetsDropped=0;
+	node->bytesReceived=node->bytesForwarded=0;
+	node->delay=node->meanDelay=0;
+	node->jitter=node->meanJitter=0;
+	memset(&node->delaySum, 0, sizeof node->delaySum);
+	memset(&node->delayMom, 0, sizeof node->delayMom);
+	memset(&node->jitterSum, 0, sizeof node->jitterSum);
+	memset(&node->jitterMom, 0, sizeof node->jitterMom);
+	node->packetsReceivedAppl=node->packetsForwardedAppl=0;
+	node->bytesReceivedAppl=node->bytesForwardedAppl=0;
+	node->delayAppl=node->meanDelayAppl=0;
+	node->jitterAppl=node->meanJitterAppl=0;
+	memset(&node->delaySumAppl, 0, sizeof node->delaySumAppl);
+	memset(&node->delayMomAppl, 0, sizeof node->delayMomAppl);
+	memset(&node->jitterSumAppl, 0, sizeof node->jitterSumAppl);
+	memset(&node->jitterMomAppl, 0, sizeof node->jitterMomAppl);
+}
+
+/* ASSOCIA UMA SRIE DE MDIAS DE LOTES AO ATRASO DO NODO
+*
+*  A srie s (criada com bmStream) passa a receber o atraso de cada pacote recebido pelo nodo, em nodeUpdateStats.  s = 0 desfaz a associao.
+*/
+void setNodeDelayBatchMeans(int n_node, int s) {
+	tarvosModel.node[n_node].bmDelay=s;
+}
+
+/* CRIA OS HISTOGRAMAS DE ATRASO E JITTER DO NODO
+*
+*  Cria 4 histogramas log-lineares (simm_stat) para o nodo:  atraso e jitter de todos os pacotes recebidos, e atraso e jitter dos pacotes de aplicao.
+*  nodeUpdateStats os alimenta a cada pacote (o jitter em valor absoluto), e report() apresenta p50, p90, p99, p99.9 e mximo de cada um, sem que seja
+*  preciso gravar o atraso de cada pacote em disco (jitterDelayTrace) para obter os quantis.  Chamadas repetidas para o mesmo nodo no criam novos histogramas.
+*/
+void setNodeHistograms(int n_node) {
+	char name[30];
+
+	if (tarvosModel.node[n_node].hist!=0)
+		return;
+	sprintf(name, "delay node%02d", n_node);
+	tarvosModel.node[n_node].hist=histCreate(name);
+	sprintf(name, "jitter node%02d", n_node);
+	histCreate(name);
+	sprintf(name, "Appldelay node%02d", n_node);
+	histCreate(name);
+	sprintf(name, "Appljitter node%02d", n_node);
+	histCreate(name);
+}
+
+/* RECUPERA O QUANTIL q DO ATRASO DOS PACOTES RECEBIDOS PELO NODO
+*
+*  Retorna o quantil q (por exemplo, 0.99) do atraso dos pacotes recebidos pelo nodo, estimado pelo histograma do nodo (ver setNodeHistograms); 0 se o nodo
+*  no tem histogramas.
+*/
+double getNodeDelayQuantile(int n_node, double q) {
+	if (tarvosModel.node[n_node].hist==0)
+		return 0;
+	return histQuantile(tarvosModel.node[n_node].hist, q);
+}
+
+/* RECUPERA O ATRASO MDIO DOS PACOTES RECEBIDOS PELO NODO
+*
+*  Retorna o atraso mdio (meanDelay) medido para os pacotes recebidos por este nodo.  Tem a forma double f(int) para poder ser registrada
+*  como mtrica de sada das replicaes (ver replMetric).
+*/
+double getNodeMeanDelay(int n_node) {
+	return tarvosModel.node[n_node].meanDelay;
+}
+
+/* RECUPERA O DESVIO PADRO DO ATRASO DOS PACOTES RECEBIDOS PELO NODO
+*
+*  Retorna o desvio padro amostral do atraso dos pacotes recebidos pelo nodo, calculado em passo nico (momAdd) sem necessidade de gravar o atraso
+*  de cada pacote em disco; 0 se o nodo recebeu menos de 2 pacotes.  Tem a forma double f(int), como getNodeMeanDelay.
+*/
+double getNodeDelayStdDev(int n_node) {
+	return sqrt(momVar(&tarvosModel.node[n_node].delayMom));
+}
+
+/* RECUPERA O DESVIO PADRO DO JITTER DOS PACOTES RECEBIDOS PELO NODO
+*
+*  Como getNodeDelayStdDev, para o jitter (com sinal) calculado a partir do segundo pacote recebido pelo nodo.
+*/
+double getNodeJitterStdDev(int n_node) {
+	return sqrt(momVar(&tarvosModel.node[n_node].jitterMom));
+}
+
 /* PROCESSA MENSAGEM DE CONTROLE DO TIPO PATH_LABEL_REQUEST
 *
 *  A mensagem PATH_LABEL_REQUEST pede mapeamento de rtulo e faz pr-reserva de recursos para um LSP Tunnel.
@@ -748,7 +853,6 @@ static int nodeProcessResvLabelMapping(struct Packet *pkt) {
 	int iLabel;
 	double timeout; //para clculo do tempo absoluto de timeout de uma LSP
 	struct nodeMsgQueue *msg;
-	char mainTraceString[255];
 	
 	/*Caso 1:  recebido no LSR genrico; fazer o mapeamento de rtulo, inserir dados na LIB e LSP Table; rtulo inicial deve ser recuperado
 	atravs de funo especfica.*/
@@ -759,8 +863,7 @@ static int nodeProcessResvLabelMapping(struct Packet *pkt) {
 		timeout=simtime()+getNodeLSPTimeout(pkt->currentNode);  //calcular tempo absoluto de expirao da LSP a ser criada agora
 		insertInLIB(pkt->currentNode, msg->iIface, iLabel, msg->oIface, pkt->lblHdr.label, msg->LSPid, "up", 0, timeout, 0); //coloca zero no timeoutStamp, zero para marcar o campo Backup
 		
-		sprintf(mainTraceString, "LSP (working) successfully created.  LSPid:  %d  iLabel:  %d oLabel: %d at node %d\n", msg->LSPid, iLabel, pkt->lblHdr.label, pkt->currentNode);
-		mainTrace(mainTraceString);
+		tracePoint(TRACE_MAIN, 1, TREV_LSP_WORKING, pkt->currentNode, msg->LSPid, pkt->id, pkt->lblHdr.msgType, msg->LSPid, iLabel, pkt->lblHdr.label, pkt->currentNode);
 		
 		pkt->lblHdr.label=iLabel; //coloca o rtulo agora criado na mensagem, para que o prximo LSR use como mapeamento oLabel; a mesma mensagem RESV seguir adiante
 		removeFromNodeMsgQueueAck(pkt->currentNode, pkt->lblHdr.msgIDack);
@@ -853,7 +956,6 @@ static int nodeProcessResvRefreshNoMerge(struct Packet *pkt) {
 	double timeout; //para clculo do tempo absoluto de timeout de uma LSP
 	struct nodeMsgQueue *msg;
 	struct LIBEntry *p;
-	char mainTraceString[255];
 	
 	/*Caso 1:  recebido no LSR genrico; renove os recursos reservados para o pedao de LSP que compete a este nodo (como origem) e encaminhe
 	a mensagem  frente.  A renovao  basicamente o reclculo do timeout na tabela LIB.*/
@@ -866,8 +968,7 @@ static int nodeProcessResvRefreshNoMerge(struct Packet *pkt) {
 		if (p!=NULL) { //se p==NULL, entrada na LIB no foi encontrada; nada a renovar
 			timeout=simtime()+getNodeLSPTimeout(pkt->currentNode);  //calcular tempo absoluto de expirao da LSP a ser renovada agora
 			p->timeout = timeout; //coloque (atualize) o novo timeout da LSP no campo apropriado
-			sprintf(mainTraceString, "Resources for LSP successfully refreshed.  LSPid:  %d  at node %d\n", msg->LSPid, pkt->currentNode);
-			mainTrace(mainTraceString);
+			tracePoint(TRACE_MAIN, 1, TREV_RESV_REFRESH, pkt->currentNode, msg->LSPid, pkt->id, pkt->lblHdr.msgType, msg->LSPid, pkt->currentNode);
 			removeFromNodeMsgQueueAck(pkt->currentNode, pkt->lblHdr.msgIDack);
 			//recursos foram renovados neste nodo
 
@@ -954,7 +1055,6 @@ static int nodeProcessResvRefresh(struct Packet *pkt) {
 	double timeout; //para clculo do tempo absoluto de timeout de uma LSP
 	struct nodeMsgQueue *msg;
 	struct LIBEntry *p;
-	char mainTraceString[255];
 	
 	/*Caso 1:  recebido no LSR genrico; renove os recursos reservados para o pedao de LSP que compete a este nodo (como origem) e encaminhe
 	a mensagem  frente.  A renovao  basicamente o reclculo do timeout na tabela LIB.*/
@@ -967,8 +1067,7 @@ static int nodeProcessResvRefresh(struct Packet *pkt) {
 		if (p!=NULL) { //se p==NULL, entrada na LIB no foi encontrada; nada a renovar
 			timeout=simtime()+getNodeLSPTimeout(pkt->currentNode);  //calcular tempo absoluto de expirao da LSP a ser renovada agora
 			p->timeout = timeout; //coloque (atualize) o novo timeout da LSP no campo apropriado
-			sprintf(mainTraceString, "Resources for LSP successfully refreshed.  LSPid:  %d  at node %d\n", msg->LSPid, pkt->currentNode);
-			mainTrace(mainTraceString);
+			tracePoint(TRACE_MAIN, 1, TREV_RESV_REFRESH, pkt->currentNode, msg->LSPid, pkt->id, pkt->lblHdr.msgType, msg->LSPid, pkt->currentNode);
 			removeFromNodeMsgQueueAck(pkt->currentNode, pkt->lblHdr.msgIDack);
 			//recursos foram renovados neste nodo
 
@@ -1041,7 +1140,6 @@ static int nodeProcessHello(struct Packet *pkt) {
 static int nodeProcessHelloAck(struct Packet *pkt) {
 	double helloTimeLimit; //para clculo do tempo absoluto de helloTimeLimit (para considerar nodo alcanvel)
 	struct nodeMsgQueue *msg;
-	char mainTraceString[255];
 	
 	//procure a mensagem HELLO correspondente na fila do nodo, pelo msgIDack
 	msg=searchInNodeMsgQueueAck(pkt->currentNode, pkt->lblHdr.msgIDack);
@@ -1051,8 +1149,7 @@ static int nodeProcessHelloAck(struct Packet *pkt) {
 		if (pkt->currentNode == pkt->dst) {
 			helloTimeLimit=simtime()+getNodeHelloTimeout(pkt->currentNode);  //calcular tempo absoluto de expirao de uma conexo vlida entre dois nodos
 			(*(tarvosModel.node[pkt->currentNode].helloTimeLimit))[findLink(msg->src, msg->dst)] = helloTimeLimit; //coloque (atualize) o novo timeout da conexo entre os nodos src e dst
-			sprintf(mainTraceString, "Node found reachable by HELLO.  src:  %d  dst:  %d  at node %d.  Next timeout:  %f\n", msg->src, msg->dst, pkt->currentNode, helloTimeLimit);
-			mainTrace(mainTraceString);
+			tracePoint(TRACE_MAIN, 1, TREV_HELLO_REACHABLE, pkt->currentNode, 0, pkt->id, pkt->lblHdr.msgType, msg->src, msg->dst, pkt->currentNode, helloTimeLimit);
 			free(pkt->er.explicitRoute);  //elimine rota explcita, criada temporariamente juntamente com a HELLO_ACK
 			pkt->er.explicitRoute = NULL; //evita erro de execuo em uma nova eliminao desta rota explcita em outra funo
 		}
@@ -1183,7 +1280,6 @@ static int nodeProcessResvDetourMapping(struct Packet *pkt) {
 	int iLabel;
 	double timeout; //para clculo do tempo absoluto de timeout de uma LSP
 	struct nodeMsgQueue *msg;
-	char mainTraceString[255];
 	
 	/*Caso 1:  recebido no LSR genrico; fazer o mapeamento de rtulo, inserir dados na LIB e LSP Table; rtulo inicial deve ser recuperado
 	atravs de funo especfica.*/
@@ -1194,8 +1290,7 @@ static int nodeProcessResvDetourMapping(struct Packet *pkt) {
 		timeout=simtime()+getNodeLSPTimeout(pkt->currentNode);  //calcular tempo absoluto de expirao da LSP a ser criada agora
 		insertInLIB(pkt->currentNode, msg->iIface, iLabel, msg->oIface, pkt->lblHdr.label, msg->LSPid, "up", 1, timeout, 0); //coloca zero no timeoutStamp, 1 para marcar o campo Backup
 		
-		sprintf(mainTraceString, "LSP (backup) successfully created.  LSPid:  %d  iLabel:  %d oLabel: %d at node %d\n", msg->LSPid, iLabel, pkt->lblHdr.label, pkt->currentNode);
-		mainTrace(mainTraceString);
+		tracePoint(TRACE_MAIN, 1, TREV_LSP_BACKUP, pkt->currentNode, msg->LSPid, pkt->id, pkt->lblHdr.msgType, msg->LSPid, iLabel, pkt->lblHdr.label, pkt->currentNode);
 		
 		pkt->lblHdr.label=iLabel; //coloca o rtulo agora criado na mensagem, para que o prximo LSR use como mapeamento oLabel; a mesma mensagem RESV seguir adiante
 		removeFromNodeMsgQueueAck(pkt->currentNode, pkt->lblHdr.msgIDack);
@@ -1406,7 +1501,6 @@ static int nodeProcessResvPreempt(struct Packet *pkt) {
 	int iLabel;
 	double timeout; //para clculo do tempo absoluto de timeout de uma LSP
 	struct nodeMsgQueue *msg;
-	char mainTraceString[255];
 	
 	/*Caso 1:  recebido no LSR genrico; fazer o mapeamento de rtulo, inserir dados na LIB e LSP Table; rtulo inicial deve ser recuperado
 	atravs de funo especfica.  Fazer preempo se necessrio.*/
@@ -1422,8 +1516,7 @@ static int nodeProcessResvPreempt(struct Packet *pkt) {
 		timeout=simtime()+getNodeLSPTimeout(pkt->currentNode);  //calcular tempo absoluto de expirao da LSP a ser criada agora
 		insertInLIB(pkt->currentNode, msg->iIface, iLabel, msg->oIface, pkt->lblHdr.label, msg->LSPid, "up", 0, timeout, 0); //coloca zero no timeoutStamp, zero para marcar o campo Backup
 		
-		sprintf(mainTraceString, "LSP (working) successfully created.  LSPid:  %d  iLabel:  %d oLabel: %d at node %d\n", msg->LSPid, iLabel, pkt->lblHdr.label, pkt->currentNode);
-		mainTrace(mainTraceString);
+		tracePoint(TRACE_MAIN, 1, TREV_LSP_WORKING, pkt->currentNode, msg->LSPid, pkt->id, pkt->lblHdr.msgType, msg->LSPid, iLabel, pkt->lblHdr.label, pkt->currentNode);
 		
 		pkt->lblHdr.label=iLabel; //coloca o rtulo agora criado na mensagem, para que o prximo LSR use como mapeamento oLabel; a mesma mensagem RESV seguir adiante
 		removeFromNodeMsgQueueAck(pkt->currentNode, pkt->lblHdr.msgIDack);
@@ -25,21 +25,40 @@
 #include "tarvos_globals.h"
 
 /* CRIAO DO PACOTE E ALOCAO DE REA DE MEMRIA
-* Aloca espaco para a estrutura de um novo pacote e retorna o apontador para esta area
+* Obtm um pacote do pool de pacotes do contexto de simulao corrente e retorna o apontador para ele.  Os pacotes liberados por freePkt
+* ficam na lista de livres e so reaproveitados antes de se alocar um novo bloco de PKT_CHUNK pacotes.  Um pacote reaproveitado mantm o
+* seu objeto RecordRoute (de capacidade fixa, igual ao nmero de nodos; ver recordRoute), que  esvaziado aqui (rrNextIndex=0).
 */
 struct Packet *createPacket() {
+	struct TarvosContext *tc=tarvosContext();
+	struct PacketChunk *chunk;
 	struct Packet *pkt;
-	static int packetNumber = 0;  /*Inicializando o numero de pacotes serial (packetNumber  varivel global). O modelo TARVOS foi construdo
-								baseado na assuno de que este nmero  NICO e nunca se repete; se assim no o for, resultados inesperados
-								podem acontecer.*/
+	int *rr;
 
-	pkt = (Packet*)malloc(sizeof *pkt);
-	if (pkt == NULL) {
-		printf("\nError - createPacket - insufficient memory to allocate for new packet");
-		exit(1);
+	if (tc->tc_pktFree != NULL) { //reaproveita um pacote liberado
+		pkt = tc->tc_pktFree;
+		tc->tc_pktFree = pkt->next;
+		tc->tc_pktRecycled++;
+	} else {
+		if (tc->tc_pktChunks == NULL || tc->tc_pktUsed == PKT_CHUNK) { //bloco corrente esgotado:  aloca novo bloco
+			chunk = (struct PacketChunk*)calloc(1, sizeof *chunk); //calloc:  os pacotes ainda no usados tm recordRoute NULL (ver pktPoolFree)
+			if (chunk == NULL) {
+				printf("\nError - createPacket - insufficient memory to allocate for new packet");
+				exit(1);
+			}
+			chunk->next = tc->tc_pktChunks;
+			tc->tc_pktChunks = chunk;
+			tc->tc_pktUsed = 0;
+		}
+		pkt = &tc->tc_pktChunks->pkts[tc->tc_pktUsed++];
 	}
-	packetNumber++;  //Atualiza a variavel global que tem o numero de serie dos pacotes. Esta atualizacao so ocorre nesta subrotina; o primeiro packetNumber  1
-	pkt->id = packetNumber; //identifica o pacote, este identificador que sera o tkn de toda a simulao
+	if (++tc->tc_pktLive > tc->tc_pktPeak)
+		tc->tc_pktPeak = tc->tc_pktLive;
+	rr = pkt->er.recordRoute;
+	/* O numero de serie dos pacotes fica no contexto de simulao (tarvosContext). O modelo TARVOS foi construdo baseado na assuno de
+	*  que este nmero  NICO e nunca se repete; se assim no o for, resultados inesperados podem acontecer. Esta atualizacao so ocorre
+	*  nesta subrotina; o primeiro packetNumber  1 */
+	pkt->id = ++tc->tc_packetNumber; //identifica o pacote, este identificador que sera o tkn de toda a simulao
 	pkt->ttl=tarvosParam.ttl; //define o TTL inicial (default) coletado na estrutura de parmetros (sugesto:  se necessrio outro, modificar no gerador de trfego)
 
 	//Inicializa campos do Packet com valores nulos para evitar aleatoriedades.  As funes de manipulao dos Packets
@@ -47,7 +66,7 @@ struct Packet *createPacket() {
 	pkt->currentNode=0;
 	pkt->er.erNextIndex=0;
 	pkt->er.explicitRoute=NULL; //rota explcita a ser seguida pelo pacote
-	pkt->er.recordRoute=NULL; //rota explcita seguida pelo pacote e gravada, nodo por nodo
+	pkt->er.recordRoute=rr; //rota explcita seguida pelo pacote e gravada, nodo por nodo (NULL at o primeiro recordRoute do pacote do pool)
 	pkt->er.rrNextIndex=0;
 	pkt->er.recordThisRoute=0; //flag indicativa se a rota deve ser gravada no objeto recordRoute
 	pkt->generationTime=0;
@@ -56,9 +75,9 @@ struct Packet *createPacket() {
 	pkt->lblHdr.LSPid=0;
 	pkt->lblHdr.msgID=0; //msgID=0 significa que o pacote no contm mensagem de controle
 	pkt->lblHdr.priority=0; //prioridade default ZERO, a menor possvel
-	strcpy(pkt->lblHdr.msgType, "");
-	strcpy(pkt->lblHdr.errorCode, "");
-	strcpy(pkt->lblHdr.errorValue, "");
+	pkt->lblHdr.msgType=MSG_NONE;
+	pkt->lblHdr.errorCode=ERRC_NONE;
+	pkt->lblHdr.errorValue=ERRV_NONE;
 
 	pkt->length=0;
 	pkt->next=NULL;
@@ -69,16 +88,69 @@ struct Packet *createPacket() {
 	return (pkt);
 }
 
+/* NOME DO TIPO DE MENSAGEM DE CONTROLE
+*
+*  Retorna o nome do tipo de mensagem msgType (enum MsgType), usado nos traces; a tabela segue a ordem da enumerao.
+*/
+const char *getMsgTypeName(int msgType) {
+	static const char *names[MSG_TYPES]={"", "PATH_LABEL_REQUEST", "RESV_LABEL_MAPPING", "PATH_REFRESH", "RESV_REFRESH", "HELLO", "HELLO_ACK",
+		"PATH_DETOUR", "RESV_DETOUR_MAPPING", "PATH_ERR", "RESV_ERR", "PATH_LABEL_REQUEST_PREEMPT", "RESV_LABEL_MAPPING_PREEMPT"};
+
+	if (msgType<0 || msgType>=MSG_TYPES) {
+		printf("\nError - getMsgTypeName - invalid control message type");
+		exit(1);
+	}
+	return names[msgType];
+}
+
 /* REMOVE PACOTE DA MEMRIA
 *
-*  Aps o pacote ter descartado ou ter chegado a seu destino,  preciso elimin-lo da memria com uma instruo free.
-*  Esta rotina recebe o ponteiro do pacote e faz a remoo.
+*  Aps o pacote ter descartado ou ter chegado a seu destino,  preciso devolv-lo ao pool de pacotes.
+*  Esta rotina recebe o ponteiro do pacote e faz a remoo; o objeto RecordRoute fica com o pacote, para reaproveitamento.  Tambm  chamada pelo
+*  kernel para os pacotes descartados da fila de um link que entra em estado down (setFacDown; ver tarvosContext).
 */
 void freePkt(struct Packet *pkt) {
-	free(pkt->er.recordRoute); //descarta a rota gravada (mesmo que no tenha sido, caso em que recordRoute ser NULL)
+	struct TarvosContext *tc=tarvosContext();
+
 	if (pkt->lblHdr.msgID !=0 ) //se msgID == 0, ento no  pacote de controle (pacotes de dados contm rota explcita const)
 		 //s elimine a rota explcita se a mensagem no for PATH_LABEL_REQUEST ou PATH_DETOUR ou PATH_LABEL_REQUEST_PREEMPT, pois estas recebem uma rota explcita const
-		 if (strcmp(pkt->lblHdr.msgType, "PATH_LABEL_REQUEST")!=0 && strcmp(pkt->lblHdr.msgType, "PATH_DETOUR")!=0 && strcmp(pkt->lblHdr.msgType, "PATH_LABEL_REQUEST_PREEMPT")!=0)
+		 if (pkt->lblHdr.msgType!=MSG_PATH_LABEL_REQUEST && pkt->lblHdr.msgType!=MSG_PATH_DETOUR && pkt->lblHdr.msgType!=MSG_PATH_LABEL_REQUEST_PREEMPT)
 			free(pkt->er.explicitRoute); //descarta a rota explcita (s pode ser feito se a rota explcita for dinmica, caso contrrio haver um erro de execuo!)
-	free(pkt); //descarta o pacote da memria
+	pkt->next=tc->tc_pktFree; //devolve o pacote  lista de livres
+	tc->tc_pktFree=pkt;
+	tc->tc_pktLive--;
+}
+
+/* LIBERA O POOL DE PACOTES
+*
+*  Libera todos os blocos do pool de pacotes de tc, com os objetos RecordRoute dos pacotes, livres ou ainda em uso.  Chamada quando o contexto de
+*  simulao  destrudo (simmContextDestroy); depois dela, nenhum pacote do contexto pode ser usado.
+*/
+void pktPoolFree(struct TarvosContext *tc) {
+	struct PacketChunk *chunk;
+	int i;
+
+	while ((chunk = tc->tc_pktChunks) != NULL) {
+		tc->tc_pktChunks = chunk->next;
+		for (i=0; i<PKT_CHUNK; i++)
+			free(chunk->pkts[i].er.recordRoute);
+		free(chunk);
+	}
+	tc->tc_pktFree=NULL;
+	tc->tc_pktUsed=0;
+}
+
+/* Retorna o nmero de pacotes em uso (criados por createPacket e ainda no liberados por freePkt) */
+int getPktPoolLive() {
+	return tarvosContext()->tc_pktLive;
+}
+
+/* Retorna o maior nmero de pacotes em uso simultaneamente */
+int getPktPoolPeak() {
+	return tarvosContext()->tc_pktPeak;
+}
+
+/* Retorna o nmero de pacotes entregues por createPacket a partir de pacotes reaproveitados */
+long long getPktPoolRecycled() {
+	return tarvosContext()->tc_pktRecycled;
 }
\ No newline at end of file
@@ -39,9 +39,7 @@ static struct LspList *initLspList();
 static struct LspListItem *searchInLspList(struct LspList *lspList, int holdPrio);
 static void insertInLspList(struct LspList *lspList, int LSPid, int setPrio, int holdPrio, struct LIBEntry *libEntry);
 
-//Variveis locais (static)
-static struct LIB lib ={0}; //defina uma varavel tipo estrutura LIB para uso exclusivo deste mdulo e inicialize tudo com NULL ou zeros
-static struct LSPTable lspTable ={0}; //defina uma varavel tipo estrutura LSPTable para uso exclusivo deste mdulo
+//A LIB e a LSP Table, de uso exclusivo deste mdulo, ficam no contexto de simulao corrente (tc_lib e tc_lspTable, inicializadas com NULL ou zeros)
 
 /* LEITOR DO ARQUIVO LIB.TXT, PARA CRIAO DA TABELA DE ROTEAMENTO (LIB) MPLS
 *
@@ -141,15 +139,17 @@ void buildLIBTableFromFile(char *libFile) {
 *  A LIB Table  uma lista dinmica duplamente encadeada, circular, com um Head Node.
 */
 void buildLIBTable() {
-	if (lib.head==NULL) { //evita duplicidade na criao da LIB
-		lib.head = (LIBEntry*)malloc(sizeof *(lib.head)); //cria HEAD NODE
-		if (lib.head==NULL) {
+	struct TarvosContext *tc=tarvosContext();
+
+	if (tc->tc_lib.head==NULL) { //evita duplicidade na criao da LIB
+		tc->tc_lib.head = (LIBEntry*)malloc(sizeof *(tc->tc_lib.head)); //cria HEAD NODE
+		if (tc->tc_lib.head==NULL) {
 			printf("\nError - buildLIBTable - insufficient memory to allocate for LIB");
 			exit(1);
 		}
-		lib.head->previous=lib.head;
-		lib.head->next=lib.head; //perfaz a caracterstica circular da lista
-		lib.size = 0; //lista est vazia
+		tc->tc_lib.head->previous=tc->tc_lib.head;
+		tc->tc_lib.head->next=tc->tc_lib.head; //perfaz a caracterstica circular da lista
+		tc->tc_lib.size = 0; //lista est vazia
 		buildLSPTable();  //cria tambm a estrutura inicial da LSP ID Table
 	}
 }
@@ -160,29 +160,31 @@ void buildLIBTable() {
 *  Passar todo o contedo de uma linha da LIB como parmetros
 */
 void insertInLIB(int node, int iIface, int iLabel, int oIface, int oLabel, int LSPid, char *status, int bak, double timeout, double timeoutStamp) {
-	if (lib.head==NULL) //se LIB no existir ainda, nada faa
+	struct TarvosContext *tc=tarvosContext();
+
+	if (tc->tc_lib.head==NULL) //se LIB no existir ainda, nada faa
 		return;
 	
-	lib.head->previous->next=(LIBEntry*)malloc(sizeof *(lib.head->previous->next)); //cria mais um n ao final da lista; este n  lib.head->previous->next (lista duplamente encadeada circular)
-	if (lib.head->previous->next==NULL) {
+	tc->tc_lib.head->previous->next=(LIBEntry*)malloc(sizeof *(tc->tc_lib.head->previous->next)); //cria mais um n ao final da lista; este n  lib.head->previous->next (lista duplamente encadeada circular)
+	if (tc->tc_lib.head->previous->next==NULL) {
 		printf("\nError - insertInLIB - insufficient memory to allocate for LIB");
 		exit(1);
 	}
-	lib.head->previous->next->previous=lib.head->previous; //atualiza ponteiro previous do novo n da lista
-	lib.head->previous->next->next=lib.head; //atualiza ponteiro next do novo n da lista
-	lib.head->previous=lib.head->previous->next; //atualiza ponteiro previous do Head Node
-	lib.head->previous->previous->next=lib.head->previous; //atualiza ponteiro next do penltimo n
-	lib.head->previous->node = node;
-	lib.head->previous->iIface = iIface;
-	lib.head->previous->iLabel = iLabel;
-	lib.head->previous->oIface = oIface;
-	lib.head->previous->oLabel = oLabel;
-	lib.head->previous->LSPid = LSPid;
-	strcpy(lib.head->previous->status, status);
-	lib.head->previous->bak = bak;
-	lib.head->previous->timeout = timeout;
-	lib.head->previous->timeoutStamp = timeoutStamp;
-	lib.size++;
+	tc->tc_lib.head->previous->next->previous=tc->tc_lib.head->previous; //atualiza ponteiro previous do novo n da lista
+	tc->tc_lib.head->previous->next->next=tc->tc_lib.head; //atualiza ponteiro next do novo n da lista
+	tc->tc_lib.head->previous=tc->tc_lib.head->previous->next; //atualiza ponteiro previous do Head Node
+	tc->tc_lib.head->previous->previous->next=tc->tc_lib.head->previous; //atualiza ponteiro next do penltimo n
+	tc->tc_lib.head->previous->node = node;
+	tc->tc_lib.head->previous->iIface = iIface;
+	tc->tc_lib.head->previous->iLabel = iLabel;
+	tc->tc_lib.head->previous->oIface = oIface;
+	tc->tc_lib.head->previous->oLabel = oLabel;
+	tc->tc_lib.head->previous->LSPid = LSPid;
+	strcpy(tc->tc_lib.head->previous->status, status);
+	tc->tc_lib.head->previous->bak = bak;
+	tc->tc_lib.head->previous->timeout = timeout;
+	tc->tc_lib.head->previous->timeoutStamp = timeoutStamp;
+	tc->tc_lib.size++;
 
 	//if (searchInLSPTable(LSPid)==NULL)
 	//			insertInLSPTable(LSPid); /*insere tambm dados pertinentes na LSP Table, se no foram ainda inseridos
@@ -196,11 +198,12 @@ void insertInLIB(int node, int iIface, int iLabel, int oIface, int oLabel, int L
 * imprime contedo da Label Information Base no arquivo recebido como parmetro
 */
 void dumpLIB(char *outfile) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LIBEntry *p;
 	FILE *fp;
 	
 	fp=fopen(outfile, "w");
-	if (lib.head==NULL) { //se LIB no existir ainda, nada faa
+	if (tc->tc_lib.head==NULL) { //se LIB no existir ainda, nada faa
 		fprintf(fp, "LIB does not exist.");
 		return;
 	}
@@ -208,8 +211,8 @@ void dumpLIB(char *outfile) {
 	fprintf(fp, "Label Information Base - Contents - Tarvos Simulator\n\n");
 	fprintf(fp, "Itens na LIB:  %d\n\n", getLIBSize());
 	fprintf(fp, "Node iIface iLabel oIface  oLabel LSPid IsBackup               Status        Timeout   timeoutStamp\n");
-	p=lib.head->next; //aponta para a primeira clula da LIB
-	while(p!=lib.head) { //lista circular; o ltimo n atingido deve ser o Head Node
+	p=tc->tc_lib.head->next; //aponta para a primeira clula da LIB
+	while(p!=tc->tc_lib.head) { //lista circular; o ltimo n atingido deve ser o Head Node
 		fprintf(fp, "%3d   %3d     %4d    %3d    %4d   %3d    %3s   %20s   %12.4f   %12.4f\n", p->node, p->iIface, p->iLabel, p->oIface, p->oLabel, p->LSPid, 
 			(p->bak==0)? ("no"):("yes"), p->status, p->timeout, p->timeoutStamp);
 		p=p->next;
@@ -220,7 +223,9 @@ void dumpLIB(char *outfile) {
 /* RETORNA O TAMANHO DA LIB EM LINHAS (OU ITENS)
 */
 int getLIBSize() {
-	return(lib.size);
+	struct TarvosContext *tc=tarvosContext();
+
+	return(tc->tc_lib.size);
 }
 
 /* BUSCA NA LIB USANDO CHAVE NODE-iIFACE-iLABEL
@@ -233,21 +238,22 @@ int getLIBSize() {
 *  CUIDADO:  Esta funo desconsidera o status da LSP indicada pela LIB.  No se recomenda usar esta busca para fazer comutao por rtulo
 */
 struct LIBEntry *searchInLIB(int node, int iIface, int iLabel) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LIBEntry *p;
 	
-	if (lib.head==NULL) //se LIB no existir ainda, nada faa
+	if (tc->tc_lib.head==NULL) //se LIB no existir ainda, nada faa
 		return NULL;
 	
 	//insere a chave de busca no Head Node
-	lib.head->node=node;
-	lib.head->iIface=iIface;
-	lib.head->iLabel=iLabel;
+	tc->tc_lib.head->node=node;
+	tc->tc_lib.head->iIface=iIface;
+	tc->tc_lib.head->iLabel=iLabel;
 	
-	p=lib.head->previous; //aponta para a ltima clula da LIB
+	p=tc->tc_lib.head->previous; //aponta para a ltima clula da LIB
 	while(p->node!=node || p->iIface!=iIface || p->iLabel!=iLabel) {
 		p=p->previous;
 	} //fim do percurso
-	if (p==lib.head) //se for igual, a busca no encontrou nenhum item vlido
+	if (p==tc->tc_lib.head) //se for igual, a busca no encontrou nenhum item vlido
 		return NULL; //retorne NULL, significando nada encontrado
 	else
 		return p; //retorne o ponteiro para o item encontrado
@@ -263,22 +269,23 @@ struct LIBEntry *searchInLIB(int node, int iIface, int iLabel) {
 *  Esta  a busca indicada para fazer o chaveamento por rtulo.
 */
 struct LIBEntry *searchInLIBStatus(int node, int iIface, int iLabel, char *status) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LIBEntry *p;
 	
-	if (lib.head==NULL) //se LIB no existir ainda, nada faa
+	if (tc->tc_lib.head==NULL) //se LIB no existir ainda, nada faa
 		return NULL;
 	
 	//insere a chave de busca no Head Node
-	lib.head->node=node;
-	lib.head->iIface=iIface;
-	lib.head->iLabel=iLabel;
-	strcpy(lib.head->status, status);
+	tc->tc_lib.head->node=node;
+	tc->tc_lib.head->iIface=iIface;
+	tc->tc_lib.head->iLabel=iLabel;
+	strcpy(tc->tc_lib.head->status, status);
 	
-	p=lib.head->previous; //aponta para a ltima clula da LIB
+	p=tc->tc_lib.head->previous; //aponta para a ltima clula da LIB
 	while(p->node!=node || p->iIface!=iIface || p->iLabel!=iLabel || strcmp(p->status, status)!=0) {
 		p=p->previous;
 	} //fim do percurso
-	if (p==lib.head) //se for igual, a busca no encontrou nenhum item vlido
+	if (p==tc->tc_lib.head) //se for igual, a busca no encontrou nenhum item vlido
 		return NULL; //retorne NULL, significando nada encontrado
 	else
 		return p; //retorne o ponteiro para o item encontrado
@@ -294,22 +301,23 @@ struct LIBEntry *searchInLIBStatus(int node, int iIface, int iLabel, char *statu
 *  lista at o incio.
 */
 struct LIBEntry *searchInLIBnodLSPstat(int node, int LSPid, char *status) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LIBEntry *p;
 	
-	if (lib.head==NULL) //se LIB no existir ainda, nada faa
+	if (tc->tc_lib.head==NULL) //se LIB no existir ainda, nada faa
 		return NULL;
 	
 	//insere a chave de busca no Head Node
-	lib.head->node=node;
-	lib.head->LSPid=LSPid;
-	strcpy(lib.head->status, status);
-	lib.head->bak=0;
+	tc->tc_lib.head->node=node;
+	tc->tc_lib.head->LSPid=LSPid;
+	strcpy(tc->tc_lib.head->status, status);
+	tc->tc_lib.head->bak=0;
 	
-	p=lib.head->previous; //aponta para a ltima clula da LIB
+	p=tc->tc_lib.head->previous; //aponta para a ltima clula da LIB
 	while(p->node!=node || p->LSPid!=LSPid || (strcmp(p->status, status)!=0) || p->bak!=0) {
 		p=p->previous;
 	} //fim do percurso
-	if (p==lib.head) //se for igual, a busca no encontrou nenhum item vlido
+	if (p==tc->tc_lib.head) //se for igual, a busca no encontrou nenhum item vlido
 		return NULL; //retorne NULL, significando nada encontrado
 	else
 		return p; //retorne o ponteiro para o item encontrado
@@ -325,23 +333,24 @@ struct LIBEntry *searchInLIBnodLSPstat(int node, int LSPid, char *status) {
 *  lista at o incio.
 */
 struct LIBEntry *searchInLIBnodLSPstatBak(int node, int LSPid, char *status) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LIBEntry *p;
 	
-	if (lib.head==NULL) //se LIB no existir ainda, nada faa
+	if (tc->tc_lib.head==NULL) //se LIB no existir ainda, nada faa
 		return NULL;
 	
 	//insere a chave de busca no Head Node
-	lib.head->node=node;
-	lib.head->LSPid=LSPid;
-	strcpy(lib.head->status, status);
-	lib.head->bak=1; //indica uma backup LSP
-	lib.head->iIface=0; //iIface=0 indica que este MP  o incio da backup LSP
+	tc->tc_lib.head->node=node;
+	tc->tc_lib.head->LSPid=LSPid;
+	strcpy(tc->tc_lib.head->status, status);
+	tc->tc_lib.head->bak=1; //indica uma backup LSP
+	tc->tc_lib.head->iIface=0; //iIface=0 indica que este MP  o incio da backup LSP
 	
-	p=lib.head->previous; //aponta para a ltima clula da LIB
+	p=tc->tc_lib.head->previous; //aponta para a ltima clula da LIB
 	while(p->node!=node || p->LSPid!=LSPid || (strcmp(p->status, status)!=0) || p->iIface!=0 || p->bak!=1) {
 		p=p->previous;
 	} //fim do percurso
-	if (p==lib.head) //se for igual, a busca no encontrou nenhum item vlido
+	if (p==tc->tc_lib.head) //se for igual, a busca no encontrou nenhum item vlido
 		return NULL; //retorne NULL, significando nada encontrado
 	else
 		return p; //retorne o ponteiro para o item encontrado
@@ -356,23 +365,24 @@ struct LIBEntry *searchInLIBnodLSPstatBak(int node, int LSPid, char *status) {
 *  lista at o incio.
 */
 struct LIBEntry *searchInLIBnodLSPstatoIface(int node, int LSPid, char *status, int oIface) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LIBEntry *p;
 	
-	if (lib.head==NULL) //se LIB no existir ainda, nada faa
+	if (tc->tc_lib.head==NULL) //se LIB no existir ainda, nada faa
 		return NULL;
 	
 	//insere a chave de busca no Head Node
-	lib.head->node=node;
-	lib.head->LSPid=LSPid;
-	strcpy(lib.head->status, status);
-	lib.head->oIface=oIface;
-	lib.head->bak=0; //procura por working LSPs
+	tc->tc_lib.head->node=node;
+	tc->tc_lib.head->LSPid=LSPid;
+	strcpy(tc->tc_lib.head->status, status);
+	tc->tc_lib.head->oIface=oIface;
+	tc->tc_lib.head->bak=0; //procura por working LSPs
 	
-	p=lib.head->previous; //aponta para a ltima clula da LIB
+	p=tc->tc_lib.head->previous; //aponta para a ltima clula da LIB
 	while(p->node!=node || p->LSPid!=LSPid || (strcmp(p->status, status)!=0) || p->oIface!=oIface || p->bak!=0) {
 		p=p->previous;
 	} //fim do percurso
-	if (p==lib.head) //se for igual, a busca no encontrou nenhum item vlido
+	if (p==tc->tc_lib.head) //se for igual, a busca no encontrou nenhum item vlido
 		return NULL; //retorne NULL, significando nada encontrado
 	else
 		return p; //retorne o ponteiro para o item encontrado
@@ -389,20 +399,24 @@ struct LIBEntry *searchInLIBnodLSPstatoIface(int node, int LSPid, char *status,
 *  encadeada, circular.
 */
 static void buildLSPTable() {
-	lspTable.head = (LSPTableEntry*)malloc(sizeof*(lspTable.head)); //cria HEAD NODE
-	if (lspTable.head==NULL) {
+	struct TarvosContext *tc=tarvosContext();
+
+	tc->tc_lspTable.head = (LSPTableEntry*)malloc(sizeof*(tc->tc_lspTable.head)); //cria HEAD NODE
+	if (tc->tc_lspTable.head==NULL) {
 		printf("\nError - buildLSPTable - insufficient memory to allocate for LIB");
 		exit(1);
 	}
-	lspTable.head->previous=lspTable.head;
-	lspTable.head->next=lspTable.head; //perfaz a caracterstica circular da lista
-	lspTable.size = 0; //lista est vazia
+	tc->tc_lspTable.head->previous=tc->tc_lspTable.head;
+	tc->tc_lspTable.head->next=tc->tc_lspTable.head; //perfaz a caracterstica circular da lista
+	tc->tc_lspTable.size = 0; //lista est vazia
 }
 
 /* RETORNA O TAMANHO DA LSP TABLE EM LINHAS (OU ITENS)
 */
 int getLSPTableSize() {
-	return(lspTable.size);
+	struct TarvosContext *tc=tarvosContext();
+
+	return(tc->tc_lspTable.size);
 }
 
 /* INSERE NOVO ITEM NA LSP TABLE
@@ -411,32 +425,34 @@ int getLSPTableSize() {
 *  Passar todo o contedo de uma linha da LSP Table como parmetros
 */
 static void insertInLSPTable(int LSPid, int source, int dst, double cir, double cbs, double pir, int minPolUnit, int maxPktSize, int setPrio, int holdPrio) {
-	if (lspTable.head==NULL) //se LSP no existir ainda, nada faa
+	struct TarvosContext *tc=tarvosContext();
+
+	if (tc->tc_lspTable.head==NULL) //se LSP no existir ainda, nada faa
 		return;
 	
-	lspTable.head->previous->next=(LSPTableEntry*)malloc(sizeof *(lspTable.head->previous->next)); //cria mais um n ao final da lista; este n  lib.head->previous->next (lista duplamente encadeada circular)
-	if (lspTable.head->previous->next==NULL) {
+	tc->tc_lspTable.head->previous->next=(LSPTableEntry*)malloc(sizeof *(tc->tc_lspTable.head->previous->next)); //cria mais um n ao final da lista; este n  lib.head->previous->next (lista duplamente encadeada circular)
+	if (tc->tc_lspTable.head->previous->next==NULL) {
 		printf("\nError - insertInLSPTable - insufficient memory to allocate for LSP Table");
 		exit(1);
 	}
-	lspTable.head->previous->next->previous=lspTable.head->previous; //atualiza ponteiro previous do novo n da lista
-	lspTable.head->previous->next->next=lspTable.head; //atualiza ponteiro next do novo n da lista
-	lspTable.head->previous=lspTable.head->previous->next; //atualiza ponteiro previous do Head Node
-	lspTable.head->previous->previous->next=lspTable.head->previous; //atualiza ponteiro next do penltimo n
-	lspTable.head->previous->LSPid = LSPid;
-	lspTable.head->previous->src = source;
-	lspTable.head->previous->dst = dst;
-	lspTable.head->previous->arrivalTime = simtime();
-	lspTable.head->previous->cbs = cbs;
-	lspTable.head->previous->cBucket = 0; //Bucket comea vazio?
-	lspTable.head->previous->cir = cir;
-	lspTable.head->previous->maxPktSize = maxPktSize;
-	lspTable.head->previous->minPolUnit = minPolUnit;
-	lspTable.head->previous->pir = pir;
-	lspTable.head->previous->setPrio = setPrio;
-	lspTable.head->previous->holdPrio = holdPrio;
-	lspTable.head->previous->tunnelDone = 0;
-	lspTable.size++;
+	tc->tc_lspTable.head->previous->next->previous=tc->tc_lspTable.head->previous; //atualiza ponteiro previous do novo n da lista
+	tc->tc_lspTable.head->previous->next->next=tc->tc_lspTable.head; //atualiza ponteiro next do novo n da lista
+	tc->tc_lspTable.head->previous=tc->tc_lspTable.head->previous->next; //atualiza ponteiro previous do Head Node
+	tc->tc_lspTable.head->previous->previous->next=tc->tc_lspTable.head->previous; //atualiza ponteiro next do penltimo n
+	tc->tc_lspTable.head->previous->LSPid = LSPid;
+	tc->tc_lspTable.head->previous->src = source;
+	tc->tc_lspTable.head->previous->dst = dst;
+	tc->tc_lspTable.head->previous->arrivalTime = simtime();
+	tc->tc_lspTable.head->previous->cbs = cbs;
+	tc->tc_lspTable.head->previous->cBucket = 0; //Bucket comea vazio?
+	tc->tc_lspTable.head->previous->cir = cir;
+	tc->tc_lspTable.head->previous->maxPktSize = maxPktSize;
+	tc->tc_lspTable.head->previous->minPolUnit = minPolUnit;
+	tc->tc_lspTable.head->previous->pir = pir;
+	tc->tc_lspTable.head->previous->setPrio = setPrio;
+	tc->tc_lspTable.head->previous->holdPrio = holdPrio;
+	tc->tc_lspTable.head->previous->tunnelDone = 0;
+	tc->tc_lspTable.size++;
 }
 
 /* BUSCA NA LSP Table.  Retorna ponteiro para a clula com os parmetros pedidos ou NULL para no encontrado
@@ -446,19 +462,20 @@ static void insertInLSPTable(int LSPid, int source, int dst, double cir, double
 *  lista at o incio.
 */
 struct LSPTableEntry *searchInLSPTable(int LSPid) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LSPTableEntry *p;
 	
-	if (lspTable.head==NULL) //se LSP no existir ainda, nada faa
+	if (tc->tc_lspTable.head==NULL) //se LSP no existir ainda, nada faa
 		return NULL;
 	
 	//insere a chave de busca no Head Node
-	lspTable.head->LSPid=LSPid;
+	tc->tc_lspTable.head->LSPid=LSPid;
 	
-	p=lspTable.head->previous; //aponta para a ltima clula da LSP Table
+	p=tc->tc_lspTable.head->previous; //aponta para a ltima clula da LSP Table
 	while(p->LSPid!=LSPid) {
 		p=p->previous;
 	} //fim do percurso
-	if (p==lspTable.head) //se for igual, a busca no encontrou nenhum item vlido
+	if (p==tc->tc_lspTable.head) //se for igual, a busca no encontrou nenhum item vlido
 		return NULL; //retorne NULL, significando nada encontrado
 	else
 		return p; //retorne o ponteiro para o item encontrado
@@ -469,12 +486,13 @@ struct LSPTableEntry *searchInLSPTable(int LSPid) {
 * imprime contedo da Label Switched Path Table no arquivo recebido como parmetro
 */
 void dumpLSPTable(char *outfile) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LSPTableEntry *p;
 	FILE *fp;
 	
 	fp=fopen(outfile, "w");
 	
-	if (lspTable.head==NULL) { //se LIB no existir ainda, nada faa
+	if (tc->tc_lspTable.head==NULL) { //se LIB no existir ainda, nada faa
 		fprintf(fp, "LSP Table does not exist.");
 		return;
 	}
@@ -483,8 +501,8 @@ void dumpLSPTable(char *outfile) {
 	fprintf(fp, "Itens in LSP Table:  %d\n", getLSPTableSize());
 	fprintf(fp, "Current simtime:  %f\n\n", simtime());
 	fprintf(fp, "LSPid Src  Dst        CBS             CIR            PIR           cBucket  MinPolUnit  MaxPktSize   setPrio  HoldPrio  ArrivalTime  tunnelDone\n");
-	p=lspTable.head->next; //aponta para a primeira clula da LSP Table
-	while(p!=lspTable.head) { //lista circular; o ltimo n atingido deve ser o Head Node
+	p=tc->tc_lspTable.head->next; //aponta para a primeira clula da LSP Table
+	while(p!=tc->tc_lspTable.head) { //lista circular; o ltimo n atingido deve ser o Head Node
 		fprintf(fp, "%3d  %3d  %3d\t%10.1f\t%10.1f\t%10.1f\t%10.1f\t%5d\t  %5d\t\t%d\t%d\t %10.4f\t%s\n",
 			p->LSPid, p->src, p->dst, p->cbs, p->cir, p->pir, p->cBucket, p->minPolUnit, p->maxPktSize, p->setPrio, p->holdPrio, p->arrivalTime, (p->tunnelDone==0)? ("no"):("yes"));
 		p=p->next;
@@ -498,10 +516,7 @@ void dumpLSPTable(char *outfile) {
 *  um tnel LSP.
 */
 static int getNewLSPid() {
-	static int LSPid=0; //defina o LSPid inicial
-	
-	LSPid++; //cria novo LSPid
-	return LSPid;
+	return ++tarvosContext()->tc_LSPid; //cria novo LSPid; o LSPid inicial  zero
 }
 
 /* ESTABELECE (CRIA) UMA LSP ENTRE DOIS NODOS, COM OU SEM PREEMPO
@@ -602,22 +617,22 @@ struct Packet *setBackupLSP(int LSPid, int sourceMP, int dstMP, int er[]) {
 /* CRIA UMA MENSAGEM DE CONTROLE
 *
 *  Cria um pacote contendo a mensagem de controle.
-*  Esta funo deve receber via um ponteiro char o tipo de mensagem de controle a ser criada.
+*  Esta funo deve receber o tipo de mensagem de controle a ser criada (enum MsgType).
 *  A funo que chama deve cuidar de enviar a mensagem adiante.
 */
-static struct Packet *createControlMsg(int length, int source, int dst, char *msgType) {
+static struct Packet *createControlMsg(int length, int source, int dst, int msgType) {
 	struct Packet *pkt;
-	static int msgID = 0; /*inicializa msgID; o mdulo TARVOS foi concebido de modo que esta msgID no se repita ao longo
-						  da simulao e do domnio MPLS.*/
+	int msgID; /*o mdulo TARVOS foi concebido de modo que esta msgID no se repita ao longo
+			   da simulao e do domnio MPLS; o contador fica no contexto de simulao (tarvosContext).*/
 	
-	msgID++; //incrementa para uma nova mensagem de controle; o primeiro nmero vlido  1
+	msgID = ++tarvosContext()->tc_msgID; //incrementa para uma nova mensagem de controle; o primeiro nmero vlido  1
 	pkt = createPacket();
 	pkt->currentNode = source;
 	pkt->length = length;
 	pkt->src = source; //Nodo ao qual a fonte est vinculada, isto permite que vrias fontes gerem para o mesmo nodo (fontes com tipos de gerao diferentes)
 	pkt->dst = dst; //Nodo ao qual o sorvedouro est vinculado
 	pkt->outgoingLink=0; //necessrio para o correto funcionamento do MPLS e de vrias funes do TARVOS; indica que o pacote est sendo gerado no nodo
-	strcpy(pkt->lblHdr.msgType, msgType);
+	pkt->lblHdr.msgType=msgType;
 	pkt->lblHdr.msgID=msgID;
 	pkt->lblHdr.msgIDack=0;
 	pkt->lblHdr.LSPid=0;
@@ -637,7 +652,7 @@ static struct Packet *createControlMsg(int length, int source, int dst, char *ms
 struct Packet *createPathLabelControlMsg(int source, int dst, int er[], int LSPid) {
 	struct Packet *pkt;
 	
-	pkt = createControlMsg(tarvosParam.pathMsgSize, source, dst, "PATH_LABEL_REQUEST"); //cria uma mensagem tipo PATH_LABEL REQUEST
+	pkt = createControlMsg(tarvosParam.pathMsgSize, source, dst, MSG_PATH_LABEL_REQUEST); //cria uma mensagem tipo PATH_LABEL REQUEST
 	pkt->lblHdr.LSPid=LSPid;
 	attachExplicitRoute(pkt, er);
 	/*a mensagem no deve ser inserida ainda na fila de mensagens de controle do nodo;  conveniente escalonar a mensagem para um evento que
@@ -666,7 +681,7 @@ struct Packet *createPathLabelControlMsg(int source, int dst, int er[], int LSPi
 struct Packet *createResvMapControlMsg(int source, int dst, int er[], int msgIDack, int LSPid, int label) {
 	struct Packet *pkt;
 
-	pkt = createControlMsg(tarvosParam.resvMsgSize, source, dst, "RESV_LABEL_MAPPING"); //cria uma mensagem tipo RESV_LABEL_MAPPING
+	pkt = createControlMsg(tarvosParam.resvMsgSize, source, dst, MSG_RESV_LABEL_MAPPING); //cria uma mensagem tipo RESV_LABEL_MAPPING
 	attachExplicitRoute(pkt, er);
 	//uma mensagem RESV no requer ACK, portanto no  necessrio coloc-la na fila de mensagens de controle do nodo
 	pkt->lblHdr.msgIDack=msgIDack;
@@ -877,15 +892,14 @@ void timeoutWatchdog() {
 *  Obs.:  um HelloTimeLimit igual a zero significa que o tempo no precisa ser checado para este link em particular.
 */
 static void helloFailureCheck(double now){
+	struct TarvosContext *tc=tarvosContext();
 	struct LIBEntry *p;
-	char mainTraceString[255];
 	double tmp;
 	
-	p=lib.head->previous; //percorre no sentido inverso
-	sprintf(mainTraceString, "HELLO failure CHECK:  simtime:  %f\n", now);
-	mainTrace(mainTraceString);
+	p=tc->tc_lib.head->previous; //percorre no sentido inverso
+	tracePoint(TRACE_MAIN, 2, TREV_HELLO_CHECK, 0, 0, 0, MSG_NONE, now); //a cada execuo do watchdog; s no nvel detalhado
 	
-	while (p!=lib.head) { //s testa timeout para LSPs "up"
+	while (p!=tc->tc_lib.head) { //s testa timeout para LSPs "up"
 		tmp=(*(tarvosModel.node[p->node].helloTimeLimit))[p->oIface];
 		if (strcmp(p->status, "up")==0 && (*(tarvosModel.node[p->node].helloTimeLimit))[p->oIface]>0 && (*(tarvosModel.node[p->node].helloTimeLimit))[p->oIface]<=now) { /*testa timers para link de sada (oIface);
 																															   se o helloTimeLimit for zero, ento a checagem
@@ -893,8 +907,7 @@ static void helloFailureCheck(double now){
 			strcpy(p->status, "dst fail (HELLO)"); //os recursos reservados para a LSP devem ser retornados ao link como disponveis
 			p->timeoutStamp = now; //coloca o relgio atual no marcador timeoutStamp
 
-			sprintf(mainTraceString, "HELLO failure STAMP - dst fail (HELLO):  node:  %d  oIface:  %d  simtime:  %f\n", p->node, p->oIface, now);
-			mainTrace(mainTraceString);
+			tracePoint(TRACE_MAIN, 1, TREV_HELLO_FAIL, p->node, 0, 0, MSG_NONE, p->node, p->oIface, now);
 
 			//os recursos devem ser sempre retornados ao link, mesmo com backup LSP (pois a backup LSP no trafegar, logicamente, pelo link falho)
 			returnResources(p->LSPid, p->oIface); //retorna os recursos reservados ao link; o campo oIface da LIB indica o nmero do "link" de sada
@@ -910,13 +923,14 @@ static void helloFailureCheck(double now){
 *  Como conveno, se o campo timeout for 0, ento a funo de timeout est desativada (ou seja, as LSP nunca entram em timeout).
 */
 static void LSPtimeoutCheck(double now) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LIBEntry *p;
 
-	if (lib.head==NULL) //LIB no existe; nada faa
+	if (tc->tc_lib.head==NULL) //LIB no existe; nada faa
 		return;
 	
-	p=lib.head->previous; //percorre no sentido inverso
-	while (p!=lib.head) {
+	p=tc->tc_lib.head->previous; //percorre no sentido inverso
+	while (p!=tc->tc_lib.head) {
 		if (strcmp(p->status, "up")==0 && p->timeout <= now && p->timeout > 0) { //s testa timeout para LSPs "up"; deve-se testar para backup tambm?
 			strcpy(p->status, "timed-out"); //calma; os recursos reservados para a LSP devem ser retornados ao link como disponveis
 			p->timeoutStamp = simtime(); //coloca o relgio atual no marcador timeoutStamp
@@ -969,12 +983,13 @@ static void nodeCtrlMsgTimeoutCheck(double now) {
 *  re-escalonado continuamente com o intervalo interevento configurado nos parmetros da simulao.
 */
 void refreshLSP() {
+	struct TarvosContext *tc=tarvosContext();
 	struct LIBEntry *p;
 	struct Packet *pkt;
 	struct LSPTableEntry *lsp;
 
-	p=lib.head->previous; //percorre no sentido inverso toda a tabela LIB
-	while (p!=lib.head) {
+	p=tc->tc_lib.head->previous; //percorre no sentido inverso toda a tabela LIB
+	while (p!=tc->tc_lib.head) {
 		if (p->iIface==0 && strcmp(p->status, "up")==0) { //s faz refresh para LSPs "up", todos os nodos
 			lsp = searchInLSPTable(p->LSPid); //busca a entrada na LSP Table para o tnel LSP encontrado
 			if (lsp == NULL) { //entrada na LSP Table no encontrada; incongruncia nos bancos de dados!
@@ -1040,13 +1055,13 @@ struct Packet *createHelloControlMsg(int source, int dst) {
 	struct Packet *pkt;
 	double randInterval; //intervalo de tempo aleatrio entre 0 e 0,01*HELLO_Interval que ser somado ao tempo atual para escalonamento do pacote
 	
-	pkt = createControlMsg(tarvosParam.helloMsgSize, source, dst, "HELLO"); //cria uma mensagem tipo HELLO
+	pkt = createControlMsg(tarvosParam.helloMsgSize, source, dst, MSG_HELLO); //cria uma mensagem tipo HELLO
 	pkt->er.recordThisRoute=1; //ative a gravao da rota no pacote, para uso da mensagem HELLO_ACK de volta (se necessrio)
 	/*a mensagem no deve ser inserida ainda na fila de mensagens de controle do nodo;  conveniente escalonar a mensagem para um evento que
 	a trate e escalone-a para os eventos de recepo e transmisso apropriados.  A insero na fila de mensagens de controle deve ser feita
 	quando a mensagem  *efetivamente recebida* pelo nodo.*/
 	//pkt->generationTime=simtime(); //marca o tempo em que o pacote foi gerado
-	randInterval = uniform(0, 0.01) * tarvosParam.helloInterval; //cria intervalo de tempo aleatrio entre 0 e 0,01 * HELLO_Interval, para evitar sincronismo de gerao de mensagens HELLO
+	randInterval = uniform_s(tarvosStream(&tarvosContext()->tc_rngHello, "helloJitter"), 0, 0.01) * tarvosParam.helloInterval; //cria intervalo de tempo aleatrio entre 0 e 0,01 * HELLO_Interval, para evitar sincronismo de gerao de mensagens HELLO
 	pkt->generationTime=simtime() + randInterval; //marca o tempo em que o pacote foi gerado
 	pkt->ttl = 1; //limite o Time To Live a 1 hop, conforme indicado na RFC 3209, item 5.1
 	schedulep(getNodeCtrlMsgHandlEv(pkt->src), randInterval, pkt->id, pkt); //escalona evento de tratamento HELLO imediatamente
@@ -1069,7 +1084,7 @@ struct Packet *createHelloAckControlMsg(int source, int dst, int er[], int msgID
 	struct Packet *pkt;
 
 
-	pkt = createControlMsg(tarvosParam.helloMsgSize, source, dst, "HELLO_ACK"); //cria uma mensagem tipo HELLO_ACK
+	pkt = createControlMsg(tarvosParam.helloMsgSize, source, dst, MSG_HELLO_ACK); //cria uma mensagem tipo HELLO_ACK
 	attachExplicitRoute(pkt, er);
 	//uma mensagem HELLO_ACK no requer ACK, portanto no  necessrio coloc-la na fila de mensagens de controle do nodo
 	pkt->lblHdr.msgIDack=msgIDack;
@@ -1097,7 +1112,7 @@ struct Packet *createPathRefreshControlMsg(int source, int dst, int LSPid, int i
 	struct Packet *pkt;
 	double randInterval; //intervalo de tempo aleatrio entre 0 e 0,5*Refresh_Interval que ser somado ao tempo atual para escalonamento do pacote
 	
-	pkt = createControlMsg(tarvosParam.pathMsgSize, source, dst, "PATH_REFRESH"); //cria uma mensagem tipo PATH_REFRESH
+	pkt = createControlMsg(tarvosParam.pathMsgSize, source, dst, MSG_PATH_REFRESH); //cria uma mensagem tipo PATH_REFRESH
 	pkt->lblHdr.LSPid=LSPid;
 	pkt->lblHdr.label = iLabel; //coloca o label inicial no pacote, para que esta mensagem prossiga comutada por rtulo
 	pkt->er.explicitRoute = NULL; //certifica que no h rota explcita no pacote
@@ -1105,7 +1120,7 @@ struct Packet *createPathRefreshControlMsg(int source, int dst, int LSPid, int i
 	/*a mensagem no deve ser inserida ainda na fila de mensagens de controle do nodo;  conveniente escalonar a mensagem para um evento que
 	a trate e escalone-a para os eventos de recepo e transmisso apropriados.  A insero na fila de mensagens de controle deve ser feita
 	quando a mensagem  *efetivamente recebida* pelo nodo.*/
-	randInterval = uniform(0, 0.5) * tarvosParam.LSPrefreshInterval; //cria intervalo de tempo aleatrio entre 0 e 0,5 * Refresh_Interval, para evitar sincronismo de gerao de mensagens PATH_REFRESH (RFC 2205)
+	randInterval = uniform_s(tarvosStream(&tarvosContext()->tc_rngRefresh, "refreshJitter"), 0, 0.5) * tarvosParam.LSPrefreshInterval; //cria intervalo de tempo aleatrio entre 0 e 0,5 * Refresh_Interval, para evitar sincronismo de gerao de mensagens PATH_REFRESH (RFC 2205)
 	pkt->generationTime=simtime() + randInterval; //marca o tempo em que o pacote foi gerado
 	schedulep(getNodeCtrlMsgHandlEv(pkt->src), randInterval, pkt->id, pkt);
 	return pkt;
@@ -1126,7 +1141,7 @@ struct Packet *createPathRefreshControlMsg(int source, int dst, int LSPid, int i
 struct Packet *createResvRefreshControlMsg(int source, int dst, int er[], int msgIDack, int LSPid) {
 	struct Packet *pkt;
 
-	pkt = createControlMsg(tarvosParam.resvMsgSize, source, dst, "RESV_REFRESH"); //cria uma mensagem tipo RESV_REFRESH
+	pkt = createControlMsg(tarvosParam.resvMsgSize, source, dst, MSG_RESV_REFRESH); //cria uma mensagem tipo RESV_REFRESH
 	attachExplicitRoute(pkt, er);
 	//uma mensagem RESV no requer ACK, portanto no  necessrio coloc-la na fila de mensagens de controle do nodo
 	pkt->lblHdr.msgIDack=msgIDack;
@@ -1165,7 +1180,7 @@ void startTimers(int timeoutEv, int refreshEv, int helloEv) {
 struct Packet *createPathDetourControlMsg(int sourceMP, int dstMP, int er[], int LSPid) {
 	struct Packet *pkt;
 	
-	pkt = createControlMsg(tarvosParam.pathMsgSize, sourceMP, dstMP, "PATH_DETOUR"); //cria uma mensagem tipo PATH_DETOUR
+	pkt = createControlMsg(tarvosParam.pathMsgSize, sourceMP, dstMP, MSG_PATH_DETOUR); //cria uma mensagem tipo PATH_DETOUR
 	pkt->lblHdr.LSPid=LSPid;
 	attachExplicitRoute(pkt, er);
 	/*a mensagem no deve ser inserida ainda na fila de mensagens de controle do nodo;  conveniente escalonar a mensagem para um evento que
@@ -1194,7 +1209,7 @@ struct Packet *createPathDetourControlMsg(int sourceMP, int dstMP, int er[], int
 struct Packet *createResvDetourControlMsg(int sourceMP, int dstMP, int er[], int msgIDack, int LSPid, int oLabel) {
 	struct Packet *pkt;
 
-	pkt = createControlMsg(tarvosParam.resvMsgSize, sourceMP, dstMP, "RESV_DETOUR_MAPPING"); //cria uma mensagem tipo RESV_DETOUR_MAPPING
+	pkt = createControlMsg(tarvosParam.resvMsgSize, sourceMP, dstMP, MSG_RESV_DETOUR_MAPPING); //cria uma mensagem tipo RESV_DETOUR_MAPPING
 	attachExplicitRoute(pkt, er);
 	//uma mensagem RESV no requer ACK, portanto no  necessrio coloc-la na fila de mensagens de controle do nodo
 	pkt->lblHdr.msgIDack=msgIDack;
@@ -1289,14 +1304,14 @@ static int rapidRecovery(int node, int LSPid, int iIface, int iLabel) {
 *  ser recebida pelo nodo de origem.
 *  A mensagem RESV_ERR segue no sentido downstream, e, nesta implementao, segue comutada por rtulo (a LSP deve pre-existir, portanto).
 */
-struct Packet *createResvErrControlMsg(int source, int dst, int LSPid, int iLabel, char *errorCode, char *errorValue) {
+struct Packet *createResvErrControlMsg(int source, int dst, int LSPid, int iLabel, int errorCode, int errorValue) {
 	struct Packet *pkt;
 	
-	pkt = createControlMsg(tarvosParam.resvMsgSize, source, dst, "RESV_ERR"); //cria uma mensagem tipo RESV_ERR
+	pkt = createControlMsg(tarvosParam.resvMsgSize, source, dst, MSG_RESV_ERR); //cria uma mensagem tipo RESV_ERR
 	pkt->lblHdr.LSPid=LSPid;
 	pkt->lblHdr.label = iLabel; //coloca o label inicial no pacote, para que esta mensagem prossiga comutada por rtulo
-	strcpy(pkt->lblHdr.errorCode, errorCode);
-	strcpy(pkt->lblHdr.errorValue, errorValue);
+	pkt->lblHdr.errorCode=errorCode;
+	pkt->lblHdr.errorValue=errorValue;
 	pkt->er.explicitRoute = NULL; //certifica que no h rota explcita no pacote
 	/*a mensagem no deve ser inserida ainda na fila de mensagens de controle do nodo;  conveniente escalonar a mensagem para um evento que
 	a trate e escalone-a para os eventos de recepo e transmisso apropriados.  A insero na fila de mensagens de controle deve ser feita
@@ -1314,13 +1329,13 @@ struct Packet *createResvErrControlMsg(int source, int dst, int LSPid, int iLabe
 *  ser recebida pelo nodo de origem.
 *  A mensagem PATH_ERR segue no sentido upstream.  A rota inversa ser computada nodo a nodo, atravs da leitura da LIB (a LSP deve pre-existir, portanto).
 */
-struct Packet *createPathErrControlMsg(int source, int dst, int LSPid, char *errorCode, char *errorValue) {
+struct Packet *createPathErrControlMsg(int source, int dst, int LSPid, int errorCode, int errorValue) {
 	struct Packet *pkt;
 	
-	pkt = createControlMsg(tarvosParam.pathMsgSize, source, dst, "PATH_ERR"); //cria uma mensagem tipo PATH_ERR
+	pkt = createControlMsg(tarvosParam.pathMsgSize, source, dst, MSG_PATH_ERR); //cria uma mensagem tipo PATH_ERR
 	pkt->lblHdr.LSPid=LSPid;
-	strcpy(pkt->lblHdr.errorCode, errorCode);
-	strcpy(pkt->lblHdr.errorValue, errorValue);
+	pkt->lblHdr.errorCode=errorCode;
+	pkt->lblHdr.errorValue=errorValue;
 	/*a mensagem no deve ser inserida ainda na fila de mensagens de controle do nodo;  conveniente escalonar a mensagem para um evento que
 	a trate e escalone-a para os eventos de recepo e transmisso apropriados.  A insero na fila de mensagens de controle deve ser feita
 	quando a mensagem  *efetivamente recebida* pelo nodo.*/
@@ -1344,7 +1359,7 @@ struct Packet *createPathErrControlMsg(int source, int dst, int LSPid, char *err
 struct Packet *createPathPreemptControlMsg(int source, int dst, int er[], int LSPid) {
 	struct Packet *pkt;
 	
-	pkt = createControlMsg(tarvosParam.pathMsgSize, source, dst, "PATH_LABEL_REQUEST_PREEMPT"); //cria uma mensagem tipo PATH_LABEL_REQUEST_PREEMPT
+	pkt = createControlMsg(tarvosParam.pathMsgSize, source, dst, MSG_PATH_LABEL_REQUEST_PREEMPT); //cria uma mensagem tipo PATH_LABEL_REQUEST_PREEMPT
 	pkt->lblHdr.LSPid=LSPid;
 	attachExplicitRoute(pkt, er);
 	/*a mensagem no deve ser inserida ainda na fila de mensagens de controle do nodo;  conveniente escalonar a mensagem para um evento que
@@ -1373,7 +1388,7 @@ struct Packet *createPathPreemptControlMsg(int source, int dst, int er[], int LS
 struct Packet *createResvPreemptControlMsg(int source, int dst, int er[], int msgIDack, int LSPid, int label) {
 	struct Packet *pkt;
 
-	pkt = createControlMsg(tarvosParam.resvMsgSize, source, dst, "RESV_LABEL_MAPPING_PREEMPT"); //cria uma mensagem tipo RESV_LABEL_MAPPING_PREEMPT
+	pkt = createControlMsg(tarvosParam.resvMsgSize, source, dst, MSG_RESV_LABEL_MAPPING_PREEMPT); //cria uma mensagem tipo RESV_LABEL_MAPPING_PREEMPT
 	attachExplicitRoute(pkt, er);
 	//uma mensagem RESV no requer ACK, portanto no  necessrio coloc-la na fila de mensagens de controle do nodo
 	pkt->lblHdr.msgIDack=msgIDack;
@@ -1464,6 +1479,7 @@ static void insertInLspList(struct LspList *lspList, int LSPid, int setPrio, int
 *  As prioridades Holding Priority e Setup Priority variam de 0 a 7, 0 a maior, 7 a menor.
 */
 int preemptResouces(int LSPid, int node, int link) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LSPTableEntry *lsp, *lspTmp;
 	struct LspList *lspList;
 	struct LspListItem *lspListItem, *aux;
@@ -1485,8 +1501,8 @@ int preemptResouces(int LSPid, int node, int link) {
 		}
 		//algum recurso no est imediatamente disponvel; tentar preempo
 		lspList=initLspList();
-		p=lib.head->previous; //percorre no sentido inverso toda a tabela LIB
-		while (p!=lib.head) {
+		p=tc->tc_lib.head->previous; //percorre no sentido inverso toda a tabela LIB
+		while (p!=tc->tc_lib.head) {
 			lspTmp=searchInLSPTable(p->LSPid);
 			if (p->oIface==link && p->node==node && strcmp(p->status, "up")==0 && lspTmp->holdPrio > lsp->setPrio && p->bak==0) { //s varre working LSPs "up" com HoldPrio "menor" que SetPrio
 				cbs+=lspTmp->cbs; //acumule recursos
@@ -1541,14 +1557,15 @@ int preemptResouces(int LSPid, int node, int link) {
 *  1 para SUCESSO; se no forem suficientes, retorna 0 para FALHA.
 */
 int testResources(int LSPid, int node, int link) {
+	struct TarvosContext *tc=tarvosContext();
 	struct LSPTableEntry *lsp, *lspTmp;
 	struct LIBEntry *p;
 	double cbs, cir, pir;
 	
 	cir=pir=cbs=0;
 	lsp=searchInLSPTable(LSPid); //LSPid corrente (que est em montagem)
-	p=lib.head->previous; //percorre no sentido inverso toda a tabela LIB
-	while (p!=lib.head) {
+	p=tc->tc_lib.head->previous; //percorre no sentido inverso toda a tabela LIB
+	while (p!=tc->tc_lib.head) {
 		lspTmp=searchInLSPTable(p->LSPid);
 		if (p->oIface==link && p->node==node && strcmp(p->status, "up")==0 && lspTmp->holdPrio > lsp->setPrio && p->bak==0) { //s varre working LSPs "up" com HoldPrio "menor" que SetPrio
 			cbs+=lspTmp->cbs; //acumule recursos
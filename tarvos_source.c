@@ -40,6 +40,8 @@
 void createTrafficSource(int n_src) {
 	tarvosModel.src[n_src].packetsGenerated = 0;  //Inicializa nmero de pacotes gerados pela fonte
 	tarvosModel.src[n_src].expooAbsoluteTurnOffTime = 0;  //Inicializa o relgio de cada fonte, para uso dos geradores Expoo
+	tarvosModel.src[n_src].rng = 0;  //o stream aleatrio da fonte, usado por todos os seus geradores aleatrios,  criado no primeiro uso (tarvosStream)
+	sprintf(tarvosModel.src[n_src].rngName, "src%d", n_src);
 }
 
 /* Geracao para o Nucleo FONTES - SOURCES */
@@ -80,7 +82,7 @@ void expTrafficGenerator(int ev, int n_src, int length, int source, int dst, dou
 	pkt->dst = dst; //Nodo ao qual o sorvedouro esta vinculado
 	pkt->outgoingLink=0; //necessrio para o correto funcionamento do MPLS
 	pkt->lblHdr.priority=prio; //coloca a prioridade no pacote
-	nextArrival=expntl(tau);
+	nextArrival=expntl_s(tarvosStream(&tarvosModel.src[n_src].rng, tarvosModel.src[n_src].rngName), tau);
 	pkt->generationTime=nextArrival+simtime(); //marca o tempo em que o pacote foi gerado
 	
 	//o escalonamento  feito diretamente aqui
@@ -165,9 +167,9 @@ void expooTrafficGenerator(int ev, int n_src, int length, int source, int dst, d
 	double ie_t;
 	double expooRelativeTurnOnTime; //tempo relativo em que o gerador deve ser ligado
 	struct Packet *pkt;
-	char traceString[255]; //string que conter a linha de trace gerada
 
 	/*
+	char traceString[255]; //string que conter a linha de trace gerada
 	sprintf(traceString, "expoo gen #%d - ton (mean=%f), toff (mean=%f)\n", n_src, ton, toff);
 	expooSourceTrace(traceString);
 	*/
@@ -189,30 +191,27 @@ void expooTrafficGenerator(int ev, int n_src, int length, int source, int dst, d
 		tarvosModel.src[n_src].packetsGenerated++;  //incrementa contador de pacotes gerados por este Source
 		
 		//linhas para gerao de tracing
-		sprintf(traceString, "expoo gen #%d - simtime: %f pktID: %d pktLENGTH: %d pktACNODE: %d pktSRC: %d pktSINK: %d\n", n_src, simtime()+ie_t, pkt->id, length, source, source, dst); //debug
-		sourceTrace(traceString);
+		tracePoint(TRACE_SOURCE, 1, TREV_EXPOO_PKT, source, 0, pkt->id, MSG_NONE, n_src, simtime()+ie_t, pkt->id, length, source, source, dst); //debug
 	} else {
 		//aqui, o simtime() superou o expooAbsoluteTurnOffTime; ento, entrar no perodo IDLE ou OFF; gerar uma nova chegada
 		//em expooRelativeTurnOnTime e um novo expooAbsoluteTurnOffTime
-		expooRelativeTurnOnTime=expntl(toff); //a nova chegada ser gerada aps um tempo toff;
+		expooRelativeTurnOnTime=expntl_s(tarvosStream(&tarvosModel.src[n_src].rng, tarvosModel.src[n_src].rngName), toff); //a nova chegada ser gerada aps um tempo toff;
 		//observar que aqui pode haver um ligeiro acrscimo de tempo entre expooAbsoluteTurnOffTime e o novo expooRelativeTurnOnTime
-		tarvosModel.src[n_src].expooAbsoluteTurnOffTime=expntl(ton)+expooRelativeTurnOnTime+simtime(); //aqui o simtime() deve ser acrescido, pois expooAbsoluteTurnOffTime deve representar o tempo absoluto
+		tarvosModel.src[n_src].expooAbsoluteTurnOffTime=expntl_s(tarvosStream(&tarvosModel.src[n_src].rng, tarvosModel.src[n_src].rngName), ton)+expooRelativeTurnOnTime+simtime(); //aqui o simtime() deve ser acrescido, pois expooAbsoluteTurnOffTime deve representar o tempo absoluto
 		pkt->generationTime=expooRelativeTurnOnTime+simtime(); //marca o tempo em que o pacote foi gerado
 		/* O escalonamento tem que ser aqui pois o pacote atual que esta sendo processado no main eh diferente
 		deste aqui que foi gerado agora */
 		
 		//linhas para gerao de tracing
-		sprintf(traceString, "-----expoo gen #%d - simtime: %f expooRelativeTurnOnTime: %f sim+turn_on: %f expooAbsoluteTurnOffTime: %f\n", n_src, simtime(), expooRelativeTurnOnTime, simtime()+expooRelativeTurnOnTime, tarvosModel.src[n_src].expooAbsoluteTurnOffTime); //debug
-		sourceTrace(traceString);
-		sprintf(traceString, "expoo gen #%d - simtime: %f pktID: %d pktLENGTH: %d pktACNODE: %d pktSRC: %d pktSINK: %d\n", n_src, simtime()+expooRelativeTurnOnTime, pkt->id, length, source, source, dst);
-		sourceTrace(traceString);
+		tracePoint(TRACE_SOURCE, 1, TREV_EXPOO_TURN_ON, source, 0, 0, MSG_NONE, n_src, simtime(), expooRelativeTurnOnTime, simtime()+expooRelativeTurnOnTime,
+			tarvosModel.src[n_src].expooAbsoluteTurnOffTime); //debug
+		tracePoint(TRACE_SOURCE, 1, TREV_EXPOO_PKT, source, 0, pkt->id, MSG_NONE, n_src, simtime()+expooRelativeTurnOnTime, pkt->id, length, source, source, dst);
 		
 		schedulep(ev, expooRelativeTurnOnTime, pkt->id, pkt);
 		tarvosModel.src[n_src].packetsGenerated++;  //incrementa contador de pacotes gerados por este Source
 
 		//Gera arquivo para validacao do gerador exponencial on/off
-		sprintf(traceString, "expoo gen #%d - %f, %f\n", n_src, tarvosModel.src[n_src].expooAbsoluteTurnOffTime-(expooRelativeTurnOnTime+simtime()), expooRelativeTurnOnTime);
-		expooSourceTrace(traceString);
+		tracePoint(TRACE_EXPOO, 1, TREV_EXPOO_ONOFF, source, 0, 0, MSG_NONE, n_src, tarvosModel.src[n_src].expooAbsoluteTurnOffTime-(expooRelativeTurnOnTime+simtime()), expooRelativeTurnOnTime);
 	}
 }
 
@@ -283,9 +282,9 @@ void expooTrafficGeneratorLabel(int ev, int n_src, int length, int source, int d
 	double ie_t;
 	double expooRelativeTurnOnTime; //tempo (relativo) em que o gerador de trafego deve ser ligado
 	struct Packet *pkt;
-	char traceString[255];
 
 	/*
+	char traceString[255]; //string que conter a linha de trace gerada
 	sprintf(traceString, "expoo gen #%d - ton (mean=%f), toff (mean=%f)\n", n_src, ton, toff);
 	expooSourceTrace(traceString);
 	*/
@@ -309,28 +308,25 @@ void expooTrafficGeneratorLabel(int ev, int n_src, int length, int source, int d
 		tarvosModel.src[n_src].packetsGenerated++;  //incrementa contador de pacotes gerados por este Source
 
 		//linhas para gerao de tracing
-		sprintf(traceString, "expoo gen #%d - simtime: %f pktID: %d pktLENGTH: %d pktACNODE: %d pktSRC: %d pktSINK: %d\n", n_src, simtime()+ie_t, pkt->id, length, source, source, dst); //debug
-		sourceTrace(traceString);
+		tracePoint(TRACE_SOURCE, 1, TREV_EXPOO_PKT, source, 0, pkt->id, MSG_NONE, n_src, simtime()+ie_t, pkt->id, length, source, source, dst); //debug
 	} else {
 		//aqui, o simtime() superou o expooAbsoluteTurnOffTime; ento, entrar no perodo IDLE ou OFF; gerar uma nova chegada
 		//em expooRelativeTurnOnTime e um novo expooAbsoluteTurnOffTime
-		expooRelativeTurnOnTime=expntl(toff); //a nova chegada ser gerada aps um tempo toff;
+		expooRelativeTurnOnTime=expntl_s(tarvosStream(&tarvosModel.src[n_src].rng, tarvosModel.src[n_src].rngName), toff); //a nova chegada ser gerada aps um tempo toff;
 		//observar que aqui pode haver um ligeiro acrscimo de tempo entre expooAbsoluteTurnOffTime e o novo expooRelativeTurnOnTime
-		tarvosModel.src[n_src].expooAbsoluteTurnOffTime=expntl(ton)+expooRelativeTurnOnTime+simtime(); //aqui o simtime() deve ser acrescido, pois expooAbsoluteTurnOffTime deve representar o tempo absoluto
+		tarvosModel.src[n_src].expooAbsoluteTurnOffTime=expntl_s(tarvosStream(&tarvosModel.src[n_src].rng, tarvosModel.src[n_src].rngName), ton)+expooRelativeTurnOnTime+simtime(); //aqui o simtime() deve ser acrescido, pois expooAbsoluteTurnOffTime deve representar o tempo absoluto
 		pkt->generationTime=expooRelativeTurnOnTime+simtime(); //marca o tempo em que o pacote foi gerado
 
 		//linhas para gerao de tracing
-		sprintf(traceString, "-----expoo gen #%d - simtime: %f expooRelativeTurnOnTime: %f sim+turn_on: %f expooAbsoluteTurnOffTime: %f\n", n_src, simtime(), expooRelativeTurnOnTime, simtime()+expooRelativeTurnOnTime, tarvosModel.src[n_src].expooAbsoluteTurnOffTime); //debug
-		sourceTrace(traceString);
-		sprintf(traceString, "expoo gen #%d - simtime: %f pktID: %d pktLENGTH: %d pktACNODE: %d pktSRC: %d pktSINK: %d\n", n_src, simtime()+expooRelativeTurnOnTime, pkt->id, length, source, source, dst);
-		sourceTrace(traceString);
+		tracePoint(TRACE_SOURCE, 1, TREV_EXPOO_TURN_ON, source, 0, 0, MSG_NONE, n_src, simtime(), expooRelativeTurnOnTime, simtime()+expooRelativeTurnOnTime,
+			tarvosModel.src[n_src].expooAbsoluteTurnOffTime); //debug
+		tracePoint(TRACE_SOURCE, 1, TREV_EXPOO_PKT, source, 0, pkt->id, MSG_NONE, n_src, simtime()+expooRelativeTurnOnTime, pkt->id, length, source, source, dst);
 		
 		schedulep(ev, expooRelativeTurnOnTime, pkt->id, pkt);
 		tarvosModel.src[n_src].packetsGenerated++;  //incrementa contador de pacotes gerados por este Source
 
 		//Gera arquivo para validacao do gerador exponencial on/off
-		sprintf(traceString, "expoo gen #%d - %f, %f\n", n_src, tarvosModel.src[n_src].expooAbsoluteTurnOffTime-(expooRelativeTurnOnTime+simtime()), expooRelativeTurnOnTime);
-		expooSourceTrace(traceString);
+		tracePoint(TRACE_EXPOO, 1, TREV_EXPOO_ONOFF, source, 0, 0, MSG_NONE, n_src, tarvosModel.src[n_src].expooAbsoluteTurnOffTime-(expooRelativeTurnOnTime+simtime()), expooRelativeTurnOnTime);
 	}
 }
 
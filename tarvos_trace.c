@@ -22,21 +22,842 @@
 * along with TARVOS Computer Networks Simulator.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "simm_globals.h" //simtime()
 #include "tarvos_globals.h"
+#include <stdarg.h>
+
+#define TRACE_BUF_SIZE (1 << 20) //tamanho do buffer de cada arquivo de trace (bytes)
+#define TRACE_NODE_BUF_SIZE (1 << 16) //tamanho do buffer de cada arquivo de trace por nodo (atraso e jitter)
+#define TRACE_VERSION 3 //verso do formato do trace binrio
+#define TRACE_TEXT_MAX 256 //texto de um registro guardado na sua posio do buffer circular da gravao assncrona; o excedente ocupa as posies seguintes
+
+/* Primitivas de thread e de memria da gravao assncrona */
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+#define TRACE_THREAD					HANDLE
+#define traceLoadAcquire(p)				InterlockedOr64((volatile LONG64 *)(p), 0)
+#define traceStoreRelease(p, v)			InterlockedExchange64((volatile LONG64 *)(p), (v))
+#define traceExchange(p, v)				InterlockedExchange64((volatile LONG64 *)(p), (v))
+#define traceYield()					SwitchToThread()
+#define traceSleep()					Sleep(1)
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#define TRACE_THREAD					pthread_t
+#define traceLoadAcquire(p)				__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define traceStoreRelease(p, v)			__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define traceExchange(p, v)				__atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+#define traceYield()					sched_yield()
+static void traceSleep() { struct timespec ts = {0, 200000}; nanosleep(&ts, NULL); }
+#endif
+
+/* Arquivo de trace com buffer prprio:  os registros so acumulados em tb_buf e gravados com um nico fwrite quando o buffer enche, em vez de
+*  uma chamada  stdio por registro.  Os buffers so descarregados por traceFlush e, ao trmino do programa, por traceClose (atexit).
+*/
+struct traceBuf {
+	FILE *tb_fp;
+	char *tb_buf;
+	int tb_size; //capacidade de tb_buf
+	int tb_used; //bytes ocupados em tb_buf
+};
+
+/* Formato de texto de cada evento (enum TraceEvent, na mesma ordem); os argumentos de tracePoint seguem as converses do formato, que podem ser
+*  d, i, u, x, X ou c (int), f, e, E, g ou G (double) e s (string), sem modificadores de tamanho.
+*/
+static const char *traceFormats[TREV_EVENTS]={
+	NULL, //TREV_TEXT
+	NULL, //TREV_SAMPLE
+	NULL, //TREV_SAMPLE_INTERVAL
+	"LINK %d DOWN at simtime: %f  Total Packets Dropped:  %d\n", //TREV_LINK_DOWN
+	"LINK %d UP at simtime: %f\n", //TREV_LINK_UP
+	"CtrlMsg inserted in node Queue: node:  %d  msgID:  %d  LSPid:  %d  src:  %d  dst:  %d  iLabel:  %d\n", //TREV_MSGQ_INSERT
+	"Ctrl Msg REMOVED - msgID: %d msgIDack: %d LSPid: %d src: %d dst: %d iIface: %d oIface: %d  %s\n", //TREV_MSGQ_REMOVE
+	"simtime: %f  node: %d  ID: %d  msgID: %d label: %d src: %d  dst: %d outgoingLink: %d  reason: %s\n", //TREV_PKT_DROP
+	"Ctrl Msg Received - node:  %d  msgID:  %d  msgIDack:  %d  LSPid:  %d  src:  %d  dst:  %d label:  %d  %s\n", //TREV_CTRLMSG_RECEIVED
+	"LSP (working) successfully created.  LSPid:  %d  iLabel:  %d oLabel: %d at node %d\n", //TREV_LSP_WORKING
+	"LSP (backup) successfully created.  LSPid:  %d  iLabel:  %d oLabel: %d at node %d\n", //TREV_LSP_BACKUP
+	"Resources for LSP successfully refreshed.  LSPid:  %d  at node %d\n", //TREV_RESV_REFRESH
+	"Node found reachable by HELLO.  src:  %d  dst:  %d  at node %d.  Next timeout:  %f\n", //TREV_HELLO_REACHABLE
+	"HELLO failure CHECK:  simtime:  %f\n", //TREV_HELLO_CHECK
+	"HELLO failure STAMP - dst fail (HELLO):  node:  %d  oIface:  %d  simtime:  %f\n", //TREV_HELLO_FAIL
+	"expoo gen #%d - simtime: %f pktID: %d pktLENGTH: %d pktACNODE: %d pktSRC: %d pktSINK: %d\n", //TREV_EXPOO_PKT
+	"-----expoo gen #%d - simtime: %f expooRelativeTurnOnTime: %f sim+turn_on: %f expooAbsoluteTurnOffTime: %f\n", //TREV_EXPOO_TURN_ON
+	"expoo gen #%d - %f, %f\n" //TREV_EXPOO_ONOFF
+};
+
+/* Amostras de atraso e jitter de um nodo no intervalo de agregao corrente (jitterDelayInterval) */
+struct traceInterval {
+	long long ti_k; //ndice do intervalo (tempo / jitterDelayInterval)
+	int ti_n; //amostras acumuladas; 0 se o intervalo est vazio
+	double ti_dMin, ti_dSum, ti_dMax, ti_jMin, ti_jSum, ti_jMax;
+};
+
+/* Posio do buffer circular da gravao assncrona:  o registro e o seu texto */
+struct traceSlot {
+	struct traceRecord ts_rec;
+	char ts_text[TRACE_TEXT_MAX];
+};
+
+/* Buffer circular de um produtor (a thread da simulao) e um consumidor (a thread writer), sem locks.  head e tail crescem indefinidamente e a
+*  posio  o ndice mdulo size; cada um  escrito por um s lado e lido pelo outro com acquire/release, e ficam em linhas de cache separadas.
+*  Um registro com texto maior que TRACE_TEXT_MAX ocupa traceSlots(tr_len) posies consecutivas:  o excedente do texto  copiado sobre as
+*  posies seguintes inteiras, e a thread writer o remonta em text.  S um texto maior que todo o buffer circular  truncado (truncated).
+*/
+struct traceRing {
+	struct traceSlot *slots;
+	long long size; //capacidade em registros (potncia de 2)
+	char pad0[64];
+	long long head; //prximo registro a produzir; escrito s pelo produtor
+	char pad1[64];
+	long long tail; //prximo registro a consumir; escrito s pelo consumidor
+	char pad2[64];
+	long long stop; //pedido de trmino da thread writer, aps esvaziar o buffer
+	long long discarded; //registros descartados com o buffer cheio; escrito s pelo produtor
+	long long truncated; //registros com texto truncado por no caber em todo o buffer; escrito s pelo produtor
+	char *text; //texto remontado de um registro que ocupa vrias posies; usado s pelo consumidor
+	int textSize; //capacidade de text
+	int running; //thread writer ativa
+	TRACE_THREAD thread;
+};
+
+/* Estado dos traces de um contexto de simulao (tc_trace em TarvosContext), criado no primeiro registro:  cada simulao tem os seus arquivos, o seu
+*  buffer circular e a sua thread writer, e simulaes em threads diferentes (replRun) no compartilham nada.  Numa replicao de replRun, os nomes
+*  dos arquivos recebem "_repN" antes da extenso (traceFileName).  Os arquivos so fechados por traceContextFree, quando o contexto  destrudo, e,
+*  para os contextos que no so destrudos (o contexto padro, ou um criado com simmContextCreate e no destrudo), ao trmino do programa
+*  (traceExit, que percorre a lista traceLive dos estados existentes).
+*/
+struct traceState {
+	struct traceBuf text[TRACE_TYPES]; //arquivos dos traces de texto livre (TRACE_MAIN a TRACE_EXPOO), formato texto
+	struct traceBuf *nodes[2][2]; //[trace global, de aplicao][atraso, jitter]:  vetores de arquivos por nodo, formato texto
+	int nodesSize; //tamanho dos vetores de nodes (nmero real de nodos + 1)
+	struct traceBuf series; //arquivo nico de atraso e jitter de todos os nodos (jitterDelayOneFile), formato texto
+	struct traceInterval *intervals[2]; //[trace global, de aplicao]:  vetores por nodo
+	struct traceBuf bin; //arquivo do trace binrio
+	int rep; //replicao de replRun que grava os arquivos (replCurrent); 0 fora de replRun
+	struct traceRing ring; //buffer circular da gravao assncrona
+	struct traceState *next, *previous; //lista traceLive
+};
+
+static struct traceState *traceLive=NULL; //estados de trace existentes, de todos os contextos, fechados por traceExit
+static long long traceLiveLock=0; //trava de traceLive e de traceAtExit (contextos de replRun so criados e destrudos em threads diferentes)
+static int traceAtExit=0; //traceExit j registrada com atexit
+
+static void traceExit();
+
+static void traceLiveAcquire() {
+	while (traceExchange(&traceLiveLock, 1))
+		traceYield();
+}
+
+static void traceLiveRelease() {
+	traceStoreRelease(&traceLiveLock, 0);
+}
+
+/* Estado dos traces do contexto de simulao corrente, criado no primeiro uso */
+static struct traceState *traceCurrent() {
+	struct TarvosContext *tc=tarvosContext();
+
+	if (tc->tc_trace==NULL) {
+		tc->tc_trace=(struct traceState*)calloc(1, sizeof *tc->tc_trace);
+		if (tc->tc_trace==NULL) {
+			printf("\nError - traceCurrent - insufficient memory to allocate for trace state");
+			exit(1);
+		}
+		tc->tc_trace->rep=replCurrent();
+		traceLiveAcquire();
+		tc->tc_trace->next=traceLive;
+		if (traceLive!=NULL)
+			traceLive->previous=tc->tc_trace;
+		traceLive=tc->tc_trace;
+		if (!traceAtExit) {
+			traceAtExit=1;
+			atexit(traceExit);
+		}
+		traceLiveRelease();
+	}
+	return tc->tc_trace;
+}
+
+#define traceSlots(len) (1 + ((len)>TRACE_TEXT_MAX ? ((len)-TRACE_TEXT_MAX+(int)sizeof(struct traceSlot)-1) / (int)sizeof(struct traceSlot) : 0)) //posies ocupadas por um registro com texto de len bytes
+
+/* Nome do arquivo de trace name na replicao rep de replRun:  "_repN" antes da extenso; fora de replRun (rep = 0), o prprio name */
+static void traceFileName(char *out, const char *name, int rep) {
+	const char *dot=strrchr(name, '.');
+
+	if (rep==0) {
+		strcpy(out, name);
+		return;
+	}
+	if (dot==NULL || strchr(dot, '\\')!=NULL || strchr(dot, '/')!=NULL) //sem extenso no ltimo componente do caminho
+		dot=name+strlen(name);
+	sprintf(out, "%.*s_rep%d%s", (int)(dot-name), name, rep, dot);
+}
+
+/* Abre o arquivo de trace name (com o sufixo da replicao do contexto; ver traceFileName) e aloca seu buffer */
+static void traceOpen(struct traceState *ts, struct traceBuf *tb, const char *name, char *mode, int size) {
+	char filename[300];
+
+	traceFileName(filename, name, ts->rep);
+	tb->tb_fp=fopen(filename, mode);
+	tb->tb_buf=(char*)malloc(size);
+	if (tb->tb_fp==NULL || tb->tb_buf==NULL) {
+		printf("\nError - traceOpen - unable to open trace file %s", filename);
+		exit(1);
+	}
+	tb->tb_size=size;
+	tb->tb_used=0;
+}
+
+/* Grava o contedo do buffer no arquivo */
+static void traceBufFlush(struct traceBuf *tb) {
+	if (tb->tb_used>0)
+		fwrite(tb->tb_buf, 1, tb->tb_used, tb->tb_fp);
+	tb->tb_used=0;
+}
+
+/* Acrescenta len bytes ao buffer do arquivo, gravando-o antes se no houver espao */
+static void traceBufWrite(struct traceBuf *tb, const void *data, int len) {
+	if (tb->tb_used+len > tb->tb_size) {
+		traceBufFlush(tb);
+		if (len > tb->tb_size) { //maior que o buffer inteiro:  grava diretamente
+			fwrite(data, 1, len, tb->tb_fp);
+			return;
+		}
+	}
+	memcpy(tb->tb_buf+tb->tb_used, data, len);
+	tb->tb_used+=len;
+}
+
+/* Descarrega o buffer e fecha o arquivo */
+static void traceBufClose(struct traceBuf *tb) {
+	if (tb->tb_fp==NULL)
+		return;
+	traceBufFlush(tb);
+	fclose(tb->tb_fp);
+	free(tb->tb_buf);
+	tb->tb_fp=NULL;
+	tb->tb_buf=NULL;
+}
+
+/* Avana fmt at a prxima converso; copia em spec a especificao completa ("%...c") e retorna o caractere de converso, ou 0 se no houver mais
+*  converses.  Se out no for NULL, o texto literal percorrido  copiado em out (at outSize bytes), e *outLen  atualizado.
+*/
+static char traceNextSpec(const char **fmt, char *spec, char *out, int outSize, int *outLen) {
+	const char *f=*fmt;
+	int n;
+
+	for (; *f!='\0'; f++) {
+		if (*f=='%' && f[1]=='%') //"%%"  literal
+			f++;
+		else if (*f=='%')
+			break;
+		if (out!=NULL && *outLen<outSize-1)
+			out[(*outLen)++]=*f;
+	}
+	if (*f=='\0') {
+		*fmt=f;
+		return 0;
+	}
+	for (n=0; f[n]!='\0' && strchr("diuxXcfeEgGs", f[n])==NULL; n++) //flags, largura e preciso
+		;
+	if (f[n]=='\0' || n>=30) {
+		printf("\nError - traceNextSpec - invalid trace format");
+		exit(1);
+	}
+	memcpy(spec, f, n+1);
+	spec[n+1]='\0';
+	*fmt=f+n+1;
+	return f[n];
+}
+
+/* Monta em out o texto do registro estruturado rec, cujos argumentos esto em args, conforme o formato do evento; retorna o tamanho do texto */
+static int traceFormatText(struct traceRecord *rec, const char *args, char *out, int outSize) {
+	const char *fmt=traceFormats[rec->tr_event], *a=args, *end=args+rec->tr_len;
+	char spec[32], conv;
+	int len=0, ival, n;
+	double dval;
+
+	while ((conv=traceNextSpec(&fmt, spec, out, outSize, &len))!=0) {
+		n=0;
+		if (strchr("feEgG", conv)!=NULL) {
+			if (a+sizeof dval>end)
+				break;
+			memcpy(&dval, a, sizeof dval);
+			a+=sizeof dval;
+			n=snprintf(out+len, outSize-len, spec, dval);
+		} else if (conv=='s') {
+			if (a>=end)
+				break;
+			n=snprintf(out+len, outSize-len, spec, a);
+			a+=strlen(a)+1;
+		} else {
+			if (a+sizeof ival>end)
+				break;
+			memcpy(&ival, a, sizeof ival);
+			a+=sizeof ival;
+			n=snprintf(out+len, outSize-len, spec, ival);
+		}
+		if (n>0)
+			len+=(n<outSize-len ? n : outSize-len-1);
+	}
+	return len;
+}
+
+/* Retorna 1 se key est na lista de filtro list (terminada por 0); a lista vazia contm todas as chaves */
+static int traceFilterHas(const int *list, int key) {
+	int i;
+
+	if (list[0]==0)
+		return 1;
+	for (i=0; i<TRACE_FILTER_SIZE && list[i]!=0; i++)
+		if (list[i]==key)
+			return 1;
+	return 0;
+}
+
+/* GRAVA UM REGISTRO DE TRACE NO FORMATO TEXTO
+*
+*  Produz exatamente o texto dos traces em arquivo texto:  a entrada, para os traces de texto livre, o texto montado a partir do formato do evento,
+*  para os pontos de trace estruturados, e uma linha "simtime<TAB>valor" nos arquivos de
+*  atraso e de jitter do nodo, para os traces de atraso e jitter (os arquivos de todos os nodos, ou s dos nodos de
+*  traceFilterNodes com traceFilter ligado, so criados, com a linha de ttulo, no primeiro registro).  Com jitterDelayOneFile, as amostras de atraso e jitter de todos os nodos vo para um s arquivo, uma linha por amostra com o nodo e a
+*  srie ("all" ou "appl").  Os resumos por intervalo (TREV_SAMPLE_INTERVAL) trazem, em vez do valor, o nmero de amostras e o mnimo, a mdia e o
+*  mximo.  Usada pelos traces no formato texto e por traceDecode.
+*/
+static void traceStoreText(struct traceState *ts, struct traceRecord *rec, const char *text) {
+	static const char *series[2][2]={{"delay", "jitter"}, {"Appldelay", "Appljitter"}}; //nomes das colunas dos arquivos por nodo
+	char *names[2][2]={{tarvosParam.delayNodes, tarvosParam.jitterNodes}, {tarvosParam.applDelayNodes, tarvosParam.applJitterNodes}};
+	char *textNames[TRACE_TYPES]={NULL, tarvosParam.traceDump, tarvosParam.dropPktTrace, tarvosParam.sourceTrace, tarvosParam.expooTrace};
+	char line[512], filename[255];
+	struct traceBuf *tb;
+	struct traceIntervalStats st;
+	int appl, interval, k, i, len;
+
+	if (rec->tr_event!=TREV_SAMPLE && rec->tr_event!=TREV_SAMPLE_INTERVAL) {
+		tb=&ts->text[rec->tr_type];
+		if (tb->tb_fp==NULL)
+			traceOpen(ts, tb, textNames[rec->tr_type], "w", TRACE_BUF_SIZE);
+		if (rec->tr_event==TREV_TEXT)
+			traceBufWrite(tb, text, rec->tr_len);
+		else {
+			len=traceFormatText(rec, text, line, sizeof line);
+			traceBufWrite(tb, line, len);
+		}
+		return;
+	}
+	appl=(rec->tr_type==TRACE_JITTERDELAY_APPL);
+	interval=(rec->tr_event==TREV_SAMPLE_INTERVAL);
+	if (interval)
+		memcpy(&st, text, sizeof st);
+	if (tarvosParam.jitterDelayOneFile) { //arquivo nico, uma linha por amostra (ou intervalo) com o nodo e a srie
+		if (ts->series.tb_fp==NULL) {
+			traceOpen(ts, &ts->series, tarvosParam.jitterDelayFile, "w", TRACE_BUF_SIZE);
+			if (interval)
+				len=sprintf(line, "simtime\tnode\tseries\tsamples\tdelay_min\tdelay_mean\tdelay_max\tjitter_min\tjitter_mean\tjitter_max\n");
+			else
+				len=sprintf(line, "simtime\tnode\tseries\tdelay\tjitter\n");
+			traceBufWrite(&ts->series, line, len);
+		}
+		if (interval)
+			len=sprintf(line, "%.20f\t%d\t%s\t%d\t%.20f\t%.20f\t%.20f\t%.20f\t%.20f\t%.20f\n", rec->tr_time, rec->tr_node, appl ? "appl" : "all", st.ts_n,
+				st.ts_delayMin, st.ts_delayMean, st.ts_delayMax, st.ts_jitterMin, st.ts_jitterMean, st.ts_jitterMax);
+		else
+			len=sprintf(line, "%.20f\t%d\t%s\t%.20f\t%.20f\n", rec->tr_time, rec->tr_node, appl ? "appl" : "all", rec->tr_value, rec->tr_value2);
+		traceBufWrite(&ts->series, line, len);
+		return;
+	}
+	if (ts->nodes[appl][0]==NULL) { //cria os arquivos de atraso e jitter dos nodos (s os de traceFilterNodes, com traceFilter); s  executado 1 vez por trace
+		ts->nodesSize=(sizeof tarvosModel.node / sizeof *(tarvosModel.node)); //tamanho do vetor nodes (que  o nmero real de nodos + 1)
+		for (k=0; k<2; k++) {
+			ts->nodes[appl][k]=(struct traceBuf*)calloc(ts->nodesSize, sizeof *ts->nodes[appl][k]);
+			if (ts->nodes[appl][k]==NULL) {
+				printf("\nError - traceStoreText - insufficient memory to allocate for node trace files");
+				exit(1);
+			}
+			if (interval)
+				len=sprintf(line, "simtime\tsamples\t%s_min\t%s_mean\t%s_max\n", series[appl][k], series[appl][k], series[appl][k]);
+			else
+				len=sprintf(line, "simtime\t%s\n", series[appl][k]);
+			for (i=1; i<ts->nodesSize; i++) {
+				if (tarvosParam.traceFilter && !traceFilterHas(tarvosParam.traceFilterNodes, i))
+					continue;
+				sprintf(filename, names[appl][k], i);
+				traceOpen(ts, &ts->nodes[appl][k][i], filename, "w", TRACE_NODE_BUF_SIZE);
+				traceBufWrite(&ts->nodes[appl][k][i], line, len);
+			}
+		}
+	}
+	if (rec->tr_node<=0 || rec->tr_node>=ts->nodesSize) {
+		printf("\nError - traceStoreText - sample for node %d outside the topology (%d nodes)", rec->tr_node, ts->nodesSize-1);
+		exit(1);
+	}
+	if (ts->nodes[appl][0][rec->tr_node].tb_fp==NULL) //nodo fora de traceFilterNodes (ex.:  traceDecode de um trace sem filtro):  descarta
+		return;
+	if (interval) {
+		len=sprintf(line, "%.20f\t%d\t%.20f\t%.20f\t%.20f\n", rec->tr_time, st.ts_n, st.ts_delayMin, st.ts_delayMean, st.ts_delayMax);
+		traceBufWrite(&ts->nodes[appl][0][rec->tr_node], line, len);
+		len=sprintf(line, "%.20f\t%d\t%.20f\t%.20f\t%.20f\n", rec->tr_time, st.ts_n, st.ts_jitterMin, st.ts_jitterMean, st.ts_jitterMax);
+		traceBufWrite(&ts->nodes[appl][1][rec->tr_node], line, len);
+		return;
+	}
+	len=sprintf(line, "%.20f\t%.20f\n", rec->tr_time, rec->tr_value);
+	traceBufWrite(&ts->nodes[appl][0][rec->tr_node], line, len);
+	len=sprintf(line, "%.20f\t%.20f\n", rec->tr_time, rec->tr_value2);
+	traceBufWrite(&ts->nodes[appl][1][rec->tr_node], line, len);
+}
+
+/* Grava um registro de trace no formato configurado (traceFormat) */
+static void traceStore(struct traceState *ts, struct traceRecord *rec, const char *text) {
+	struct traceFileHeader th;
+
+	if (tarvosParam.traceFormat==TRACE_TEXT) {
+		traceStoreText(ts, rec, text);
+		return;
+	}
+	if (ts->bin.tb_fp==NULL) {
+		traceOpen(ts, &ts->bin, tarvosParam.binTrace, "wb", TRACE_BUF_SIZE);
+		memcpy(th.th_magic, "TRVT", 4);
+		th.th_version=TRACE_VERSION;
+		th.th_recSize=sizeof(struct traceRecord);
+		th.th_nodes=NODES;
+		traceBufWrite(&ts->bin, &th, sizeof th);
+	}
+	traceBufWrite(&ts->bin, rec, sizeof *rec);
+	if (rec->tr_len>0)
+		traceBufWrite(&ts->bin, text, rec->tr_len);
+}
+
+/* Remonta em ring.text o texto do registro que comea na posio tail e ocupa as posies seguintes */
+static char *traceJoin(struct traceState *ts, long long tail) {
+	struct traceSlot *slot=&ts->ring.slots[tail & (ts->ring.size-1)];
+	int len=slot->ts_rec.tr_len, part, pos;
+
+	if (len>ts->ring.textSize) {
+		ts->ring.text=(char*)realloc(ts->ring.text, len);
+		if (ts->ring.text==NULL) {
+			printf("\nError - traceJoin - insufficient memory to allocate for trace text");
+			exit(1);
+		}
+		ts->ring.textSize=len;
+	}
+	memcpy(ts->ring.text, slot->ts_text, TRACE_TEXT_MAX);
+	for (pos=TRACE_TEXT_MAX; pos<len; pos+=part) {
+		part=len-pos<(int)sizeof(struct traceSlot) ? len-pos : (int)sizeof(struct traceSlot);
+		memcpy(ts->ring.text+pos, &ts->ring.slots[++tail & (ts->ring.size-1)], part);
+	}
+	return ts->ring.text;
+}
+
+/* Lao da thread writer:  grava os registros do buffer circular at que ele esteja vazio e o trmino tenha sido pedido */
+static void traceWriter(struct traceState *ts) {
+	struct traceSlot *slot;
+	long long tail=ts->ring.tail, head, n;
+
+	for (;;) {
+		head=traceLoadAcquire(&ts->ring.head);
+		if (tail==head) {
+			//stop  gravado pelo produtor depois do seu ltimo head; se stop foi visto, uma nova leitura de head  definitiva
+			if (traceLoadAcquire(&ts->ring.stop) && traceLoadAcquire(&ts->ring.head)==tail)
+				break;
+			traceSleep();
+			continue;
+		}
+		for (; tail<head; tail+=n) { //head s avana depois de todas as posies de um registro
+			slot=&ts->ring.slots[tail & (ts->ring.size-1)];
+			n=traceSlots(slot->ts_rec.tr_len);
+			traceStore(ts, &slot->ts_rec, n==1 ? slot->ts_text : traceJoin(ts, tail));
+			traceStoreRelease(&ts->ring.tail, tail+n);
+		}
+	}
+}
+
+#if defined(_WIN32)
+static unsigned __stdcall traceThread(void *arg) { traceWriter((struct traceState*)arg); return 0; }
+#else
+static void *traceThread(void *arg) { traceWriter((struct traceState*)arg); return NULL; }
+#endif
+
+/* Cria o buffer circular (na primeira vez) e inicia a thread writer */
+static void traceStart(struct traceState *ts) {
+	long long size;
+
+	if (ts->ring.slots==NULL) {
+		for (size=1; size<tarvosParam.traceRingSize; size<<=1)
+			;
+		ts->ring.slots=(struct traceSlot*)malloc(size * sizeof *ts->ring.slots);
+		if (ts->ring.slots==NULL) {
+			printf("\nError - traceStart - insufficient memory to allocate for trace ring buffer");
+			exit(1);
+		}
+		ts->ring.size=size;
+	}
+	ts->ring.stop=0;
+#if defined(_WIN32)
+	ts->ring.thread=(HANDLE)_beginthreadex(NULL, 0, traceThread, ts, 0, NULL);
+	if (ts->ring.thread==0)
+#else
+	if (pthread_create(&ts->ring.thread, NULL, traceThread, ts)!=0)
+#endif
+	{
+		printf("\nError - traceStart - cannot create trace writer thread");
+		exit(1);
+	}
+	ts->ring.running=1;
+}
+
+/* Pede o trmino da thread writer e aguarda que ela grave todos os registros pendentes do buffer circular */
+static void traceStop(struct traceState *ts) {
+	if (!ts->ring.running)
+		return;
+	traceStoreRelease(&ts->ring.stop, 1);
+#if defined(_WIN32)
+	WaitForSingleObject(ts->ring.thread, INFINITE);
+	CloseHandle(ts->ring.thread);
+#else
+	pthread_join(ts->ring.thread, NULL);
+#endif
+	ts->ring.running=0;
+}
+
+/* Coloca um registro no buffer circular.  Com o buffer cheio, aguarda a thread writer liberar espao (TRACE_WAIT) ou descarta o registro
+*  (TRACE_DISCARD); os registros do trace principal so sempre descartados, para que mainTrace nunca bloqueie a simulao.
+*/
+static void tracePush(struct traceState *ts, struct traceRecord *rec, const char *text) {
+	struct traceSlot *slot;
+	long long head, n, k;
+	int len=rec->tr_len, part;
+
+	if (!ts->ring.running)
+		traceStart(ts);
+	n=traceSlots(len);
+	if (n>ts->ring.size) { //texto maior que todo o buffer circular:   truncado
+		n=ts->ring.size;
+		len=TRACE_TEXT_MAX+(int)(n-1)*(int)sizeof(struct traceSlot);
+	}
+	head=ts->ring.head;
+	while (head+n-traceLoadAcquire(&ts->ring.tail) > ts->ring.size) {
+		if (tarvosParam.traceOverflow==TRACE_DISCARD || rec->tr_type==TRACE_MAIN) {
+			ts->ring.discarded++;
+			return;
+		}
+		traceYield();
+	}
+	slot=&ts->ring.slots[head & (ts->ring.size-1)];
+	slot->ts_rec=*rec;
+	if (len<rec->tr_len)
+		ts->ring.truncated++;
+	slot->ts_rec.tr_len=len;
+	part=len<TRACE_TEXT_MAX ? len : TRACE_TEXT_MAX;
+	if (part>0)
+		memcpy(slot->ts_text, text, part);
+	for (k=1; k<n; k++) { //o excedente do texto ocupa as posies seguintes inteiras
+		text+=part;
+		len-=part;
+		part=len<(int)sizeof(struct traceSlot) ? len : (int)sizeof(struct traceSlot);
+		memcpy(&ts->ring.slots[(head+k) & (ts->ring.size-1)], text, part);
+	}
+	traceStoreRelease(&ts->ring.head, head+n);
+}
+
+/* Encaminha um registro de trace:  ao buffer circular da thread writer, com traceAsync, ou diretamente aos arquivos */
+static void traceEmit(struct traceState *ts, struct traceRecord *rec, const char *text) {
+	if (tarvosParam.traceAsync)
+		tracePush(ts, rec, text);
+	else
+		traceStore(ts, rec, text);
+}
+
+/* Registra uma entrada de texto livre no trace indicado */
+static void traceTextEntry(int type, char *entry) {
+	struct traceRecord rec;
+
+	memset(&rec, 0, sizeof rec);
+	rec.tr_time=simtime();
+	rec.tr_type=type;
+	rec.tr_event=TREV_TEXT;
+	rec.tr_len=strlen(entry);
+	traceEmit(traceCurrent(), &rec, entry);
+}
+
+/* Grava o resumo do intervalo de agregao acumulado em ti e esvazia o intervalo */
+static void traceIntervalEmit(struct traceState *ts, int type, int node, struct traceInterval *ti) {
+	struct traceRecord rec;
+	struct traceIntervalStats st;
+
+	st.ts_n=ti->ti_n;
+	st.ts_delayMin=ti->ti_dMin;
+	st.ts_delayMean=ti->ti_dSum/ti->ti_n;
+	st.ts_delayMax=ti->ti_dMax;
+	st.ts_jitterMin=ti->ti_jMin;
+	st.ts_jitterMean=ti->ti_jSum/ti->ti_n;
+	st.ts_jitterMax=ti->ti_jMax;
+	memset(&rec, 0, sizeof rec);
+	rec.tr_time=ti->ti_k*tarvosParam.jitterDelayInterval;
+	rec.tr_node=node;
+	rec.tr_type=type;
+	rec.tr_event=TREV_SAMPLE_INTERVAL;
+	rec.tr_len=sizeof st;
+	traceEmit(ts, &rec, (const char *)&st);
+	ti->ti_n=0;
+}
+
+/* Acumula uma amostra de atraso e jitter no intervalo de agregao do nodo; uma amostra de um intervalo posterior fecha o intervalo corrente */
+static void traceIntervalAdd(struct traceState *ts, int type, int node, double stime, double jitter, double delay) {
+	struct traceInterval *ti;
+	long long k;
+	int appl=(type==TRACE_JITTERDELAY_APPL);
+
+	if (ts->intervals[appl]==NULL) {
+		ts->intervals[appl]=(struct traceInterval*)calloc(sizeof tarvosModel.node / sizeof *(tarvosModel.node), sizeof *ts->intervals[appl]);
+		if (ts->intervals[appl]==NULL) {
+			printf("\nError - traceIntervalAdd - insufficient memory to allocate for trace intervals");
+			exit(1);
+		}
+	}
+	ti=&ts->intervals[appl][node];
+	k=(long long)floor(stime/tarvosParam.jitterDelayInterval);
+	if (ti->ti_n>0 && k!=ti->ti_k)
+		traceIntervalEmit(ts, type, node, ti);
+	if (ti->ti_n==0) {
+		ti->ti_k=k;
+		ti->ti_dMin=ti->ti_dMax=delay;
+		ti->ti_jMin=ti->ti_jMax=jitter;
+		ti->ti_dSum=ti->ti_jSum=0;
+	}
+	ti->ti_n++;
+	ti->ti_dSum+=delay;
+	ti->ti_jSum+=jitter;
+	if (delay<ti->ti_dMin) ti->ti_dMin=delay;
+	if (delay>ti->ti_dMax) ti->ti_dMax=delay;
+	if (jitter<ti->ti_jMin) ti->ti_jMin=jitter;
+	if (jitter>ti->ti_jMax) ti->ti_jMax=jitter;
+}
+
+/* Grava os intervalos de agregao ainda abertos de todos os nodos */
+static void traceIntervalFlush(struct traceState *ts) {
+	int appl, i, nodes=(sizeof tarvosModel.node / sizeof *(tarvosModel.node));
+
+	for (appl=0; appl<2; appl++)
+		if (ts->intervals[appl]!=NULL)
+			for (i=1; i<nodes; i++)
+				if (ts->intervals[appl][i].ti_n>0)
+					traceIntervalEmit(ts, appl ? TRACE_JITTERDELAY_APPL : TRACE_JITTERDELAY, i, &ts->intervals[appl][i]);
+}
+
+/* Registra uma amostra de atraso e jitter do nodo, medida no pacote pkt, no trace indicado, ou a acumula no intervalo de agregao do nodo
+*  (jitterDelayInterval).  Com traceFilter ligado, a amostra passa antes pelos filtros de nodo e de amostragem de pacotes (traceSelect); os intervalos
+*  de agregao resumem s as amostras selecionadas.
+*/
+static void traceSample(int type, int node, int pkt, double stime, double jitter, double delay) {
+	struct traceRecord rec;
+
+	if (tarvosParam.traceFilter && !traceSelect(tarvosParam.jitterDelayInterval>0 ? TREV_SAMPLE_INTERVAL : TREV_SAMPLE, node, 0, pkt, MSG_NONE))
+		return;
+	if (tarvosParam.jitterDelayInterval>0) {
+		traceIntervalAdd(traceCurrent(), type, node, stime, jitter, delay);
+		return;
+	}
+	memset(&rec, 0, sizeof rec);
+	rec.tr_time=stime;
+	rec.tr_value=delay;
+	rec.tr_value2=jitter;
+	rec.tr_node=node;
+	rec.tr_type=type;
+	rec.tr_event=TREV_SAMPLE;
+	traceEmit(traceCurrent(), &rec, NULL);
+}
+
+/* FILTRO DOS PONTOS DE TRACE
+*
+*  Chamada pela macro tracePoint, com traceFilter ligado, antes de o registro ser montado.  Retorna 1 se o ponto de trace deve ser registrado:  o evento
+*  est na mscara traceFilterEvents, o tipo da mensagem em traceFilterMsgTypes, o nodo em traceFilterNodes, o LSPid em traceFilterLSPs e o pacote 
+*  um dos escolhidos pela amostragem de 1 em traceSampleN.  Cada filtro vazio (0) deixa passar tudo, e um ponto de trace sem nodo, LSP ou pacote (0)
+*  ou sem mensagem de controle (MSG_NONE) no  filtrado por aquele critrio.  A
+*  amostragem usa um hash multiplicativo do ID do pacote, e no a ordem de chegada, para que todos os pontos de trace de um mesmo pacote sejam
+*  registrados (ou descartados) juntos, em todos os nodos e em todas as execues.
+*/
+int traceSelect(int event, int node, int lsp, int pkt, int msgType) {
+	if (tarvosParam.traceFilterEvents!=0 && (tarvosParam.traceFilterEvents & (1u<<event))==0)
+		return 0;
+	if (msgType!=MSG_NONE && tarvosParam.traceFilterMsgTypes!=0 && (tarvosParam.traceFilterMsgTypes & (1u<<msgType))==0)
+		return 0;
+	if (node!=0 && !traceFilterHas(tarvosParam.traceFilterNodes, node))
+		return 0;
+	if (lsp!=0 && !traceFilterHas(tarvosParam.traceFilterLSPs, lsp))
+		return 0;
+	if (pkt!=0 && tarvosParam.traceSampleN>1 && ((unsigned int)pkt*2654435761u>>16)%tarvosParam.traceSampleN!=0)
+		return 0;
+	return 1;
+}
+
+/* REGISTRA UM PONTO DE TRACE ESTRUTURADO
+*
+*  Chamada pela macro tracePoint (ver tarvos_globals.h) depois de testados o nvel do trace e os filtros.  Os argumentos variveis so lidos conforme as converses
+*  do formato do evento e copiados para a carga do registro (int e double em binrio; strings com o '\0' final), sem formatao de texto.
+*/
+void traceEvent(int type, int event, int node, int pkt, ...) {
+	struct traceRecord rec;
+	char args[TRACE_TEXT_MAX], spec[32], conv;
+	const char *fmt=traceFormats[event], *str;
+	int len=0, ival, n;
+	double dval;
+	va_list ap;
+
+	va_start(ap, pkt);
+	while ((conv=traceNextSpec(&fmt, spec, NULL, 0, NULL))!=0) {
+		if (strchr("feEgG", conv)!=NULL) {
+			dval=va_arg(ap, double);
+			if (len+(int)sizeof dval<=TRACE_TEXT_MAX) {
+				memcpy(args+len, &dval, sizeof dval);
+				len+=sizeof dval;
+			}
+		} else if (conv=='s') {
+			str=va_arg(ap, const char *);
+			n=strlen(str);
+			if (len+n+1>TRACE_TEXT_MAX) //trunca a string para caber no registro
+				n=TRACE_TEXT_MAX-len-1;
+			if (n>=0) {
+				memcpy(args+len, str, n);
+				args[len+n]='\0';
+				len+=n+1;
+			}
+		} else {
+			ival=va_arg(ap, int);
+			if (len+(int)sizeof ival<=TRACE_TEXT_MAX) {
+				memcpy(args+len, &ival, sizeof ival);
+				len+=sizeof ival;
+			}
+		}
+	}
+	va_end(ap);
+	memset(&rec, 0, sizeof rec);
+	rec.tr_time=simtime();
+	rec.tr_node=node;
+	rec.tr_pkt=pkt;
+	rec.tr_type=type;
+	rec.tr_event=event;
+	rec.tr_len=len;
+	traceEmit(traceCurrent(), &rec, args);
+}
+
+/* DESCARREGA OS BUFFERS DOS TRACES
+*
+*  Grava em disco o contedo pendente dos buffers de todos os arquivos de trace abertos (por exemplo, antes de ler um trace com a simulao em
+*  andamento).  Ao trmino do programa isso  feito automaticamente.  Com gravao assncrona, a thread writer primeiro esvazia o buffer circular
+*  e termina; o prximo registro a reinicia.
+*/
+void traceFlush() {
+	struct traceState *ts=tarvosContext()->tc_trace;
+	int type, appl, k, i;
+
+	if (ts==NULL) //nenhum registro de trace no contexto corrente
+		return;
+	traceIntervalFlush(ts); //os intervalos de agregao abertos so gravados; amostras posteriores abrem novos intervalos
+	traceStop(ts);
+	for (type=0; type<TRACE_TYPES; type++)
+		if (ts->text[type].tb_fp!=NULL) {
+			traceBufFlush(&ts->text[type]);
+			fflush(ts->text[type].tb_fp);
+		}
+	for (appl=0; appl<2; appl++)
+		for (k=0; k<2; k++)
+			if (ts->nodes[appl][k]!=NULL)
+				for (i=1; i<ts->nodesSize; i++)
+					if (ts->nodes[appl][k][i].tb_fp!=NULL) {
+						traceBufFlush(&ts->nodes[appl][k][i]);
+						fflush(ts->nodes[appl][k][i].tb_fp);
+					}
+	if (ts->series.tb_fp!=NULL) {
+		traceBufFlush(&ts->series);
+		fflush(ts->series.tb_fp);
+	}
+	if (ts->bin.tb_fp!=NULL) {
+		traceBufFlush(&ts->bin);
+		fflush(ts->bin.tb_fp);
+	}
+}
+
+/* Descarrega e fecha todos os arquivos de trace do estado ts */
+static void traceClose(struct traceState *ts) {
+	int type, appl, k, i;
+
+	traceIntervalFlush(ts);
+	traceStop(ts); //esvazia o buffer circular da gravao assncrona
+	for (type=0; type<TRACE_TYPES; type++)
+		traceBufClose(&ts->text[type]);
+	for (appl=0; appl<2; appl++)
+		for (k=0; k<2; k++)
+			if (ts->nodes[appl][k]!=NULL) {
+				for (i=1; i<ts->nodesSize; i++)
+					traceBufClose(&ts->nodes[appl][k][i]);
+				free(ts->nodes[appl][k]);
+				ts->nodes[appl][k]=NULL;
+			}
+	traceBufClose(&ts->series);
+	traceBufClose(&ts->bin);
+	if (ts->ring.truncated>0)
+		printf("\ntraceClose - %lld trace entries truncated (text longer than the trace ring buffer)\n", ts->ring.truncated);
+	ts->ring.truncated=0;
+}
+
+/* Fecha os traces de todos os contextos ainda existentes ao trmino do programa; registrada com atexit (traceCurrent) */
+static void traceExit() {
+	struct traceState *ts;
+
+	traceLiveAcquire();
+	for (ts=traceLive; ts!=NULL; ts=ts->next)
+		traceClose(ts);
+	traceLiveRelease();
+}
+
+/* LIBERA O ESTADO DOS TRACES DE UM CONTEXTO
+*
+*  Descarrega e fecha os arquivos de trace do contexto tc e libera o seu estado.  Chamada por tarvosContextFree, quando o contexto de simulao 
+*  destrudo (simmContextDestroy); os traces de uma replicao de replRun ficam assim completos ao fim da replicao.
+*/
+void traceContextFree(struct TarvosContext *tc) {
+	struct traceState *ts=tc->tc_trace;
+
+	if (ts==NULL)
+		return;
+	traceClose(ts);
+	traceLiveAcquire();
+	if (ts->previous!=NULL)
+		ts->previous->next=ts->next;
+	else
+		traceLive=ts->next;
+	if (ts->next!=NULL)
+		ts->next->previous=ts->previous;
+	traceLiveRelease();
+	free(ts->intervals[0]);
+	free(ts->intervals[1]);
+	free(ts->ring.slots);
+	free(ts->ring.text);
+	free(ts);
+	tc->tc_trace=NULL;
+}
+
+/* RECUPERA O NMERO DE REGISTROS DE TRACE DESCARTADOS
+*
+*  Retorna quantos registros de trace foram descartados por encontrar cheio o buffer circular da gravao assncrona (traceAsync), com
+*  traceOverflow = TRACE_DISCARD ou no trace principal, no contexto de simulao corrente.
+*/
+long long getTraceDiscardCount() {
+	struct traceState *ts=tarvosContext()->tc_trace;
+
+	return (ts!=NULL ? ts->ring.discarded : 0);
+}
 
 /* TRACE PRINCIPAL
 *
 *  colocar aqui as informaes desejadas para o trace principal da simulao
 */
 void mainTrace(char *entry) {
-	static FILE *traceDump=NULL;
-	
 	if (!tarvosParam.traceMain) //verifica se a gerao de trace est ativa
 		return;
-	if (traceDump==NULL)
-		traceDump=fopen(tarvosParam.traceDump, "w");
-
-	fprintf(traceDump, "%s", entry);
+	traceTextEntry(TRACE_MAIN, entry);
 }
 
 /* TRACE DOS PACOTES PERDIDOS
@@ -44,14 +865,9 @@ void mainTrace(char *entry) {
 *  colocar aqui as informaes desejadas para os pacotes descartados durante a simulao
 */
 void dropPktTrace(char *entry) {
-	static FILE *dropDump=NULL;
-	
 	if (!tarvosParam.traceDrop) //verifica se a gerao de trace est ativa
 		return;
-	if (dropDump==NULL)
-		dropDump=fopen(tarvosParam.dropPktTrace, "w");
-	
-	fprintf(dropDump, "%s", entry);
+	traceTextEntry(TRACE_DROP, entry);
 }
 
 /* TRACE DOS GERADORES DE TRFEGO (FONTES)
@@ -59,14 +875,9 @@ void dropPktTrace(char *entry) {
 *  colocar aqui as informaes desejadas para tracing dos geradores de trfego
 */
 void sourceTrace(char *entry) {
-	static FILE *srcDump=NULL;
-	
 	if (!tarvosParam.traceSource) //verifica se a gerao de trace est ativa
 		return;
-	if (srcDump==NULL)
-		srcDump=fopen(tarvosParam.sourceTrace, "w");
-
-	fprintf(srcDump, "%s", entry);
+	traceTextEntry(TRACE_SOURCE, entry);
 }
 
 /* TRACE DOS GERADORES DE TRFEGO EXPONENCIAL ON/OFF (FONTES)
@@ -74,14 +885,9 @@ void sourceTrace(char *entry) {
 *  colocar aqui as informaes desejadas para tracing dos geradores de trfego expoo
 */
 void expooSourceTrace(char *entry) {
-	static FILE *expooSrcDump=NULL;
-	
 	if (!tarvosParam.traceExpoo) //verifica se a gerao de trace est ativa
 		return;
-	if (expooSrcDump==NULL)
-		expooSrcDump=fopen(tarvosParam.expooTrace, "w");
-
-	fprintf(expooSrcDump, "%s", entry);
+	traceTextEntry(TRACE_EXPOO, entry);
 }
 
 /* REGISTRA AS ESTATSTICAS DELAY E JITTER DO NODO EM ARQUIVO
@@ -92,36 +898,15 @@ void expooSourceTrace(char *entry) {
 *  Da mesma forma, as estatsticas s devem ser registradas em arquivo se de fato tiverem sido atualizadas, a fim de evitar registros repetidos
 *  ou com delay igual a zero (que acontece quando a funo  chamada mesmo quando as estatstica no foram atualizadas, caso em que o registro ser
 *  feito com as estatsticas anteriormente armazenadas no nodo, para o pacote anterior).
+*  pkt  o ID do pacote medido, usado com node pelos filtros do trace (traceFilter).
 *
 *  Esta  uma funo desenhada especificamente para testes na Dissertao de Mestrado de Marcos Portnoi.  Na distribuio final, esta funo poder
 *  ser deixada no cdigo, mas no ser chamada por nenhuma outra neste arquivo.
 */
-void jitterDelayTrace(int node, double stime, double jitter, double delay) {
-	static FILE **delay_out;
-	static FILE **jitter_out; //arquivos de sada de jitter e delay
-	char filename[255];
-	int i, nodes;
-	static int isOpen=0;
-
+void jitterDelayTrace(int node, int pkt, double stime, double jitter, double delay) {
 	if (!tarvosParam.traceJitterDelayGlobal) 
 		return;
-	//executa se a flag de gerao de trace para Jitter e Delay estiver habilitada
-	if (!isOpen) { //cria todos os arquivos de sada para jitter e delay; s  chamado 1 vez, na primeira vez que a funo  chamada
-		isOpen=1;
-		nodes=(sizeof tarvosModel.node / sizeof *(tarvosModel.node)); //tamanho do vetor nodes (que  o nmero real de nodos + 1)
-		delay_out = (FILE**)malloc(nodes * sizeof **delay_out); //cria vetor com [nmero de nodes] posies
-		jitter_out = (FILE**)malloc(nodes * sizeof **jitter_out); //cria vetor com [nmero de nodes] posies
-		for (i=1; i<=nodes; i++) {
-			sprintf(filename, tarvosParam.delayNodes, i);
-			delay_out[i] = fopen(filename,"w");
-			fprintf(delay_out[i], "simtime\tdelay\n");
-			sprintf(filename, tarvosParam.jitterNodes, i);
-			jitter_out[i] = fopen(filename,"w");
-			fprintf(jitter_out[i], "simtime\tjitter\n");
-		}
-	}
-	fprintf(delay_out[node], "%.20f\t%.20f\n", stime, delay);
-	fprintf(jitter_out[node], "%.20f\t%.20f\n", stime, jitter);
+	traceSample(TRACE_JITTERDELAY, node, pkt, stime, jitter, delay);
 }
 
 /* REGISTRA AS ESTATSTICAS DELAY E JITTER DE APLICAO DO NODO EM ARQUIVO
@@ -132,33 +917,69 @@ void jitterDelayTrace(int node, double stime, double jitter, double delay) {
 *  Da mesma forma, as estatsticas s devem ser registradas em arquivo se de fato tiverem sido atualizadas, a fim de evitar registros repetidos
 *  ou com delay igual a zero (que acontece quando a funo  chamada mesmo quando as estatstica no foram atualizadas, caso em que o registro ser
 *  feito com as estatsticas anteriormente armazenadas no nodo, para o pacote anterior).
+*  pkt  o ID do pacote medido, usado com node pelos filtros do trace (traceFilter).
 *
 *  Esta  uma funo desenhada especificamente para testes na Dissertao de Mestrado de Marcos Portnoi.  Na distribuio final, esta funo poder
 *  ser deixada no cdigo, mas no ser chamada por nenhuma outra neste arquivo.
 */
-void jitterDelayApplTrace(int node, double stime, double jitter, double delay) {
-	static FILE **delay_out;
-	static FILE **jitter_out; //arquivos de sada de jitter e delay
-	char filename[50];
-	int i, nodes;
-	static int isOpen=0;
-	
+void jitterDelayApplTrace(int node, int pkt, double stime, double jitter, double delay) {
 	if (!tarvosParam.traceJitterDelayAppl) 
 		return;
-	if (!isOpen) { //cria todos os arquivos de sada para jitter e delay Aplicaes; s  chamado 1 vez, na primeira vez que a funo  chamada
-		isOpen=1;
-		nodes=(sizeof tarvosModel.node / sizeof *(tarvosModel.node)); //tamanho do vetor nodes (que  o nmero real de nodos + 1)
-		delay_out = (FILE**)malloc(nodes * sizeof **delay_out); //cria vetor com [nmero de nodes] posies
-		jitter_out = (FILE**)malloc(nodes * sizeof **jitter_out); //cria vetor com [nmero de nodes] posies
-		for (i=1; i<=nodes; i++) {
-			sprintf(filename, tarvosParam.applDelayNodes, i);
-			delay_out[i] = fopen(filename,"w");
-			fprintf(delay_out[i], "simtime\tAppldelay\n");
-			sprintf(filename, tarvosParam.applJitterNodes, i);
-			jitter_out[i] = fopen(filename,"w");
-			fprintf(jitter_out[i], "simtime\tAppljitter\n");
-		}
-	}
-	fprintf(delay_out[node], "%.20f\t%.20f\n", stime, delay);
-	fprintf(jitter_out[node], "%.20f\t%.20f\n", stime, jitter);
+	traceSample(TRACE_JITTERDELAY_APPL, node, pkt, stime, jitter, delay);
+}
+
+/* DECODIFICA UM TRACE BINRIO
+*
+*  L o arquivo de trace binrio binFile (gravado com traceFormat = TRACE_BINARY) e grava os traces no formato texto, nos mesmos arquivos e com o mesmo
+*  contedo que a simulao teria gravado com traceFormat = TRACE_TEXT (os nomes dos arquivos so os de tarvosParam).  Para uso num programa  parte,
+*  aps a simulao:  um main() que inclua os cabealhos do TARVOS com o mesmo NODES da simulao e chame traceDecode("trace.bin").
+*  Retorna o nmero de registros decodificados.
+*/
+long long traceDecode(char *binFile) {
+	struct traceState *ts=traceCurrent();
+	FILE *fp;
+	struct traceFileHeader th;
+	struct traceRecord rec;
+	char *text=NULL;
+	int textSize=0;
+	long long records=0;
+
+	fp=fopen(binFile, "rb");
+	if (fp==NULL) {
+		printf("\nError - traceDecode - unable to open binary trace file %s", binFile);
+		exit(1);
+	}
+	if (fread(&th, sizeof th, 1, fp)!=1 || memcmp(th.th_magic, "TRVT", 4)!=0 || th.th_version!=TRACE_VERSION || th.th_recSize!=sizeof rec) {
+		printf("\nError - traceDecode - %s is not a binary trace file of this version", binFile);
+		exit(1);
+	}
+	if (th.th_nodes!=NODES) {
+		printf("\nError - traceDecode - trace recorded with %d nodes; NODES is %d", th.th_nodes, NODES);
+		exit(1);
+	}
+	while (fread(&rec, sizeof rec, 1, fp)==1) {
+		if (rec.tr_type<=0 || rec.tr_type>=TRACE_TYPES || rec.tr_event>=TREV_EVENTS || rec.tr_len<0 || ((rec.tr_event==TREV_SAMPLE || rec.tr_event==TREV_SAMPLE_INTERVAL) && (rec.tr_node<=0 || rec.tr_node>NODES))
+			|| (rec.tr_event==TREV_SAMPLE_INTERVAL && rec.tr_len!=sizeof(struct traceIntervalStats))) {
+			printf("\nError - traceDecode - corrupt record #%lld in %s", records+1, binFile);
+			exit(1);
+		}
+		if (rec.tr_len>textSize) {
+			textSize=rec.tr_len;
+			text=(char*)realloc(text, textSize);
+			if (text==NULL) {
+				printf("\nError - traceDecode - insufficient memory to allocate for record text");
+				exit(1);
+			}
+		}
+		if (rec.tr_len>0 && fread(text, 1, rec.tr_len, fp)!=(size_t)rec.tr_len) {
+			printf("\nError - traceDecode - truncated record #%lld in %s", records+1, binFile);
+			exit(1);
+		}
+		traceStoreText(ts, &rec, text);
+		records++;
+	}
+	fclose(fp);
+	free(text);
+	traceFlush();
+	return records;
 }
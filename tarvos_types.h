@@ -25,8 +25,13 @@
 
 #pragma once
 
+#include "simm_types.h" //struct simmSum e struct simmMoments, usadas nas estatsticas de Node
+
 /* Este arquivo contem a especificacao das structs utilizadas pela simulacao */
 
+#define PKT_CHUNK 256 //pacotes alocados de cada vez pelo pool de pacotes (ver createPacket)
+#define TRACE_FILTER_SIZE 16 //capacidade das listas de filtro dos pontos de trace (traceFilterNodes e traceFilterLSPs em TarvosParam)
+
 /* Esta estrutura define vrios parmetros do simulador TARVOS.  Os diversos mdulos usam estes parmetros para seu funcionamento.
 */
 struct TarvosParam {
@@ -46,10 +51,10 @@ struct TarvosParam {
 	double helloInterval; //intervalo de tempo para gerao das mensagens HELLO a partir de um LSR
 	double LSPrefreshInterval; //intervalo de tempo para gerao de mensagens PATH refresh para as LSPs
 	double ResvRefreshInterval; //intervalo de tempo para gerao de mensagens RESV refresh para as LSPs
-	int traceMain; //flag que ativa as impresses de trace principais; 0 = OFF, 1 = ON.  Vrias funes geram trace para arquivos especficos
-	int traceDrop; //flag que ativa as impresses de trace para pacotes descartados; 0 = OFF, 1 = ON.
-	int traceSource; //flag que ativa as impresses de trace para geradores de trfego; 0 = OFF, 1 = ON.
-	int traceExpoo; //flag que ativa as impresses de trace para gerador de trfego Exponencial On/Off; 0 = OFF, 1 = ON.
+	int traceMain; //nvel das impresses de trace principais; 0 = OFF, 1 = ON, 2 = detalhado (ver tracePoint).  Vrias funes geram trace para arquivos especficos
+	int traceDrop; //nvel das impresses de trace para pacotes descartados; 0 = OFF, 1 = ON, 2 = detalhado.
+	int traceSource; //nvel das impresses de trace para geradores de trfego; 0 = OFF, 1 = ON, 2 = detalhado.
+	int traceExpoo; //nvel das impresses de trace para gerador de trfego Exponencial On/Off; 0 = OFF, 1 = ON, 2 = detalhado.
 	int traceJitterDelayGlobal; //flag que ativa as impresses de trace para medies de Jitter e Delay nodo a nodo, globais; 0 = OFF, 1 = ON.
 	int traceJitterDelayAppl; //flag que ativa as impresses de trace para medies de Jitter e Delay nodo a nodo para aplicaes; 0 = OFF, 1 = ON.
 	char libFile[50];  //nome do arquivo contendo a LIB para MPLS (para leitura do simulador)
@@ -64,6 +69,68 @@ struct TarvosParam {
 	char jitterNodes[50];  //nome dos arquivos base que contero as medies Jitter de cada nodo
 	char applDelayNodes[50];  //nome dos arquivos base que contero as medies Delay de cada nodo para Aplicaes
 	char applJitterNodes[50];  //nome dos arquivos base que contero as medies Jitter de cada nodo para Aplicaes
+	int traceFormat; //formato dos traces:  TRACE_TEXT (um arquivo texto por trace, como acima) ou TRACE_BINARY (todos os traces num nico arquivo binrio binTrace; ver traceDecode)
+	char binTrace[50]; //nome do arquivo que conter o trace binrio (traceFormat = TRACE_BINARY)
+	int traceAsync; //flag que ativa a gravao dos traces por uma thread dedicada (writer), alimentada por um buffer circular; 0 = OFF, 1 = ON.
+	int traceRingSize; //capacidade do buffer circular da gravao assncrona, em registros (arredondada para potncia de 2)
+	int traceOverflow; //com o buffer circular cheio:  TRACE_WAIT (aguarda espao) ou TRACE_DISCARD (descarta e conta o registro; ver getTraceDiscardCount)
+	int jitterDelayOneFile; //flag que grava as medies de Delay e Jitter de todos os nodos (globais e de Aplicaes) num s arquivo, jitterDelayFile, com o nodo em cada linha, em vez de 2 arquivos por nodo; 0 = OFF, 1 = ON.
+	char jitterDelayFile[50]; //nome do arquivo nico das medies de Delay e Jitter (jitterDelayOneFile = 1)
+	double jitterDelayInterval; //intervalo de agregao das medies de Delay e Jitter:  0 grava cada pacote; > 0 grava, por nodo e por intervalo, o nmero de amostras e o mnimo, a mdia e o mximo
+	int traceFilter; //flag que ativa os filtros dos pontos de trace (traceFilterNodes, traceFilterLSPs, traceFilterEvents, traceFilterMsgTypes e traceSampleN; ver tracePoint); 0 = OFF, 1 = ON.
+	int traceFilterNodes[TRACE_FILTER_SIZE]; //nodos cujos pontos de trace so registrados, terminada por 0; a lista vazia ({0}) registra todos os nodos
+	int traceFilterLSPs[TRACE_FILTER_SIZE]; //LSPids cujos pontos de trace so registrados, terminada por 0; a lista vazia ({0}) registra todas as LSPs
+	unsigned int traceFilterEvents; //mscara dos eventos registrados (bit 1<<TREV_...; ver enum TraceEvent); 0 registra todos os eventos
+	unsigned int traceFilterMsgTypes; //mscara dos tipos de mensagem registrados (bit 1<<MSG_...; ver enum MsgType); 0 registra todos os tipos
+	int traceSampleN; //amostragem de pacotes:  registra os pontos de trace de 1 em cada traceSampleN pacotes, escolhidos por hash do ID do pacote; 0 ou 1 registra todos
+};
+
+/* Formato dos traces (ver traceFormat em TarvosParam) */
+enum TraceFormat {TRACE_TEXT, TRACE_BINARY};
+
+/* Tratamento de registro de trace com o buffer circular da gravao assncrona cheio (ver traceOverflow em TarvosParam) */
+enum TraceOverflow {TRACE_WAIT, TRACE_DISCARD};
+
+/* Trace de origem de um registro de trace; no formato texto, cada um corresponde a um arquivo (ou a um conjunto de arquivos por nodo) */
+enum TraceType {TRACE_MAIN=1, TRACE_DROP, TRACE_SOURCE, TRACE_EXPOO, TRACE_JITTERDELAY, TRACE_JITTERDELAY_APPL, TRACE_TYPES};
+
+/* Cdigo do evento registrado.  TREV_TEXT  uma entrada de texto livre (mainTrace e afins); TREV_SAMPLE, uma amostra de atraso e jitter;
+*  TREV_SAMPLE_INTERVAL, o resumo das amostras de atraso e jitter de um nodo num intervalo (jitterDelayInterval); os demais so
+*  pontos de trace estruturados (tracePoint), cujos argumentos vo na carga do registro e cujo texto  montado s na gravao, a partir do formato
+*  do evento (tabela traceFormats, em tarvos_trace.c, na mesma ordem desta enumerao).
+*/
+enum TraceEvent {TREV_TEXT, TREV_SAMPLE, TREV_SAMPLE_INTERVAL, TREV_LINK_DOWN, TREV_LINK_UP, TREV_MSGQ_INSERT, TREV_MSGQ_REMOVE, TREV_PKT_DROP, TREV_CTRLMSG_RECEIVED,
+	TREV_LSP_WORKING, TREV_LSP_BACKUP, TREV_RESV_REFRESH, TREV_HELLO_REACHABLE, TREV_HELLO_CHECK, TREV_HELLO_FAIL, TREV_EXPOO_PKT, TREV_EXPOO_TURN_ON,
+	TREV_EXPOO_ONOFF, TREV_EVENTS};
+
+/* Registro de trace.  No formato binrio, o arquivo comea com um struct traceFileHeader e segue com os registros, cada um imediatamente seguido de
+*  tr_len bytes de carga (o texto da entrada, sem o '\0' final, para os registros TREV_TEXT; os argumentos, para os pontos de trace estruturados).  Os registros TREV_SAMPLE dos traces de atraso e jitter
+*  no tm carga; os valores vo em tr_value e tr_value2.  Os registros TREV_SAMPLE_INTERVAL tm tr_time igual ao incio do intervalo e um struct traceIntervalStats como carga.  O arquivo  lido por traceDecode na mesma arquitetura em que foi gravado.
+*/
+struct traceRecord {
+	double tr_time; //tempo de simulao do registro
+	double tr_value; //TREV_SAMPLE:  atraso do pacote
+	double tr_value2; //TREV_SAMPLE:  jitter do pacote
+	int tr_node; //nodo a que se refere o registro; 0 se no se aplica
+	int tr_pkt; //id do pacote a que se refere o registro; 0 se no se aplica
+	unsigned short tr_type; //trace de origem (enum TraceType)
+	unsigned short tr_event; //cdigo do evento (enum TraceEvent)
+	int tr_len; //tamanho da carga que segue o registro, em bytes
+};
+
+/* Resumo das amostras de atraso e jitter de um nodo num intervalo de agregao (carga dos registros TREV_SAMPLE_INTERVAL) */
+struct traceIntervalStats {
+	int ts_n; //nmero de amostras no intervalo
+	double ts_delayMin, ts_delayMean, ts_delayMax;
+	double ts_jitterMin, ts_jitterMean, ts_jitterMax;
+};
+
+/* Cabealho do arquivo de trace binrio */
+struct traceFileHeader {
+	char th_magic[4]; //"TRVT"
+	int th_version; //verso do formato
+	int th_recSize; //sizeof(struct traceRecord) de quem gravou o arquivo
+	int th_nodes; //nmero de nodos do modelo (NODES)
 };
 
 //O link entre dois roteadores atende de maneira uniforme os pacotes que chegam a ele (uniforme em funcao da taxa de transmisso e tempo de propagao)
@@ -119,7 +186,7 @@ struct ExplicitRoute {
 * A tcnica usada  uma lista duplamente encadeada, circular, com um Head Node (este Head Node  apontado pela estrutura do Nodo).
 */
 struct nodeMsgQueue {
-	char msgType[30]; //tipo de mensagem
+	int msgType; //tipo de mensagem (enum MsgType)
 	int msgID;  //ID nico da mensagem para controle de ACK
 	int msgIDack; //ID da mensagem de controle que deve ser respondida por uma mensagem RESV
 	int LSPid;  //ID nico da LSP
@@ -140,8 +207,10 @@ struct nodeMsgQueue {
 /* Estrutura com parmetros para os Geradores de Trfego ou Fontes
 */
 struct Source {
-    int packetsGenerated;  //nmero de pacotes gerados pela fonte
+    long long packetsGenerated;  //nmero de pacotes gerados pela fonte
 	double expooAbsoluteTurnOffTime; //tempo em que a fonte expoo deve ser desligada (em tempo absoluto do simulador) (s para fontes expoo)
+	int rng; //stream aleatrio nomeado da fonte (rngName; ver tarvosStream); 0 enquanto no usado
+	char rngName[16]; //nome do stream aleatrio da fonte, "src<n_src>" (ver createTrafficSource)
 };
 
 /* Estrutura para acumular estatsticas em cada nodo ou seu destino final. Ex.:  quantos pacotes chegaram ao
@@ -149,28 +218,34 @@ struct Source {
 */
 struct Node {
     //este grupo de estatsticas  global, compreedendo pacotes de aplicao e de controle
-	int packetsReceived;  //nmero de pacotes que chegaram ao nodo.  Pode-se verificar ento quantos ficaram no caminho (descartados).
-	double bytesForwarded; //quantidade de bytes que foram encaminhados a partir deste nodo.  Similar ao packetsForwarded abaixo
-	int packetsForwarded; //nmero de pacotes que foram encaminhados a partir deste nodo.  Quando o nodo no for o sorvedouro, o pacote ser encaminhado por outro link, e esta estatstica dever ser atualizada.
-	int packetsDropped; //nmero de pacotes perdidos ou descartados no nodo (partindo dele);  o somatrio dos pacotes perdidos pela facility (transmisso) e os perdidos durante propagao, para o caso de link down.
+	long long packetsReceived;  //nmero de pacotes que chegaram ao nodo.  Pode-se verificar ento quantos ficaram no caminho (descartados).
+	long long bytesForwarded; //quantidade de bytes que foram encaminhados a partir deste nodo.  Similar ao packetsForwarded abaixo
+	long long packetsForwarded; //nmero de pacotes que foram encaminhados a partir deste nodo.  Quando o nodo no for o sorvedouro, o pacote ser encaminhado por outro link, e esta estatstica dever ser atualizada.
+	long long packetsDropped; //nmero de pacotes perdidos ou descartados no nodo (partindo dele);  o somatrio dos pacotes perdidos pela facility (transmisso) e os perdidos durante propagao, para o caso de link down.
 	double meanDelay; //atraso mdio medido para os pacotes recebidos por este nodo
-	double delaySum; //somatrio de todos os atrasos medidos para os pacotes recebidos por este nodo
+	struct simmSum delaySum; //somatrio compensado (sumAdd/sumValue) de todos os atrasos medidos para os pacotes recebidos por este nodo
+	struct simmMoments delayMom; //mdia e varincia (momAdd/momVar) dos atrasos medidos para os pacotes recebidos por este nodo
 	double delay; //atraso do ltimo pacote recebido por este nodo
 	double meanJitter; //jitter mdio para os atrasos dos pacotes recebidos por este nodo
-	double jitterSum; //somatrio de todos os jitters calculados para os pacotes recebidos por este nodo
+	struct simmSum jitterSum; //somatrio compensado de todos os jitters calculados para os pacotes recebidos por este nodo
+	struct simmMoments jitterMom; //mdia e varincia dos jitters calculados para os pacotes recebidos por este nodo
 	double jitter; //ltimo jitter calculado para o ltimo pacote recebido por este nodo
-	double bytesReceived; //nmero de bytes recebidos pelo nodo.   o tamanho de cada pacote recebido, acumulado (admite-se, aqui, pacotes de tamanho diferente).
+	long long bytesReceived; //nmero de bytes recebidos pelo nodo.   o tamanho de cada pacote recebido, acumulado (admite-se, aqui, pacotes de tamanho diferente).
+	int bmDelay; //srie de mdias de lotes (simm_stat) que recebe o atraso de cada pacote recebido; 0 se nenhuma (ver setNodeDelayBatchMeans)
+	int hist; //primeiro dos 4 histogramas (simm_stat) do nodo:  atraso, jitter, atraso e jitter de aplicao; 0 se nenhum (ver setNodeHistograms)
 	//as estatsticas abaixo so exclusivamente para pacotes de aplicao, ou seja, no-controle
-	int packetsReceivedAppl;  //nmero de pacotes que chegaram ao nodo.  Pode-se verificar ento quantos ficaram no caminho (descartados).
-	double bytesForwardedAppl; //quantidade de bytes que foram encaminhados a partir deste nodo.  Similar ao packetsForwarded abaixo
-	int packetsForwardedAppl; //nmero de pacotes que foram encaminhados a partir deste nodo.  Quando o nodo no for o sorvedouro, o pacote ser encaminhado por outro link, e esta estatstica dever ser atualizada.
+	long long packetsReceivedAppl;  //nmero de pacotes que chegaram ao nodo.  Pode-se verificar ento quantos ficaram no caminho (descartados).
+	long long bytesForwardedAppl; //quantidade de bytes que foram encaminhados a partir deste nodo.  Similar ao packetsForwarded abaixo
+	long long packetsForwardedAppl; //nmero de pacotes que foram encaminhados a partir deste nodo.  Quando o nodo no for o sorvedouro, o pacote ser encaminhado por outro link, e esta estatstica dever ser atualizada.
 	double meanDelayAppl; //atraso mdio medido para os pacotes recebidos por este nodo
-	double delaySumAppl; //somatrio de todos os atrasos medidos para os pacotes recebidos por este nodo
+	struct simmSum delaySumAppl; //somatrio compensado de todos os atrasos medidos para os pacotes recebidos por este nodo
+	struct simmMoments delayMomAppl; //mdia e varincia dos atrasos medidos para os pacotes recebidos por este nodo
 	double delayAppl; //atraso do ltimo pacote recebido por este nodo
 	double meanJitterAppl; //jitter mdio para os atrasos dos pacotes recebidos por este nodo
-	double jitterSumAppl; //somatrio de todos os jitters calculados para os pacotes recebidos por este nodo
+	struct simmSum jitterSumAppl; //somatrio compensado de todos os jitters calculados para os pacotes recebidos por este nodo
+	struct simmMoments jitterMomAppl; //mdia e varincia dos jitters calculados para os pacotes recebidos por este nodo
 	double jitterAppl; //ltimo jitter calculado para o ltimo pacote recebido por este nodo
-	double bytesReceivedAppl; //nmero de bytes recebidos pelo nodo.   o tamanho de cada pacote recebido, acumulado (admite-se, aqui, pacotes de tamanho diferente).
+	long long bytesReceivedAppl; //nmero de bytes recebidos pelo nodo.   o tamanho de cada pacote recebido, acumulado (admite-se, aqui, pacotes de tamanho diferente).
 	struct nodeMsgQueue *nodeMsgQueue; //apontador para a lista (Queue) de mensagens de controle deste nodo; aponta para o Head Node
 	int (*nextLabel)[]; /*prximo rtulo disponvel para uso em construo de uma LSP para MPLS; ao usar este rtulo, este campo deve ser
 				   incrementado a fim de assegurar rtulos nicos por interface no nodo; o ndice indica o nmero da interface, que tambm  o nmero do link do modelo*/
@@ -185,13 +260,26 @@ struct Node {
 	double (*helloTimeLimit)[]; //tempo limite para que o nodo na outra ponta do link ligado a este nodo reporte HELLO_ACK (em tempo absoluto simtime())
 };
 
-/* A estrutura a seguir representa o header (cabealho) para os protocolos de controle de rtulos (labels)
+/* Tipos das mensagens de controle (RSVP-TE); o nome de cada tipo, para os traces,  dado por getMsgTypeName */
+enum MsgType {MSG_NONE, MSG_PATH_LABEL_REQUEST, MSG_RESV_LABEL_MAPPING, MSG_PATH_REFRESH, MSG_RESV_REFRESH, MSG_HELLO, MSG_HELLO_ACK, MSG_PATH_DETOUR,
+	MSG_RESV_DETOUR_MAPPING, MSG_PATH_ERR, MSG_RESV_ERR, MSG_PATH_LABEL_REQUEST_PREEMPT, MSG_RESV_LABEL_MAPPING_PREEMPT, MSG_TYPES};
+
+/* Cdigos de erro das mensagens PATH_ERR e RESV_ERR (RFC 2205 e RFC 3209) */
+enum ErrorCode {ERRC_NONE, ERRC_ADMISSION_CONTROL_FAILURE, ERRC_POLICY_CONTROL_FAILURE, ERRC_NO_PATH_INFORMATION, ERRC_NO_SENDER_INFORMATION,
+	ERRC_ROUTING_PROBLEM, ERRC_SERVICE_PREEMPTED, ERRC_NOTIFY};
+
+/* Valores de erro (detalhe do cdigo de erro) das mensagens PATH_ERR e RESV_ERR (RFC 2205 e RFC 3209) */
+enum ErrorValue {ERRV_NONE, ERRV_BANDWIDTH_UNAVAILABLE, ERRV_BAD_EXPLICIT_ROUTE, ERRV_BAD_STRICT_NODE, ERRV_BAD_LOOSE_NODE, ERRV_NO_ROUTE,
+	ERRV_LABEL_ALLOCATION_FAILURE, ERRV_ROUTING_LOOP, ERRV_TUNNEL_LOCALLY_REPAIRED};
+
+/* A estrutura a seguir representa o header (cabealho) para os protocolos de controle de rtulos (labels).  Os campos das mensagens de controle
+*  so enumeraes (inteiros), e no strings, para manter pequeno o pacote de dados, que tambm carrega este header.
 */
 struct labelHeader {
 	int label;  //rtulo para uso do MPLS
-	char msgType[30]; //tipo de mensagem
-	char errorCode[50]; //cdigo de erro para PathErr e ResvErr
-	char errorValue[50]; //valor ou tipo de erro para PathErr e ResvErr
+	int msgType; //tipo de mensagem (enum MsgType); MSG_NONE para pacotes de dados
+	int errorCode; //cdigo de erro para PathErr e ResvErr (enum ErrorCode)
+	int errorValue; //valor ou tipo de erro para PathErr e ResvErr (enum ErrorValue)
 	int msgID;  //ID nico desta mensagem para controle de ACK
 	int msgIDack; //ID da mensagem de controle para qual esta mensagem serve de ACK ou resposta
 	int LSPid;  //ID nico da LSP por qual trafegar este pacote
@@ -280,6 +368,34 @@ struct TarvosModel {
 	struct Node node[NODES + 1]; //NODES especifica o nmero de nodos que h no modelo
 };
 
+/* Bloco de pacotes do pool de pacotes de um contexto; os blocos so encadeados por next e s so liberados com o contexto (ver pktPoolFree) */
+struct PacketChunk {
+	struct PacketChunk *next; //prximo bloco alocado
+	struct Packet pkts[PKT_CHUNK]; //pacotes do bloco
+};
+
+/* Estado do shell TARVOS para uma simulao:  o modelo, a LIB, a LSP Table e os contadores de identificadores.  H uma estrutura destas por
+*  contexto de simulao do kernel (struct simmContext), de modo que simulaes em threads diferentes no compartilham estado.  Ver tarvosContext().
+*/
+struct TarvosContext {
+	struct TarvosModel tc_model; //modelo da rede (ver tarvosModel)
+	struct LIB tc_lib; //LIB - Label Information Base, usada pelo mdulo RSVP-TE
+	struct LSPTable tc_lspTable; //LSP Table, usada pelo mdulo RSVP-TE
+	int tc_packetNumber; //ltimo nmero de srie de pacote atribudo (createPacket)
+	int tc_msgID; //ltimo msgID de mensagem de controle atribudo
+	int tc_LSPid; //ltimo LSPid atribudo
+	int tc_rngRoute; //stream aleatrio nomeado de decidePathStaticRoute (ver tarvosStream)
+	int tc_rngHello; //stream aleatrio nomeado do intervalo aleatrio das mensagens HELLO
+	int tc_rngRefresh; //stream aleatrio nomeado do intervalo aleatrio das mensagens PATH_REFRESH
+	struct Packet *tc_pktFree; //lista de pacotes livres do pool de pacotes, encadeados por next (ver createPacket e freePkt)
+	struct PacketChunk *tc_pktChunks; //blocos alocados pelo pool de pacotes; o primeiro  o bloco corrente
+	int tc_pktUsed; //pacotes j entregues do bloco corrente
+	int tc_pktLive; //pacotes em uso
+	int tc_pktPeak; //maior nmero de pacotes em uso simultaneamente
+	long long tc_pktRecycled; //pacotes entregues por createPacket a partir da lista de livres
+	struct traceState *tc_trace; //estado dos traces (arquivos, buffer circular, intervalos de agregao), criado no primeiro registro; ver tarvos_trace.c
+};
+
 /* Estruturas de apoio para uma lista duplamente encadeada, circular, com Head Node, para uso da preempo de LSPs.  A lista conter as LSPs, por nodo
 *  ordenadas da menor prioridade (nmero mais alto) para a maior prioridade (nmero mais baixo de prioridade).
 */